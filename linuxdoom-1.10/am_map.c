@@ -219,8 +219,6 @@ static int 	grid = 0;
 static int 	leveljuststarted = 1; 	// kluge until AM_LevelInit() is called
 
 boolean    	automapactive = false;
-static int 	finit_width = SCREENWIDTH;
-static int 	finit_height = SCREENHEIGHT - 32;
 
 // location of window on screen
 static int 	f_x;
@@ -539,8 +537,9 @@ void AM_LevelInit(void)
     leveljuststarted = 0;
 
     f_x = f_y = 0;
-    f_w = finit_width;
-    f_h = finit_height;
+    // the status bar is 32 rows of the 2D screen
+    f_w = SCREENWIDTH;
+    f_h = V_ScaleY (ORIGHEIGHT-32);
 
     AM_clearMarks();
 
@@ -639,19 +638,19 @@ AM_Responder
 	switch(ev->data1)
 	{
 	  case AM_PANRIGHTKEY: // pan right
-	    if (!followplayer) m_paninc.x = FTOM(F_PANINC);
+	    if (!followplayer) m_paninc.x = FTOM(V_ScaleX(F_PANINC));
 	    else rc = false;
 	    break;
 	  case AM_PANLEFTKEY: // pan left
-	    if (!followplayer) m_paninc.x = -FTOM(F_PANINC);
+	    if (!followplayer) m_paninc.x = -FTOM(V_ScaleX(F_PANINC));
 	    else rc = false;
 	    break;
 	  case AM_PANUPKEY: // pan up
-	    if (!followplayer) m_paninc.y = FTOM(F_PANINC);
+	    if (!followplayer) m_paninc.y = FTOM(V_ScaleX(F_PANINC));
 	    else rc = false;
 	    break;
 	  case AM_PANDOWNKEY: // pan down
-	    if (!followplayer) m_paninc.y = -FTOM(F_PANINC);
+	    if (!followplayer) m_paninc.y = -FTOM(V_ScaleX(F_PANINC));
 	    else rc = false;
 	    break;
 	  case AM_ZOOMOUTKEY: // zoom out
@@ -1272,7 +1271,7 @@ void AM_drawPlayers(void)
 	if (p->powers[pw_invisibility])
 	    color = 246; // *close* to black
 	else
-	    color = their_colors[their_color];
+	    color = their_colors[their_color%ORIGPLAYERS];
 	
 	AM_drawLineCharacter
 	    (player_arrow, NUMPLYRLINES, 0, p->mo->angle,
@@ -1312,12 +1311,13 @@ void AM_drawMarks(void)
 	{
 	    //      w = SHORT(marknums[i]->width);
 	    //      h = SHORT(marknums[i]->height);
-	    w = 5; // because something's wrong with the wad, i guess
-	    h = 6; // because something's wrong with the wad, i guess
+	    w = V_ScaleX(5); // because something's wrong with the wad, i guess
+	    h = V_ScaleY(6); // because something's wrong with the wad, i guess
 	    fx = CXMTOF(markpoints[i].x);
 	    fy = CYMTOF(markpoints[i].y);
 	    if (fx >= f_x && fx <= f_w - w && fy >= f_y && fy <= f_h - h)
-		V_DrawPatch(fx, fy, FB, marknums[i]);
+		V_DrawPatch(fx*ORIGWIDTH/SCREENWIDTH,
+			    fy*ORIGHEIGHT/SCREENHEIGHT, FB, marknums[i]);
 	}
     }
 
@@ -59,6 +59,7 @@ static const char rcsid[] = "$Id: d_main.c,v 1.8 1997/02/03 22:45:09 b1 Exp $";
 #include "m_argv.h"
 #include "m_misc.h"
 #include "m_menu.h"
+#include "m_bench.h"
 
 #include "i_system.h"
 #include "i_sound.h"
@@ -100,6 +101,8 @@ boolean         fastparm;	// checkparm of -fast
 boolean         drone;
 
 boolean		singletics = false; // debug flag to cancel adaptiveness
+boolean		uncapped;	// checkparm of -uncapped
+int		maxfps;		// -maxfps, 0 draws uncapped frames flat out
 
 
 
@@ -239,12 +242,12 @@ void D_Display (void)
 	    break;
 	if (automapactive)
 	    AM_Drawer ();
-	if (wipe || (viewheight != 200 && fullscreen) )
+	if (wipe || (viewheight != SCREENHEIGHT && fullscreen) )
 	    redrawsbar = true;
 	if (inhelpscreensstate && !inhelpscreens)
 	    redrawsbar = true;              // just put away the help screen
-	ST_Drawer (viewheight == 200, redrawsbar );
-	fullscreen = viewheight == 200;
+	ST_Drawer (viewheight == SCREENHEIGHT, redrawsbar );
+	fullscreen = viewheight == SCREENHEIGHT;
 	break;
 
       case GS_INTERMISSION:
@@ -282,7 +285,7 @@ void D_Display (void)
     }
 
     // see if the border needs to be updated to the screen
-    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != 320)
+    if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != SCREENWIDTH)
     {
 	if (menuactive || menuactivestate || !viewactivestate)
 	    borderdrawcount = 3;
@@ -305,21 +308,25 @@ void D_Display (void)
 	if (automapactive)
 	    y = 4;
 	else
-	    y = viewwindowy+4;
-	V_DrawPatchDirect(viewwindowx+(scaledviewwidth-68)/2,
+	    y = viewwindowy*ORIGHEIGHT/SCREENHEIGHT+4;
+	// the view window is centred across the screen
+	V_DrawPatchDirect((ORIGWIDTH-68)/2,
 			  y,0,W_CacheLumpName ("M_PAUSE", PU_CACHE));
     }
 
 
     // menus go directly to the screen
     M_Drawer ();          // menu is drawn even on top of everything
+    M_DrawZoneStats ();
     NetUpdate ();         // send out any new accumulation
 
 
     // normal update
     if (!wipe)
     {
+	M_BenchBegin (bs_blit);
 	I_FinishUpdate ();              // page flip or blit buffer
+	M_BenchEnd (bs_blit);
 	return;
     }
     
@@ -346,6 +353,80 @@ void D_Display (void)
 
 
 
+//
+// D_GameStill
+// True when nothing moves between tics,
+//  the same test P_Ticker pauses on.
+//
+static boolean D_GameStill (void)
+{
+    return paused
+	|| (!netgame
+	    && menuactive
+	    && !demoplayback
+	    && players[consoleplayer].viewz != 1);
+}
+
+
+//
+// D_SetInterpolation
+// Uncapped frames are drawn the part of a tic
+//  since the last one ran, whole while the game stands still.
+//
+static int		lastgametic;
+static unsigned		lastticus;
+
+static void D_SetInterpolation (void)
+{
+    unsigned	now;
+
+    now = I_GetTimeUS ();
+    if (gametic != lastgametic)
+	lastticus = now;
+
+    if (D_GameStill ())
+    {
+	interpfrac = FRACUNIT;
+	return;
+    }
+
+    interpfrac = (long long)(now - lastticus) * TICRATE * FRACUNIT / 1000000;
+    if (interpfrac > FRACUNIT)
+	interpfrac = FRACUNIT;
+}
+
+
+
+//
+// D_WaitFrame
+// Sleeps until the next uncapped frame is due,
+//  the next tic when there is nothing to move.
+//
+static unsigned		lastframeus;
+
+static void D_WaitFrame (void)
+{
+    unsigned	wake;
+    unsigned	frame;
+
+    wake = I_TicStartUS (I_GetTime () + 1);
+
+    if (gamestate == GS_LEVEL && !D_GameStill ())
+    {
+	if (!maxfps)
+	    return;
+	
+	frame = lastframeus + 1000000/maxfps;
+	if ((int)(frame - wake) < 0)
+	    wake = frame;
+    }
+    
+    I_SleepUntilUS (wake);
+    lastframeus = I_GetTimeUS ();
+}
+
+
+
 //
 //  D_DoomLoop
 //
@@ -366,8 +447,18 @@ void D_DoomLoop (void)
 	
     I_InitGraphics ();
 
+    // demos timed or hashed run one frame per tic
+    if (singletics || fastdemo)
+	uncapped = false;
+
+    lastgametic = gametic;
+    lastticus = I_GetTimeUS ();
+
     while (1)
     {
+	if (uncapped)
+	    D_WaitFrame ();
+
 	// frame syncronous IO operations
 	I_StartFrame ();                
 	
@@ -388,11 +479,30 @@ void D_DoomLoop (void)
 	{
 	    TryRunTics (); // will run at least one tic
 	}
+
+	// nothing to show or hear, straight on to the next tic
+	if (fastdemo)
+	    continue;
+
+	if (uncapped)
+	{
+	    D_SetInterpolation ();
+	    
+	    // frames between tics are only drawn,
+	    //  sound moves on with the game
+	    if (gametic == lastgametic)
+	    {
+		D_Display ();
+		continue;
+	    }
+	    lastgametic = gametic;
+	}
 		
 	S_UpdateSounds (players[consoleplayer].mo);// move positional sounds
 
 	// Update display, next frame, with current state.
 	D_Display ();
+	M_BenchFrame ();
 
 #ifndef SNDSERV
 	// Sound mixing for the buffer is snychronous.
@@ -809,6 +919,13 @@ void D_DoomMain (void)
     respawnparm = M_CheckParm ("-respawn");
     fastparm = M_CheckParm ("-fast");
     devparm = M_CheckParm ("-devparm");
+    zonestats = M_CheckParm ("-zonestats");
+    uncapped = M_CheckParm ("-uncapped");
+    ticstats = M_CheckParm ("-ticstats");
+
+    p = M_CheckParm ("-maxfps");
+    if (p && p < myargc-1)
+	maxfps = atoi (myargv[p+1]);
     if (M_CheckParm ("-altdeath"))
 	deathmatch = 2;
     else if (M_CheckParm ("-deathmatch"))
@@ -950,6 +1067,9 @@ void D_DoomMain (void)
     if (!p)
 	p = M_CheckParm ("-timedemo");
 
+    if (!p)
+	p = M_CheckParm ("-fastdemo");
+
     if (p && p < myargc-1)
     {
 	sprintf (file,"%s.lmp", myargv[p+1]);
@@ -1147,6 +1267,13 @@ void D_DoomMain (void)
 	D_DoomLoop ();  // never returns
     }
 	
+    p = M_CheckParm ("-fastdemo");
+    if (p && p < myargc-1)
+    {
+	G_FastDemo (myargv[p+1]);
+	D_DoomLoop ();  // never returns
+    }
+	
     p = M_CheckParm ("-loadgame");
     if (p && p < myargc-1)
     {
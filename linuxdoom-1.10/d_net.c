@@ -26,6 +26,10 @@
 static const char rcsid[] = "$Id: d_net.c,v 1.3 1997/02/03 22:01:47 b1 Exp $";
 
 
+#include <stdlib.h>
+
+#include "z_zone.h"
+#include "m_argv.h"
 #include "m_menu.h"
 #include "i_system.h"
 #include "i_video.h"
@@ -33,14 +37,8 @@ static const char rcsid[] = "$Id: d_net.c,v 1.3 1997/02/03 22:01:47 b1 Exp $";
 #include "g_game.h"
 #include "doomdef.h"
 #include "doomstat.h"
+#include "m_bench.h"
 
-#define	NCMD_EXIT		0x80000000
-#define	NCMD_RETRANSMIT		0x40000000
-#define	NCMD_SETUP		0x20000000
-#define	NCMD_KILL		0x10000000	// kill game
-#define	NCMD_CHECKSUM	 	0x0fffffff
-
- 
 doomcom_t*	doomcom;	
 doomdata_t*	netbuffer;		// points inside doomcom
 
@@ -59,22 +57,78 @@ doomdata_t*	netbuffer;		// points inside doomcom
 
 ticcmd_t	localcmds[BACKUPTICS];
 
-ticcmd_t        netcmds[MAXPLAYERS][BACKUPTICS];
+ticcmd_t        (*netcmds)[BACKUPTICS];
 int         	nettics[MAXNETNODES];
 boolean		nodeingame[MAXNETNODES];		// set false as nodes leave game
 boolean		remoteresend[MAXNETNODES];		// set when local needs tics
 int		resendto[MAXNETNODES];			// set when remote needs tics
 int		resendcount[MAXNETNODES];
 
-int		nodeforplayer[MAXPLAYERS];
+int*		nodeforplayer;
 
 int             maketic;
 int		lastnettic;
-int		skiptics;
 int		ticdup;		
 int		maxsend;	// BACKUPTICS/(2*ticdup)-1
 
 
+//
+// RELAY
+// With -relay the key player is a packet server.
+// The other nodes list only it, and send their tics
+//  to it alone; it settles each tic for every player
+//  and sends all of them to each client in one packet.
+// A node that is relaywait tics late has its player
+//  stood still for the tic instead of stalling the game.
+//
+#define RELAYWAIT	4
+#define RELAYBACKUP	(BACKUPTICS*16)	// settled tics kept for resends
+
+boolean		relay;			// this node is the relay server
+boolean		relayclient;		// node 1 is the relay server
+int		relaytic;		// first tic not settled
+int		relaywait;
+int		relaylate;		// commands stood still
+ticcmd_t*	relaycmds;		// [RELAYBACKUP][MAXPLAYERS]
+
+extern short	(*consistancy)[BACKUPTICS];
+
+
+//
+// LATENCY
+// How far ahead of the game tics are made, how many old
+//  tics each packet repeats, and how a node keeps time
+//  with the key player follow the round trip, jitter and
+//  loss the network layer measures for each link.
+//
+#define TICUS		(1000000/TICRATE)
+#define LATENCYTICS	TICRATE		// between sendahead updates
+#define CLEANUPDATES	5		// updates without loss before
+					//  a node gets fewer old tics
+#define CATCHUPFRAMES	4		// frames a backlog is run over
+
+int		sendahead = BACKUPTICS/2-1;	// maketic may lead gametic by
+int		nodeextra[MAXNETNODES];		// old tics repeated to a node
+int		nodeclean[MAXNETNODES];		// updates since it lost any
+int		noderesends[MAXNETNODES];	// retransmits it asked for
+int		oldresends[MAXNETNODES];
+int		oldlost[MAXNETNODES];
+int		latencytic;			// maketic of the last update
+
+int		clocktics;		// NetTime is ahead of I_GetTime by
+int		clockus;		//  these, 0 <= clockus < TICUS
+int		clockdrift;		// smoothed error from the key player
+
+// -ticstats style counters, printed by D_QuitNetGame
+int		sendaheadmin;
+int		sendaheadmax;
+int		clockmoved;		// us of corrections either way
+int		netstalls;		// frames that waited a tic or more
+int		netstallus;		//  for other nodes' tics
+int		catchupframes;		// frames that left a backlog
+int		maxrun;			// most tics run in a frame
+
+
 void D_ProcessEvents (void); 
 void G_BuildTiccmd (ticcmd_t *cmd); 
 void D_DoAdvanceDemo (void);
@@ -89,7 +143,12 @@ doomdata_t	reboundstore;
 //
 int NetbufferSize (void)
 {
-    return (int)&(((doomdata_t *)0)->cmds[netbuffer->numtics]); 
+    int		numcmds;
+
+    numcmds = netbuffer->numtics;
+    if (netbuffer->checksum & NCMD_RELAY)
+	numcmds *= netbuffer->player;
+    return (int)&(((doomdata_t *)0)->cmds[numcmds]); 
 }
 
 //
@@ -185,6 +244,20 @@ HSendPacket
     I_NetCmd ();
 }
 
+//
+// HFlushPackets
+// Sends the packets HSendPacket queued,
+//  the driver batches them into one call
+//
+void HFlushPackets (void)
+{
+    if (!netgame || demoplayback)
+	return;
+    
+    doomcom->command = CMD_FLUSH;
+    I_NetCmd ();
+}
+
 //
 // HGetPacket
 // Returns false if no packet is waiting
@@ -253,6 +326,34 @@ boolean HGetPacket (void)
 }
 
 
+//
+// RelayStore
+// Takes every player's tics from a relay packet,
+//  as many as the command store can hold.
+//
+void RelayStore (int netnode, int realstart)
+{
+    int		numtics;
+    int		tic;
+    int		i;
+
+    if (netbuffer->player != MAXPLAYERS)
+	I_Error ("RelayStore: %i player slots from the relay, not %i",
+		 netbuffer->player, MAXPLAYERS);
+    
+    numtics = netbuffer->numtics;
+    while (nettics[netnode] < realstart + numtics
+	   && nettics[netnode] < gametic/ticdup + BACKUPTICS)
+    {
+	tic = nettics[netnode];
+	for (i=0 ; i<MAXPLAYERS ; i++)
+	    netcmds[i][tic%BACKUPTICS] =
+		netbuffer->cmds[i*numtics + tic-realstart];
+	nettics[netnode]++;
+    }
+}
+
+
 //
 // GetPackets
 //
@@ -284,10 +385,14 @@ void GetPackets (void)
 	{
 	    if (!nodeingame[netnode])
 		continue;
+	    if (relayclient)
+		I_Error ("The relay server left the game");
 	    nodeingame[netnode] = false;
-	    playeringame[netconsole] = false;
-	    strcpy (exitmsg, "Player 1 left the game");
-	    exitmsg[7] += netconsole;
+	    // the relay server stands the player still
+	    //  instead, so that all nodes agree on the tic
+	    if (!relay)
+		playeringame[netconsole] = false;
+	    sprintf (exitmsg, "Player %i left the game", netconsole+1);
 	    players[consoleplayer].message = exitmsg;
 	    if (demorecording)
 		G_CheckDemoStatus ();
@@ -298,19 +403,33 @@ void GetPackets (void)
 	if (netbuffer->checksum & NCMD_KILL)
 	    I_Error ("Killed by network driver");
 
-	nodeforplayer[netconsole] = netnode;
+	if (!(netbuffer->checksum & NCMD_RELAY))
+	    nodeforplayer[netconsole] = netnode;
 	
 	// check for retransmit request
 	if ( resendcount[netnode] <= 0 
 	     && (netbuffer->checksum & NCMD_RETRANSMIT) )
 	{
-	    resendto[netnode] = ExpandTics(netbuffer->retransmitfrom);
+	    // the relay server keeps more settled tics
+	    //  than ExpandTics can reach
+	    if (relay)
+		resendto[netnode] = relaytic
+		    - ((relaytic - netbuffer->retransmitfrom)&0xff);
+	    else
+		resendto[netnode] = ExpandTics(netbuffer->retransmitfrom);
+	    noderesends[netnode]++;
 	    if (debugfile)
 		fprintf (debugfile,"retransmit from %i\n", resendto[netnode]);
 	    resendcount[netnode] = RESENDCOUNT;
 	}
 	else
 	    resendcount[netnode]--;
+
+	// the relay server has stood a late node's
+	//  missing tics still, skip to what it sends now
+	if (relay && realstart > nettics[netnode]
+	    && nettics[netnode] < relaytic)
+	    nettics[netnode] = realstart < relaytic ? realstart : relaytic;
 	
 	// check for out of order / duplicated packet		
 	if (realend == nettics[netnode])
@@ -338,6 +457,13 @@ void GetPackets (void)
 	}
 
 	// update command store from the packet
+	if (netbuffer->checksum & NCMD_RELAY)
+	{
+	    remoteresend[netnode] = false;
+	    RelayStore (netnode, realstart);
+	    continue;
+	}
+	
         {
 	    int		start;
 
@@ -349,8 +475,10 @@ void GetPackets (void)
 	    while (nettics[netnode] < realend)
 	    {
 		dest = &netcmds[netconsole][nettics[netnode]%BACKUPTICS];
+		// the relay server has settled these already
+		if (!relay || nettics[netnode] >= relaytic)
+		    *dest = *src;
 		nettics[netnode]++;
-		*dest = *src;
 		src++;
 	    }
 	}
@@ -358,6 +486,265 @@ void GetPackets (void)
 }
 
 
+//
+// RelaySettle
+// Settles tics once every node has sent them, or once
+//  nodes still missing are relaywait tics late, standing
+//  their players still with the consistancy the relay
+//  server has for them.
+//
+void RelaySettle (void)
+{
+    int		i;
+    int		node;
+    boolean	late;
+    ticcmd_t*	cmd;
+
+    // the consistancy used for a late player was set
+    //  when the tic BACKUPTICS before this one was run,
+    //  which NetUpdate keeps true of our own tics
+    while (relaytic < nettics[0])
+    {
+	late = false;
+	for (i=0 ; i<MAXPLAYERS ; i++)
+	{
+	    node = nodeforplayer[i];
+	    if (playeringame[i]
+		&& (node < 0 || (nodeingame[node] && nettics[node] <= relaytic)))
+		late = true;
+	}
+	if (late && nettics[0] - relaytic < relaywait)
+	    break;
+
+	for (i=0 ; i<MAXPLAYERS ; i++)
+	{
+	    node = nodeforplayer[i];
+	    cmd = &netcmds[i][relaytic%BACKUPTICS];
+	    if (playeringame[i]
+		&& (node < 0 || !nodeingame[node] || nettics[node] <= relaytic))
+	    {
+		memset (cmd, 0, sizeof(*cmd));
+		cmd->consistancy = consistancy[i][relaytic%BACKUPTICS];
+		relaylate++;
+	    }
+	    relaycmds[(relaytic%RELAYBACKUP)*MAXPLAYERS + i] = *cmd;
+	}
+	relaytic++;
+    }
+}
+
+
+//
+// RelaySend
+// Sends a client every player's settled tics
+//  from the one it needs next.
+//
+void RelaySend (int node)
+{
+    int		realstart;
+    int		numtics;
+    int		i, j;
+
+    realstart = resendto[node];
+    if (realstart < relaytic - RELAYBACKUP)
+    {
+	// too far behind to catch up
+	netbuffer->player = consoleplayer;
+	netbuffer->numtics = 0;
+	HSendPacket (node, NCMD_KILL);
+	nodeingame[node] = false;
+	printf ("RelaySend: node %i fell %i tics behind\n",
+		node, relaytic - realstart);
+	return;
+    }
+    
+    numtics = relaytic - realstart;
+    if (numtics > BACKUPTICS)
+	numtics = BACKUPTICS;
+    resendto[node] = realstart + numtics - nodeextra[node];
+    if (resendto[node] < realstart)
+	resendto[node] = realstart;
+    
+    netbuffer->starttic = realstart;
+    netbuffer->player = MAXPLAYERS;
+    netbuffer->numtics = numtics;
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	for (j=0 ; j<numtics ; j++)
+	    netbuffer->cmds[i*numtics + j] =
+		relaycmds[((realstart+j)%RELAYBACKUP)*MAXPLAYERS + i];
+    
+    if (remoteresend[node])
+    {
+	netbuffer->retransmitfrom = nettics[node];
+	HSendPacket (node, NCMD_RELAY|NCMD_RETRANSMIT);
+    }
+    else
+    {
+	netbuffer->retransmitfrom = 0;
+	HSendPacket (node, NCMD_RELAY);
+    }
+}
+
+
+//
+// RelayUpdate
+// Settles what it can and sends it out,
+//  at least once a tic.
+//
+void RelayUpdate (boolean newtic)
+{
+    static int	sent;
+    int		i;
+    
+    RelaySettle ();
+    if (!newtic && sent == relaytic)
+	return;
+    sent = relaytic;
+    
+    for (i=1 ; i<doomcom->numnodes ; i++)
+	if (nodeingame[i])
+	    RelaySend (i);
+    HFlushPackets ();
+}
+
+
+//
+// NetTime
+// I_GetTime in ticdup units, moved by the clock offset.
+//
+int NetTime (void)
+{
+    int		tic;
+    int		us;
+
+    tic = I_GetTime ();
+    us = (int)(I_GetTimeUS () - I_TicStartUS (tic)) + clockus;
+    return (tic + clocktics + us/TICUS) / ticdup;
+}
+
+
+//
+// NetLatency
+// Called by NetUpdate after making newtics.
+// Each tic the clock of a node other than the key player
+//  is moved a little toward the key player's, which runs
+//  a one way trip ahead of the tics we have from it.  A
+//  relay client runs a further trip ahead, so that its tics
+//  reach the server before it settles them.  Each second
+//  sendahead is set to cover the slowest link, and nodes
+//  that lose packets are sent more old tics.
+//
+void NetLatency (int newtics)
+{
+    int		i;
+    int		node;
+    int		lead;
+    int		worst;
+    int		error;
+    int		limit;
+    int		move;
+    int		lost;
+    netnode_t	n;
+
+    if (!netgame || demoplayback || doomcom->numnodes < 2)
+	return;
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	if (playeringame[i])
+	    break;
+    node = i < MAXPLAYERS ? nodeforplayer[i] : 0;
+    if (node > 0)
+	I_NetNodeStats (node, &n);
+    if (i != consoleplayer && !relay && node > 0
+	&& n.pongs
+	&& maketic - gametic/ticdup < sendahead)
+    {
+	lead = n.rtt/2;
+	if (relayclient)
+	    lead = n.rtt + 2*n.jitter;
+	error = (nettics[node] - maketic)*TICUS*ticdup + lead;
+	for (i=0 ; i<newtics ; i++)
+	    clockdrift += (error - clockdrift)/8;
+
+	// an eighth of a tic a tic, or half when far out
+	limit = TICUS/8;
+	if (abs (clockdrift) > 4*TICUS*ticdup)
+	    limit = TICUS/2;
+	limit *= newtics;
+	move = clockdrift/16*newtics;
+	if (move > limit)
+	    move = limit;
+	if (move < -limit)
+	    move = -limit;
+
+	clockmoved += abs (move);
+	clockus += move;
+	while (clockus >= TICUS)
+	{
+	    clockus -= TICUS;
+	    clocktics++;
+	}
+	while (clockus < 0)
+	{
+	    clockus += TICUS;
+	    clocktics--;
+	}
+    }
+
+    if (maketic - latencytic < LATENCYTICS)
+	return;
+    latencytic = maketic;
+
+    worst = 0;
+    for (i=1 ; i<doomcom->numnodes ; i++)
+    {
+	if (!nodeingame[i])
+	    continue;
+	I_NetNodeStats (i, &n);
+	if (n.pongs)
+	{
+	    lead = n.rtt/2 + 2*n.jitter;
+	    if (relayclient)
+		lead += n.rtt/2;
+	    if (lead > worst)
+		worst = lead;
+	}
+
+	// pings still out are not lost yet
+	lost = n.pings - n.pongs - 1 - n.rtt/NETPINGUS;
+	if (lost > oldlost[i] || noderesends[i] > oldresends[i])
+	{
+	    if (nodeextra[i] < 2)
+		nodeextra[i]++;
+	    nodeclean[i] = 0;
+	}
+	else if (++nodeclean[i] >= CLEANUPDATES
+		 && nodeextra[i] > doomcom->extratics)
+	{
+	    nodeextra[i]--;
+	    nodeclean[i] = 0;
+	}
+	if (lost > oldlost[i])
+	    oldlost[i] = lost;
+	oldresends[i] = noderesends[i];
+    }
+
+    if (!worst)
+	return;
+    
+    // a tic of slack for clocks that are not quite together
+    sendahead = 2 + (worst + TICUS*ticdup-1)/(TICUS*ticdup);
+    if (relay && sendahead < relaywait)
+	sendahead = relaywait;		// or late nodes are waited for
+    if (sendahead > BACKUPTICS/2-1)
+	sendahead = BACKUPTICS/2-1;
+    if (sendahead < sendaheadmin)
+	sendaheadmin = sendahead;
+    if (sendahead > sendaheadmax)
+	sendaheadmax = sendahead;
+}
+
+
 //
 // NetUpdate
 // Builds ticcmds for console player,
@@ -374,24 +761,12 @@ void NetUpdate (void)
     int				gameticdiv;
     
     // check time
-    nowtime = I_GetTime ()/ticdup;
+    nowtime = NetTime ();
     newtics = nowtime - gametime;
     gametime = nowtime;
 	
     if (newtics <= 0) 	// nothing new to update
 	goto listen; 
-
-    if (skiptics <= newtics)
-    {
-	newtics -= skiptics;
-	skiptics = 0;
-    }
-    else
-    {
-	skiptics -= newtics;
-	newtics = 0;
-    }
-	
 		
     netbuffer->player = consoleplayer;
     
@@ -401,13 +776,14 @@ void NetUpdate (void)
     {
 	I_StartTic ();
 	D_ProcessEvents ();
-	if (maketic - gameticdiv >= BACKUPTICS/2-1)
+	if (maketic - gameticdiv >= sendahead)
 	    break;          // can't hold any more
 	
 	//printf ("mk:%i ",maketic);
 	G_BuildTiccmd (&localcmds[maketic%BACKUPTICS]);
 	maketic++;
     }
+    NetLatency (newtics);
 
 
     if (singletics)
@@ -417,12 +793,31 @@ void NetUpdate (void)
     for (i=0 ; i<doomcom->numnodes ; i++)
 	if (nodeingame[i])
 	{
+	    // the relay server sends clients settled tics,
+	    //  and a client runs only those, its own too
+	    if (relay && i)
+		continue;
+	    if (relayclient)
+	    {
+		if (!i)
+		{
+		    nettics[0] = maketic;
+		    continue;
+		}
+		// tics the relay server gave up on are not resent
+		if (resendto[i] < maketic - BACKUPTICS
+		    || resendto[i] > maketic)
+		    resendto[i] = maketic - BACKUPTICS;
+		if (resendto[i] < 0)
+		    resendto[i] = 0;
+	    }
+	    
 	    netbuffer->starttic = realstart = resendto[i];
 	    netbuffer->numtics = maketic - realstart;
 	    if (netbuffer->numtics > BACKUPTICS)
 		I_Error ("NetUpdate: netbuffer->numtics > BACKUPTICS");
 
-	    resendto[i] = maketic - doomcom->extratics;
+	    resendto[i] = maketic - nodeextra[i];
 
 	    for (j=0 ; j< netbuffer->numtics ; j++)
 		netbuffer->cmds[j] = 
@@ -439,10 +834,13 @@ void NetUpdate (void)
 		HSendPacket (i, 0);
 	    }
 	}
+    HFlushPackets ();
     
     // listen for other packets
   listen:
     GetPackets ();
+    if (relay)
+	RelayUpdate (newtics > 0);
 }
 
 
@@ -456,8 +854,7 @@ void CheckAbort (void)
     int		stoptic;
 	
     stoptic = I_GetTime () + 2; 
-    while (I_GetTime() < stoptic) 
-	I_StartTic (); 
+    I_SleepUntilUS (I_TicStartUS (stoptic));
 	
     I_StartTic ();
     for ( ; eventtail != eventhead 
@@ -492,8 +889,16 @@ void D_ArbitrateNetStart (void)
 		continue;
 	    if (netbuffer->checksum & NCMD_SETUP)
 	    {
-		if (netbuffer->player != VERSION)
+		if (netbuffer->player == VERSION)
+		    I_Error ("The key player sends old uncompressed packets!");
+		if (netbuffer->player != NETVERSION)
 		    I_Error ("Different DOOM versions cannot play a net game!");
+		if (netbuffer->numtics < 1
+		    || netbuffer->cmds[0].consistancy != NETPROTOCOL)
+		    I_Error ("Different network protocols cannot play a net game!");
+		MAXPLAYERS = netbuffer->cmds[0].angleturn;
+		doomcom->numplayers = netbuffer->cmds[0].forwardmove;
+		relayclient = netbuffer->cmds[0].buttons & 1;
 		startskill = netbuffer->retransmitfrom & 15;
 		deathmatch = (netbuffer->retransmitfrom & 0xc0) >> 6;
 		nomonsters = (netbuffer->retransmitfrom & 0x20) > 0;
@@ -521,10 +926,16 @@ void D_ArbitrateNetStart (void)
 		if (respawnparm)
 		    netbuffer->retransmitfrom |= 0x10;
 		netbuffer->starttic = startepisode * 64 + startmap;
-		netbuffer->player = VERSION;
-		netbuffer->numtics = 0;
+		netbuffer->player = NETVERSION;
+		netbuffer->numtics = 1;
+		memset (&netbuffer->cmds[0], 0, sizeof(ticcmd_t));
+		netbuffer->cmds[0].consistancy = NETPROTOCOL;
+		netbuffer->cmds[0].angleturn = MAXPLAYERS;
+		netbuffer->cmds[0].forwardmove = doomcom->numplayers;
+		netbuffer->cmds[0].buttons = relay;
 		HSendPacket (i, NCMD_SETUP);
 	    }
+	    HFlushPackets ();
 
 #if 1
 	    for(i = 10 ; i  &&  HGetPacket(); --i)
@@ -555,6 +966,7 @@ extern	int			viewangleoffset;
 void D_CheckNetGame (void)
 {
     int             i;
+    int             p;
 	
     for (i=0 ; i<MAXNETNODES ; i++)
     {
@@ -569,10 +981,60 @@ void D_CheckNetGame (void)
     if (doomcom->id != DOOMCOM_ID)
 	I_Error ("Doomcom buffer invalid!");
     
+    // the key player's count goes to the others
+    //  in the setup packet
+    if (doomcom->numplayers > MAXPLAYERS)
+	MAXPLAYERS = doomcom->numplayers;
+    p = M_CheckParm ("-maxplayers");
+    if (p && p < myargc-1 && atoi (myargv[p+1]) > MAXPLAYERS)
+	MAXPLAYERS = atoi (myargv[p+1]);
+    
     netbuffer = &doomcom->data;
     consoleplayer = displayplayer = doomcom->consoleplayer;
+    relay = netgame && M_CheckParm ("-relay");
+    if (relay && consoleplayer)
+	I_Error ("Only the key player can be the -relay server");
     if (netgame)
 	D_ArbitrateNetStart ();
+    if (relayclient && doomcom->numnodes != 2)
+	I_Error ("A relay client lists only the relay server");
+
+    if (MAXPLAYERS < ORIGPLAYERS || MAXPLAYERS > MAXNETPLAYERS)
+	I_Error ("D_CheckNetGame: %i player slots outside %i to %i",
+		 MAXPLAYERS, ORIGPLAYERS, MAXNETPLAYERS);
+    if (doomcom->numplayers > MAXPLAYERS
+	|| consoleplayer < 0 || consoleplayer >= MAXPLAYERS)
+	I_Error ("D_CheckNetGame: player %i of %i with %i slots",
+		 consoleplayer+1, doomcom->numplayers, MAXPLAYERS);
+
+    G_InitPlayers ();
+    netcmds = Z_Malloc (MAXPLAYERS*sizeof(*netcmds), PU_STATIC, 0);
+    nodeforplayer = Z_Malloc (MAXPLAYERS*sizeof(*nodeforplayer), PU_STATIC, 0);
+    memset (netcmds, 0, MAXPLAYERS*sizeof(*netcmds));
+    memset (nodeforplayer, 0, MAXPLAYERS*sizeof(*nodeforplayer));
+
+    if (relay)
+    {
+	relaywait = RELAYWAIT;
+	p = M_CheckParm ("-relaywait");
+	if (p && p < myargc-1)
+	    relaywait = atoi (myargv[p+1]);
+	// our own tics must be able to get that far ahead
+	if (relaywait > BACKUPTICS/2-1)
+	    relaywait = BACKUPTICS/2-1;
+	if (relaywait < 0)
+	    relaywait = 0;
+	relaycmds = Z_Malloc (RELAYBACKUP*MAXPLAYERS*sizeof(*relaycmds),
+			      PU_STATIC, 0);
+	memset (relaycmds, 0, RELAYBACKUP*MAXPLAYERS*sizeof(*relaycmds));
+
+	// a client's node is known from its first packet
+	for (i=0 ; i<MAXPLAYERS ; i++)
+	    nodeforplayer[i] = i == consoleplayer ? 0 : -1;
+    }
+    if (relayclient)
+	for (i=0 ; i<MAXPLAYERS ; i++)
+	    nodeforplayer[i] = 1;
 
     printf ("startskill %i  deathmatch: %i  startmap: %i  startepisode: %i\n",
 	    startskill, deathmatch, startmap, startepisode);
@@ -582,14 +1044,22 @@ void D_CheckNetGame (void)
     maxsend = BACKUPTICS/(2*ticdup)-1;
     if (maxsend<1)
 	maxsend = 1;
+    for (i=0 ; i<MAXNETNODES ; i++)
+	nodeextra[i] = doomcom->extratics;
+    sendahead = sendaheadmin = sendaheadmax = BACKUPTICS/2-1;
 			
     for (i=0 ; i<doomcom->numplayers ; i++)
 	playeringame[i] = true;
     for (i=0 ; i<doomcom->numnodes ; i++)
 	nodeingame[i] = true;
 	
-    printf ("player %i of %i (%i nodes)\n",
-	    consoleplayer+1, doomcom->numplayers, doomcom->numnodes);
+    printf ("player %i of %i (%i nodes, %i slots)\n",
+	    consoleplayer+1, doomcom->numplayers, doomcom->numnodes,
+	    MAXPLAYERS);
+    if (relay)
+	printf ("relay server, late nodes wait %i tics\n", relaywait);
+    if (relayclient)
+	printf ("relay client\n");
 
 }
 
@@ -602,12 +1072,34 @@ void D_CheckNetGame (void)
 void D_QuitNetGame (void)
 {
     int             i, j;
+    netnode_t	stats;
 	
     if (debugfile)
 	fclose (debugfile);
 		
     if (!netgame || !usergame || consoleplayer == -1 || demoplayback)
 	return;
+
+    if (relay)
+	printf ("relay: %i tics settled, %i late commands stood still\n",
+		relaytic, relaylate);
+    for (i=1 ; i<doomcom->numnodes ; i++)
+    {
+	I_NetNodeStats (i, &stats);
+	printf ("node %i: rtt %i.%i ms, jitter %i.%i ms, "
+		"%i of %i pings lost, %i packets, %i dropped, "
+		"%i resends, %i extra\n",
+		i, stats.rtt/1000, stats.rtt/100%10,
+		stats.jitter/1000, stats.jitter/100%10,
+		stats.pings - stats.pongs, stats.pings,
+		stats.packets, stats.dropped,
+		noderesends[i], nodeextra[i]);
+    }
+    printf ("latency: send ahead %i (%i to %i), clock moved %i ms\n",
+	    sendahead, sendaheadmin, sendaheadmax, clockmoved/1000);
+    printf ("  %i stalls for %i ms, %i frames caught up,"
+	    " at most %i tics a frame\n",
+	    netstalls, netstallus/1000, catchupframes, maxrun);
 	
     // send a bunch of packets for security
     netbuffer->player = consoleplayer;
@@ -617,19 +1109,62 @@ void D_QuitNetGame (void)
 	for (j=1 ; j<doomcom->numnodes ; j++)
 	    if (nodeingame[j])
 		HSendPacket (j, NCMD_EXIT);
+	HFlushPackets ();
 	I_WaitVBL (1);
     }
 }
 
 
 
+//
+// TryWaitTic
+// Sleeps instead of spinning while waiting for tics.
+// Our own arrive on the next tic, other nodes'
+//  whenever their packets do, which the network
+//  thread wakes us for, or else are polled.
+//
+#define NETPOLLUS	1000
+
+static void TryWaitTic (void)
+{
+    unsigned	wake;
+    
+    wake = I_TicStartUS ((I_GetTime ()/ticdup + 1)*ticdup);
+    if (doomcom->numnodes > 1 && I_NetWait (wake))
+	return;
+    if (doomcom->numnodes > 1
+	&& (int)(wake - I_GetTimeUS ()) > NETPOLLUS)
+	wake = I_GetTimeUS () + NETPOLLUS;
+    
+    I_SleepUntilUS (wake);
+}
+
+
+
+//
+// TryStalled
+// Counts a wait on other nodes as a stall when it
+//  took a tic or more, less is clocks out of step.
+//
+static void TryStalled (boolean stalled, unsigned since)
+{
+    int		us;
+
+    us = I_GetTimeUS () - since;
+    if (!stalled || us < TICUS*ticdup)
+	return;
+    netstalls++;
+    netstallus += us;
+}
+
+
+
 //
 // TryRunTics
 //
 int	frametics[4];
 int	frameon;
-int	frameskip[4];
-int	oldnettics;
+int	catchup;		// tics waiting behind the clock
 
 extern	boolean	advancedemo;
 
@@ -642,7 +1177,10 @@ void TryRunTics (void)
     int		realtics;
     int		availabletics;
     int		counts;
+    int		owed;
     int		numplaying;
+    boolean	stalled;
+    unsigned	stalltime;
     
     // get real tics		
     entertic = I_GetTime ()/ticdup;
@@ -663,18 +1201,42 @@ void TryRunTics (void)
 		lowtic = nettics[i];
 	}
     }
+    if (relay)
+	lowtic = relaytic;
     availabletics = lowtic - gametic/ticdup;
     
-    // decide how many tics to run
-    if (realtics < availabletics-1)
-	counts = realtics+1;
-    else if (realtics < availabletics)
-	counts = realtics;
-    else
+    // decide how many tics to run,
+    //  a backlog over several frames
+    owed = catchup + realtics;
+    counts = owed;
+    if (counts > 2)
+	counts = 2 + (counts-2 + CATCHUPFRAMES-1)/CATCHUPFRAMES;
+    if (availabletics > owed+1)
+	counts++;		// others are ahead, gain a tic
+    if (counts > availabletics)
 	counts = availabletics;
     
     if (counts < 1)
 	counts = 1;
+
+    // uncapped, go back and draw until a tic is due and
+    //  every node has sent it, the time owed is kept
+    if (uncapped
+	&& (owed < 1 || lowtic < gametic/ticdup + counts))
+    {
+	oldentertics -= realtics;
+	return;
+    }
+
+    // only tics that are here can be owed,
+    //  the rest were never made
+    catchup = (owed < availabletics ? owed : availabletics) - counts;
+    if (catchup < 0)
+	catchup = 0;
+    if (catchup)
+	catchupframes++;
+    if (counts > maxrun)
+	maxrun = counts;
 		
     frameon++;
 
@@ -683,35 +1245,12 @@ void TryRunTics (void)
 		 "=======real: %i  avail: %i  game: %i\n",
 		 realtics, availabletics,counts);
 
-    if (!demoplayback)
-    {	
-	// ideally nettics[0] should be 1 - 3 tics above lowtic
-	// if we are consistantly slower, speed up time
-	for (i=0 ; i<MAXPLAYERS ; i++)
-	    if (playeringame[i])
-		break;
-	if (consoleplayer == i)
-	{
-	    // the key player does not adapt
-	}
-	else
-	{
-	    if (nettics[0] <= nettics[nodeforplayer[i]])
-	    {
-		gametime--;
-		// printf ("-");
-	    }
-	    frameskip[frameon&3] = (oldnettics > nettics[nodeforplayer[i]]);
-	    oldnettics = nettics[0];
-	    if (frameskip[0] && frameskip[1] && frameskip[2] && frameskip[3])
-	    {
-		skiptics = 1;
-		// printf ("+");
-	    }
-	}
-    }// demoplayback
 	
     // wait for new tics if needed
+    // waiting on other nodes rather than on the clock
+    stalltime = I_GetTimeUS ();
+    stalled = lowtic < gametic/ticdup + counts
+	&& maketic >= gametic/ticdup + counts;
     while (lowtic < gametic/ticdup + counts)	
     {
 	NetUpdate ();   
@@ -720,6 +1259,8 @@ void TryRunTics (void)
 	for (i=0 ; i<doomcom->numnodes ; i++)
 	    if (nodeingame[i] && nettics[i] < lowtic)
 		lowtic = nettics[i];
+	if (relay)
+	    lowtic = relaytic;
 	
 	if (lowtic < gametic/ticdup)
 	    I_Error ("TryRunTics: lowtic < gametic");
@@ -727,10 +1268,22 @@ void TryRunTics (void)
 	// don't stay in here forever -- give the menu a chance to work
 	if (I_GetTime ()/ticdup - entertic >= 20)
 	{
+	    TryStalled (stalled, stalltime);
+	    catchup += counts;
 	    M_Ticker ();
 	    return;
 	} 
+
+	if (lowtic < gametic/ticdup + counts)
+	    TryWaitTic ();
     }
+    TryStalled (stalled, stalltime);
+
+    // how long after the first of them was due
+    //  the tics get to run
+    M_TicLate ((int)(I_GetTimeUS ()
+		     - I_TicStartUS ((I_GetTime ()/ticdup - counts + 1)*ticdup)),
+	       counts*ticdup);
     
     // run the count * ticdup dics
     while (counts--)
@@ -41,8 +41,8 @@
 
 #define DOOMCOM_ID		0x12345678l
 
-// Max computers/players in a game.
-#define MAXNETNODES		8
+// Max computers in a game.
+#define MAXNETNODES		MAXNETPLAYERS
 
 
 // Networking and tick handling related.
@@ -51,11 +51,33 @@
 typedef enum
 {
     CMD_SEND	= 1,
-    CMD_GET	= 2
+    CMD_GET	= 2,
+    // Sends the packets queued by CMD_SEND.
+    CMD_FLUSH	= 3
 
 } command_t;
 
 
+// High bits of doomdata_t checksum.
+#define	NCMD_EXIT		0x80000000
+#define	NCMD_RETRANSMIT		0x40000000
+#define	NCMD_SETUP		0x20000000
+#define	NCMD_KILL		0x10000000	// kill game
+#define	NCMD_RELAY		0x08000000	// every player's tics
+#define	NCMD_CHECKSUM	 	0x07ffffff
+
+// The setup packet carries NETVERSION in place of VERSION
+//  and NETPROTOCOL as the consistancy of its one ticcmd.
+// Peers still sending whole doomdata_t packets see a
+//  different version and refuse the game.
+#define NETVERSION		(VERSION|0x80)
+#define NETPROTOCOL		2
+
+// A relay packet from the -relay server holds numtics tics
+//  for each of player slots, one slot after another.
+#define NETMAXCMDS		(BACKUPTICS*MAXNETPLAYERS)
+
+
 //
 // Network packet data.
 //
@@ -69,7 +91,7 @@ typedef struct
     byte		starttic;
     byte		player;
     byte		numtics;
-    ticcmd_t		cmds[BACKUPTICS];
+    ticcmd_t		cmds[NETMAXCMDS];
 
 } doomdata_t;
 
@@ -110,7 +110,7 @@ typedef struct player_s
     boolean		backpack;
     
     // Frags, kills of other players.
-    int			frags[MAXPLAYERS];
+    int			frags[MAXNETPLAYERS];
     weapontype_t	readyweapon;
     
     // Is wp_nochange if not changing.
@@ -163,6 +163,9 @@ typedef struct player_s
     // True if secret level has been done.
     boolean		didsecret;	
 
+    // viewz at the start of the tic, for uncapped frames.
+    fixed_t		oldviewz;
+
 } player_t;
 
 
@@ -206,7 +209,7 @@ typedef struct
     // index of this player in game
     int		pnum;	
 
-    wbplayerstruct_t	plyr[MAXPLAYERS];
+    wbplayerstruct_t	plyr[MAXNETPLAYERS];
 
 } wbstartstruct_t;
 
@@ -104,19 +104,36 @@ typedef enum
 #define	SCREEN_MUL		1
 #define	INV_ASPECT_RATIO	0.625 // 0.75, ideally
 
-// Defines suck. C sucks.
-// C++ might sucks for OOP, but it sure is a better C.
-// So there.
-#define SCREENWIDTH  320
-//SCREEN_MUL*BASE_WIDTH //320
-#define SCREENHEIGHT 200
-//(int)(SCREEN_MUL*BASE_WIDTH*INV_ASPECT_RATIO) //200
+// The screen the status bar, menus and other
+//  2D graphics are laid out on.
+#define ORIGWIDTH	320
+#define ORIGHEIGHT	200
 
+// The screen is rendered at SCREENWIDTH x SCREENHEIGHT,
+//  set once at startup by -width and -height (see V_Init).
+// 2D graphics are scaled up to it.
+#define MAXSCREENWIDTH	7680
+#define MAXSCREENHEIGHT	4320
 
+extern int	SCREENWIDTH;
+extern int	SCREENHEIGHT;
 
 
-// The maximum number of players, multiplayer/networking.
-#define MAXPLAYERS		4
+
+
+// The players the status bar faces and colors, the
+//  intermission, the map starts and the classic demo
+//  and savegame headers are laid out for.
+#define ORIGPLAYERS		4
+
+// The player slots of the game, ORIGPLAYERS unless a
+//  net game has more players or gives -maxplayers,
+//  up to MAXNETPLAYERS (see D_CheckNetGame).
+// Monsters look through the slots in turn, so demos
+//  must be played with the count they were recorded with.
+#define MAXNETPLAYERS		64
+
+extern int	MAXPLAYERS;
 
 // State updates, number of tics / second.
 #define TICRATE		35
@@ -139,6 +139,14 @@ extern  boolean		viewactive;
 extern  boolean		nodrawers;
 extern  boolean		noblit;
 
+// Demo played with no display and no sound,
+//  ends with a state hash for checking.
+extern  boolean		fastdemo;
+
+// Frames are drawn as fast as possible, between two tics
+//  things and planes are interpolated.
+extern  boolean		uncapped;
+
 extern	int		viewwindowx;
 extern	int		viewwindowy;
 extern	int		viewheight;
@@ -209,10 +217,10 @@ extern	int		gametic;
 
 
 // Bookkeeping on players - state.
-extern	player_t	players[MAXPLAYERS];
+extern	player_t*	players;
 
 // Alive? Disconnected?
-extern  boolean		playeringame[MAXPLAYERS];
+extern  boolean*	playeringame;
 
 
 // Player spawn spots for deathmatch.
@@ -221,7 +229,7 @@ extern  mapthing_t      deathmatchstarts[MAX_DM_STARTS];
 extern  mapthing_t*	deathmatch_p;
 
 // Player spawn spots.
-extern  mapthing_t      playerstarts[MAXPLAYERS];
+extern  mapthing_t*     playerstarts;
 
 // Intermission stats.
 // Parameters for world map / intermission.
@@ -257,6 +265,9 @@ extern  int             mouseSensitivity;
 // debug flag to cancel adaptiveness
 extern  boolean         singletics;	
 
+#define	BODYQUESIZE	32
+
+extern  mobj_t*		bodyque[BODYQUESIZE];
 extern  int             bodyqueslot;
 
 
@@ -283,7 +294,7 @@ extern	int		rndindex;
 extern	int		maketic;
 extern  int             nettics[MAXNETNODES];
 
-extern  ticcmd_t        netcmds[MAXPLAYERS][BACKUPTICS];
+extern  ticcmd_t        (*netcmds)[BACKUPTICS];
 extern	int		ticdup;
 
 
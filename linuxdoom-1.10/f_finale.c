@@ -261,9 +261,8 @@ extern	patch_t *hu_font[HU_FONTSIZE];
 void F_TextWrite (void)
 {
     byte*	src;
-    byte*	dest;
     
-    int		x,y,w;
+    int		w;
     int		count;
     char*	ch;
     int		c;
@@ -272,23 +271,7 @@ void F_TextWrite (void)
     
     // erase the entire screen to a tiled background
     src = W_CacheLumpName ( finaleflat , PU_CACHE);
-    dest = screens[0];
-	
-    for (y=0 ; y<SCREENHEIGHT ; y++)
-    {
-	for (x=0 ; x<SCREENWIDTH/64 ; x++)
-	{
-	    memcpy (dest, src+((y&63)<<6), 64);
-	    dest += 64;
-	}
-	if (SCREENWIDTH&63)
-	{
-	    memcpy (dest, src+((y&63)<<6), SCREENWIDTH&63);
-	    dest += (SCREENWIDTH&63);
-	}
-    }
-
-    V_MarkRect (0, 0, SCREENWIDTH, SCREENHEIGHT);
+    V_TileFlat (src, 0, ORIGHEIGHT);
     
     // draw some of the text onto the screen
     cx = 10;
@@ -318,7 +301,7 @@ void F_TextWrite (void)
 	}
 		
 	w = SHORT (hu_font[c]->width);
-	if (cx+w > SCREENWIDTH)
+	if (cx+w > ORIGWIDTH)
 	    break;
 	V_DrawPatch(cx, cy, 0, hu_font[c]);
 	cx+=w;
@@ -605,6 +588,8 @@ void F_CastDrawer (void)
 
 //
 // F_DrawPatchCol
+// Draws a patch column into pixel column x,
+//  stretched down the screen.
 //
 void
 F_DrawPatchCol
@@ -616,7 +601,8 @@ F_DrawPatchCol
     byte*	source;
     byte*	dest;
     byte*	desttop;
-    int		count;
+    int		dy;
+    int		bottom;
 	
     column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
     desttop = screens[0]+x;
@@ -625,12 +611,13 @@ F_DrawPatchCol
     while (column->topdelta != 0xff )
     {
 	source = (byte *)column + 3;
-	dest = desttop + column->topdelta*SCREENWIDTH;
-	count = column->length;
+	dy = V_ScaleY (column->topdelta);
+	bottom = V_ScaleY (column->topdelta + column->length);
+	dest = desttop + dy*SCREENWIDTH;
 		
-	while (count--)
+	for ( ; dy<bottom ; dy++)
 	{
-	    *dest = *source++;
+	    *dest = source[dy*ORIGHEIGHT/SCREENHEIGHT - column->topdelta];
 	    dest += SCREENWIDTH;
 	}
 	column = (column_t *)(  (byte *)column + column->length + 4 );
@@ -645,6 +632,7 @@ void F_BunnyScroll (void)
 {
     int		scrolled;
     int		x;
+    int		col;
     patch_t*	p1;
     patch_t*	p2;
     char	name[10];
@@ -654,7 +642,7 @@ void F_BunnyScroll (void)
     p1 = W_CacheLumpName ("PFUB2", PU_LEVEL);
     p2 = W_CacheLumpName ("PFUB1", PU_LEVEL);
 
-    V_MarkRect (0, 0, SCREENWIDTH, SCREENHEIGHT);
+    V_MarkRect (0, 0, ORIGWIDTH, ORIGHEIGHT);
 	
     scrolled = 320 - (finalecount-230)/2;
     if (scrolled > 320)
@@ -664,18 +652,19 @@ void F_BunnyScroll (void)
 		
     for ( x=0 ; x<SCREENWIDTH ; x++)
     {
-	if (x+scrolled < 320)
-	    F_DrawPatchCol (x, p1, x+scrolled);
+	col = x*ORIGWIDTH/SCREENWIDTH + scrolled;
+	if (col < 320)
+	    F_DrawPatchCol (x, p1, col);
 	else
-	    F_DrawPatchCol (x, p2, x+scrolled - 320);		
+	    F_DrawPatchCol (x, p2, col - 320);		
     }
 	
     if (finalecount < 1130)
 	return;
     if (finalecount < 1180)
     {
-	V_DrawPatch ((SCREENWIDTH-13*8)/2,
-		     (SCREENHEIGHT-8*8)/2,0, W_CacheLumpName ("END0",PU_CACHE));
+	V_DrawPatch ((ORIGWIDTH-13*8)/2,
+		     (ORIGHEIGHT-8*8)/2,0, W_CacheLumpName ("END0",PU_CACHE));
 	laststage = 0;
 	return;
     }
@@ -690,7 +679,7 @@ void F_BunnyScroll (void)
     }
 	
     sprintf (name,"END%i",stage);
-    V_DrawPatch ((SCREENWIDTH-13*8)/2, (SCREENHEIGHT-8*8)/2,0, W_CacheLumpName (name,PU_CACHE));
+    V_DrawPatch ((ORIGWIDTH-13*8)/2, (ORIGHEIGHT-8*8)/2,0, W_CacheLumpName (name,PU_CACHE));
 }
 
 
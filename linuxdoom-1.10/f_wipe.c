@@ -144,6 +144,7 @@ wipe_initMelt
   int	ticks )
 {
     int i, r;
+    int	orig[ORIGWIDTH/2];
     
     // copy start screen to main screen
     memcpy(wipe_scr, wipe_scr_start, width*height);
@@ -155,16 +156,21 @@ wipe_initMelt
     
     // setup initial column positions
     // (y<0 => not ready to scroll yet)
-    y = (int *) Z_Malloc(width*sizeof(int), PU_STATIC, 0);
-    y[0] = -(M_Random()%16);
-    for (i=1;i<width;i++)
+    // The columns are laid out on the 2D screen
+    //  and spread over the pixel columns.
+    orig[0] = -(M_Random()%16);
+    for (i=1;i<ORIGWIDTH/2;i++)
     {
 	r = (M_Random()%3) - 1;
-	y[i] = y[i-1] + r;
-	if (y[i] > 0) y[i] = 0;
-	else if (y[i] == -16) y[i] = -15;
+	orig[i] = orig[i-1] + r;
+	if (orig[i] > 0) orig[i] = 0;
+	else if (orig[i] == -16) orig[i] = -15;
     }
 
+    y = (int *) Z_Malloc(width/2*sizeof(int), PU_STATIC, 0);
+    for (i=0;i<width/2;i++)
+	y[i] = orig[i*ORIGWIDTH/width];
+
     return 0;
 }
 
@@ -195,7 +201,9 @@ wipe_doMelt
 	    }
 	    else if (y[i] < height)
 	    {
-		dy = (y[i] < 16) ? y[i]+1 : 8;
+		// melt as fast as on the 2D screen
+		dy = y[i]*ORIGHEIGHT/SCREENHEIGHT;
+		dy = V_ScaleY ((dy < 16) ? dy+1 : 8);
 		if (y[i]+dy >= height) dy = height - y[i];
 		s = &((short *)wipe_scr_end)[i*height+y[i]];
 		d = &((short *)wipe_scr)[y[i]*width+i];
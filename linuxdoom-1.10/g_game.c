@@ -36,11 +36,13 @@ rcsid[] = "$Id: g_game.c,v 1.8 1997/02/03 22:45:09 b1 Exp $";
 #include "m_misc.h"
 #include "m_menu.h"
 #include "m_random.h"
+#include "m_bench.h"
 #include "i_system.h"
 
 #include "p_setup.h"
 #include "p_saveg.h"
 #include "p_tick.h"
+#include "p_snap.h"
 
 #include "d_main.h"
 
@@ -92,6 +94,7 @@ void	G_DoCompleted (void);
 void	G_DoVictory (void); 
 void	G_DoWorldDone (void); 
 void	G_DoSaveGame (void); 
+void	G_SnapCheck (void); 
  
  
 gameaction_t    gameaction; 
@@ -109,14 +112,23 @@ boolean         usergame;               // ok to save / end game
 boolean         timingdemo;             // if true, exit with report on completion 
 boolean         nodrawers;              // for comparative timing purposes 
 boolean         noblit;                 // for comparative timing purposes 
+boolean         fastdemo;               // no display or sound, hash at the end 
+unsigned        faststarttime;          // I_GetTimeUS at fast demo start 
+static int      snapchecklen;           // -snapcheck: tics between rewinds 
+static snapshot_t snapcheck;            // level at snapchecktic 
+static int      snapchecktic = -1;      // -1 when no snapshot is pending 
+static unsigned snapcheckhash;          // first run's hash at the end 
+static boolean  snapreplay;             // running the tics a second time 
+static int      snapchecks;             // rewinds that matched 
 int             starttime;          	// for comparative timing purposes  	 
  
 boolean         viewactive; 
  
 boolean         deathmatch;           	// only if started as net death 
 boolean         netgame;                // only true if packets are broadcast 
-boolean         playeringame[MAXPLAYERS]; 
-player_t        players[MAXPLAYERS]; 
+boolean*        playeringame; 
+player_t*       players; 
+int             MAXPLAYERS = ORIGPLAYERS;
  
 int             consoleplayer;          // player taking events and displaying 
 int             displayplayer;          // view being displayed 
@@ -137,7 +149,7 @@ boolean         precache = true;        // if true, load all graphics at start
  
 wbstartstruct_t wminfo;               	// parms for world map / intermission 
  
-short		consistancy[MAXPLAYERS][BACKUPTICS]; 
+short		(*consistancy)[BACKUPTICS]; 
  
 byte*		savebuffer;
  
@@ -207,7 +219,6 @@ int		savegameslot;
 char		savedescription[32]; 
  
  
-#define	BODYQUESIZE	32
 
 mobj_t*		bodyque[BODYQUESIZE]; 
 int		bodyqueslot; 
@@ -437,6 +448,24 @@ void G_BuildTiccmd (ticcmd_t* cmd)
 } 
  
 
+//
+// G_InitPlayers
+// Sizes the player tables once MAXPLAYERS is known.
+//
+void G_InitPlayers (void)
+{
+    players = Z_Malloc (MAXPLAYERS*sizeof(*players), PU_STATIC, 0);
+    playeringame = Z_Malloc (MAXPLAYERS*sizeof(*playeringame), PU_STATIC, 0);
+    consistancy = Z_Malloc (MAXPLAYERS*sizeof(*consistancy), PU_STATIC, 0);
+    playerstarts = Z_Malloc (MAXPLAYERS*sizeof(*playerstarts), PU_STATIC, 0);
+    
+    memset (players, 0, MAXPLAYERS*sizeof(*players));
+    memset (playeringame, 0, MAXPLAYERS*sizeof(*playeringame));
+    memset (consistancy, 0, MAXPLAYERS*sizeof(*consistancy));
+    memset (playerstarts, 0, MAXPLAYERS*sizeof(*playerstarts));
+}
+
+
 //
 // G_DoLoadLevel 
 //
@@ -446,6 +475,11 @@ void G_DoLoadLevel (void)
 { 
     int             i; 
 
+    // a snapshot of the old level is no use
+    if (snapreplay)
+	I_Error ("G_DoLoadLevel: snapshot replay left the level");
+    snapchecktic = -1;
+
     // Set the sky map.
     // First thing, we have a dummy sky texture name,
     //  a flat. The data is in the WAD only because
@@ -650,6 +684,10 @@ void G_Ticker (void)
 	    break; 
 	} 
     }
+
+    // -snapcheck rewinds the level before the tic runs
+    if (snapchecklen)
+	G_SnapCheck ();
     
     // get commands, check consistancy,
     // and build new consistancy check
@@ -727,7 +765,9 @@ void G_Ticker (void)
     switch (gamestate) 
     { 
       case GS_LEVEL: 
+	M_BenchBegin (bs_ticker);
 	P_Ticker (); 
+	M_BenchEnd (bs_ticker);
 	ST_Ticker (); 
 	AM_Ticker (); 
 	HU_Ticker ();            
@@ -801,7 +841,7 @@ void G_PlayerReborn (int player)
 { 
     player_t*	p; 
     int		i; 
-    int		frags[MAXPLAYERS]; 
+    int		frags[MAXNETPLAYERS]; 
     int		killcount;
     int		itemcount;
     int		secretcount; 
@@ -856,7 +896,8 @@ G_CheckSpot
     {
 	// first spawn of level, before corpses
 	for (i=0 ; i<playernum ; i++)
-	    if (players[i].mo->x == mthing->x << FRACBITS
+	    if (playeringame[i]
+		&& players[i].mo->x == mthing->x << FRACBITS
 		&& players[i].mo->y == mthing->y << FRACBITS)
 		return false;	
 	return true;
@@ -918,6 +959,37 @@ void G_DeathMatchSpawnPlayer (int playernum)
     P_SpawnPlayer (&playerstarts[playernum]); 
 } 
 
+
+//
+// G_ExtraSpawnPlayer
+// Maps have starts for ORIGPLAYERS players only. Players
+// past them take the first free deathmatch spot or player
+// start for the level, or keep the copy of a player start
+// P_SetupLevel gave them.
+//
+void G_ExtraSpawnPlayer (int playernum) 
+{ 
+    int		i;
+    
+    for (i=0 ; i<deathmatch_p - deathmatchstarts ; i++)
+	if (G_CheckSpot (playernum, &deathmatchstarts[i]))
+	{
+	    playerstarts[playernum] = deathmatchstarts[i];
+	    break;
+	}
+    
+    if (i == deathmatch_p - deathmatchstarts)
+	for (i=0 ; i<ORIGPLAYERS ; i++)
+	    if (G_CheckSpot (playernum, &playerstarts[i]))
+	    {
+		playerstarts[playernum] = playerstarts[i];
+		break;
+	    }
+    
+    playerstarts[playernum].type = playernum+1;
+    P_SpawnPlayer (&playerstarts[playernum]); 
+} 
+
 //
 // G_DoReborn 
 // 
@@ -951,7 +1023,7 @@ void G_DoReborn (int playernum)
 	}
 	
 	// try to spawn at one of the other players spots 
-	for (i=0 ; i<MAXPLAYERS ; i++)
+	for (i=0 ; i<ORIGPLAYERS ; i++)
 	{
 	    if (G_CheckSpot (playernum, &playerstarts[i]) ) 
 	    { 
@@ -1197,13 +1269,19 @@ void G_LoadGame (char* name)
  
 #define VERSIONSIZE		16 
 
+// Demo and savegame version for more than ORIGPLAYERS slots,
+//  followed by the slot count.
+#define WIDEVERSION		(VERSION|0x80)
+
 
 void G_DoLoadGame (void) 
 { 
     int		length; 
     int		i; 
     int		a,b,c; 
+    int		slots;
     char	vcheck[VERSIONSIZE]; 
+    static char	loaderror[80];
 	 
     gameaction = ga_nothing; 
 	 
@@ -1212,10 +1290,23 @@ void G_DoLoadGame (void)
     
     // skip the description field 
     memset (vcheck,0,sizeof(vcheck)); 
-    sprintf (vcheck,"version %i",VERSION); 
+    sprintf (vcheck,"version %i",WIDEVERSION); 
     if (strcmp (save_p, vcheck)) 
-	return;				// bad version 
+    {
+	// includes every save from before the slot count
+	sprintf (loaderror, "savegame is from a different game version");
+	goto failed;
+    }
     save_p += VERSIONSIZE; 
+
+    // player_t and the playeringame bytes are sized by it
+    slots = *save_p++;
+    if (slots != MAXPLAYERS)
+    {
+	sprintf (loaderror, "savegame has %i player slots, "
+		 "load it with -maxplayers %i", slots, slots);
+	goto failed;
+    }
 			 
     gameskill = *save_p++; 
     gameepisode = *save_p++; 
@@ -1249,6 +1340,12 @@ void G_DoLoadGame (void)
     
     // draw the pattern into the back screen
     R_FillBackScreen ();   
+    return;
+
+  failed:
+    Z_Free (savebuffer);
+    fprintf (stderr, "G_DoLoadGame: %s\n", loaderror);
+    players[consoleplayer].message = loaderror;
 } 
  
 
@@ -1286,9 +1383,10 @@ void G_DoSaveGame (void)
     memcpy (save_p, description, SAVESTRINGSIZE); 
     save_p += SAVESTRINGSIZE; 
     memset (name2,0,sizeof(name2)); 
-    sprintf (name2,"version %i",VERSION); 
+    sprintf (name2,"version %i",WIDEVERSION); 
     memcpy (save_p, name2, VERSIONSIZE); 
     save_p += VERSIONSIZE; 
+    *save_p++ = MAXPLAYERS;
 	 
     *save_p++ = gameskill; 
     *save_p++ = gameepisode; 
@@ -1552,7 +1650,14 @@ void G_BeginRecording (void)
 		
     demo_p = demobuffer;
 	
-    *demo_p++ = VERSION;
+    // more player slots need a wider header
+    if (MAXPLAYERS == ORIGPLAYERS)
+	*demo_p++ = VERSION;
+    else
+    {
+	*demo_p++ = WIDEVERSION;
+	*demo_p++ = MAXPLAYERS;
+    }
     *demo_p++ = gameskill; 
     *demo_p++ = gameepisode; 
     *demo_p++ = gamemap; 
@@ -1583,16 +1688,29 @@ void G_DoPlayDemo (void)
 { 
     skill_t skill; 
     int             i, episode, map; 
+    int             version, slots;
 	 
     gameaction = ga_nothing; 
     demobuffer = demo_p = W_CacheLumpName (defdemoname, PU_STATIC); 
-    if ( *demo_p++ != VERSION)
+    version = *demo_p++;
+    if ( version != VERSION && version != WIDEVERSION)
     {
       fprintf( stderr, "Demo is from a different game version!\n");
       gameaction = ga_nothing;
       return;
     }
     
+    slots = ORIGPLAYERS;
+    if (version == WIDEVERSION)
+	slots = *demo_p++;
+    if (slots != MAXPLAYERS)
+    {
+      fprintf( stderr, "Demo has %i player slots, play it with -maxplayers %i\n",
+	       slots, slots);
+      gameaction = ga_nothing;
+      return;
+    }
+    
     skill = *demo_p++; 
     episode = *demo_p++; 
     map = *demo_p++; 
@@ -1617,6 +1735,7 @@ void G_DoPlayDemo (void)
 
     usergame = false; 
     demoplayback = true; 
+    faststarttime = I_GetTimeUS ();
 } 
 
 //
@@ -1624,14 +1743,237 @@ void G_DoPlayDemo (void)
 //
 void G_TimeDemo (char* name) 
 { 	 
-    nodrawers = M_CheckParm ("-nodraw"); 
-    noblit = M_CheckParm ("-noblit"); 
+    int		p;
+    
+    nodrawers = fastdemo || M_CheckParm ("-nodraw"); 
+    noblit = fastdemo || M_CheckParm ("-noblit"); 
     timingdemo = true; 
     singletics = true; 
 
+    // per frame subsystem timings
+    p = M_CheckParm ("-bench");
+    if (p && p < myargc-1)
+	M_BenchInit (myargv[p+1]);
+
     defdemoname = name; 
     gameaction = ga_playdemo; 
 } 
+
+
+//
+// G_FastDemo
+// A timedemo that runs the tics as fast as they go,
+// for checking demos still play back the same.
+//
+void G_FastDemo (char* name) 
+{
+    int		p;
+    
+    fastdemo = true;
+
+    // rewind every so many tics and check the replay
+    p = M_CheckParm ("-snapcheck");
+    if (p && p < myargc-1)
+    {
+	snapchecklen = atoi (myargv[p+1]);
+	if (snapchecklen < 1)
+	    I_Error ("G_FastDemo: bad -snapcheck %s", myargv[p+1]);
+    }
+    G_TimeDemo (name);
+}
+
+
+//
+// G_HashInt
+// FNV-1a over the bytes of an int.
+//
+static unsigned G_HashInt (unsigned hash, int value)
+{
+    int		i;
+
+    for (i=0 ; i<4 ; i++)
+    {
+	hash ^= (value >> (i*8)) & 0xff;
+	hash *= 16777619;
+    }
+    return hash;
+}
+
+
+//
+// G_StateHash
+// Sums up the end state of a demo.
+//
+static unsigned G_StateHash (void)
+{
+    unsigned	hash;
+    player_t*	player;
+    int		i;
+
+    hash = 2166136261u;
+    hash = G_HashInt (hash, gametic);
+    hash = G_HashInt (hash, leveltime);
+    hash = G_HashInt (hash, prndindex);
+    hash = G_HashInt (hash, totalkills);
+    hash = G_HashInt (hash, totalitems);
+    hash = G_HashInt (hash, totalsecret);
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+	if (!playeringame[i])
+	    continue;
+
+	player = &players[i];
+	hash = G_HashInt (hash, player->health);
+	hash = G_HashInt (hash, player->armorpoints);
+	hash = G_HashInt (hash, player->killcount);
+	hash = G_HashInt (hash, player->itemcount);
+	hash = G_HashInt (hash, player->secretcount);
+	
+	if (!player->mo)
+	    continue;
+	hash = G_HashInt (hash, player->mo->x);
+	hash = G_HashInt (hash, player->mo->y);
+	hash = G_HashInt (hash, player->mo->z);
+	hash = G_HashInt (hash, player->mo->angle);
+	hash = G_HashInt (hash, player->mo->health);
+    }
+
+    return hash;
+}
+
+
+//
+// G_SnapHash
+// The state hash, plus every mobj and sector,
+//  so a bad restore can't hide away from the players.
+//
+static unsigned G_SnapHash (void)
+{
+    unsigned	hash;
+    thinker_t*	th;
+    mobj_t*	mo;
+    sector_t*	sec;
+    int		i;
+
+    hash = G_StateHash ();
+
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+    {
+	if (th->function.acp1 != (actionf_p1)P_MobjThinker)
+	    continue;
+
+	mo = (mobj_t *)th;
+	hash = G_HashInt (hash, mo->type);
+	hash = G_HashInt (hash, mo->x);
+	hash = G_HashInt (hash, mo->y);
+	hash = G_HashInt (hash, mo->z);
+	hash = G_HashInt (hash, mo->momx);
+	hash = G_HashInt (hash, mo->momy);
+	hash = G_HashInt (hash, mo->momz);
+	hash = G_HashInt (hash, mo->angle);
+	hash = G_HashInt (hash, mo->health);
+	hash = G_HashInt (hash, mo->tics);
+	hash = G_HashInt (hash, mo->state - states);
+	hash = G_HashInt (hash, mo->flags);
+	hash = G_HashInt (hash, mo->movecount);
+	hash = G_HashInt (hash, mo->reactiontime);
+    }
+
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+	hash = G_HashInt (hash, sec->floorheight);
+	hash = G_HashInt (hash, sec->ceilingheight);
+	hash = G_HashInt (hash, sec->lightlevel);
+	hash = G_HashInt (hash, sec->soundtarget != NULL);
+    }
+
+    return hash;
+}
+
+
+//
+// G_SnapCheck
+// With -snapcheck, each stretch of snapchecklen tics is run
+//  twice: once from a snapshot taken at its start, then again
+//  after restoring that snapshot and rewinding the clock.
+// Both runs must end in the same state.
+//
+void G_SnapCheck (void)
+{
+    if (gamestate != GS_LEVEL || !demoplayback)
+    {
+	if (snapreplay)
+	    I_Error ("G_SnapCheck: snapshot replay left the level");
+	snapchecktic = -1;
+	return;
+    }
+
+    if (snapchecktic != -1
+	&& gametic == snapchecktic + snapchecklen)
+    {
+	if (!snapreplay)
+	{
+	    snapcheckhash = G_SnapHash ();
+	    if (!P_RestoreSnapshot (&snapcheck))
+		I_Error ("G_SnapCheck: snapshot from tic %i didn't restore",
+			 snapchecktic);
+	    // the netcmds slots are refilled from the demo
+	    gametic = maketic = snapchecktic;
+	    snapreplay = true;
+	    return;
+	}
+
+	if (G_SnapHash () != snapcheckhash)
+	    I_Error ("G_SnapCheck: tics %i to %i went differently "
+		     "after the rewind", snapchecktic, gametic);
+	snapreplay = false;
+	snapchecks++;
+	snapchecktic = -1;
+    }
+
+    if (snapchecktic == -1)
+    {
+	P_TakeSnapshot (&snapcheck);
+	snapchecktic = gametic;
+    }
+}
+
+
+//
+// G_FastDemoReport
+//
+static void G_FastDemoReport (void)
+{
+    unsigned	us;
+    int		i;
+
+    us = I_GetTimeUS () - faststarttime;
+    if (!us)
+	us = 1;
+
+    printf ("fastdemo: %i gametics in %u.%03u s, %.1f tics/s\n",
+	    gametic, us/1000000, (us/1000)%1000,
+	    gametic*1000000.0/us);
+
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+	if (!playeringame[i] || !players[i].mo)
+	    continue;
+	printf ("player %i: x %i y %i z %i health %i kills %i\n",
+		i+1,
+		players[i].mo->x>>FRACBITS,
+		players[i].mo->y>>FRACBITS,
+		players[i].mo->z>>FRACBITS,
+		players[i].health,
+		players[i].killcount);
+    }
+    printf ("leveltime %i prndindex %i\n", leveltime, prndindex);
+    printf ("hash %08x\n", G_StateHash ());
+    if (snapchecklen)
+	printf ("snapcheck: %i rewinds of %i tics matched\n",
+		snapchecks, snapchecklen);
+}
  
  
 /* 
@@ -1651,6 +1993,17 @@ boolean G_CheckDemoStatus (void)
     if (timingdemo) 
     { 
 	endtime = I_GetTime (); 
+	if (fastdemo)
+	    G_FastDemoReport ();
+	if (benchmarking)
+	{
+	    printf ("timed %i gametics in %i realtics\n",gametic
+		    , endtime-starttime);
+	    M_BenchReport ();
+	}
+	// clean exit, so scripts can check the status
+	if (fastdemo || benchmarking)
+	    I_Quit ();
 	I_Error ("timed %i gametics in %i realtics",gametic 
 		 , endtime-starttime); 
     } 
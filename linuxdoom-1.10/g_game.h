@@ -32,6 +32,10 @@
 // GAME
 //
 void G_DeathMatchSpawnPlayer (int playernum);
+void G_ExtraSpawnPlayer (int playernum);
+
+// Called by D_CheckNetGame once MAXPLAYERS is set.
+void G_InitPlayers (void);
 
 void G_InitNew (skill_t skill, int episode, int map);
 
@@ -58,6 +62,7 @@ void G_BeginRecording (void);
 
 void G_PlayDemo (char* name);
 void G_TimeDemo (char* name);
+void G_FastDemo (char* name);
 boolean G_CheckDemoStatus (void);
 
 void G_ExitLevel (void);
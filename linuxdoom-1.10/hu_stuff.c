@@ -92,8 +92,8 @@ static hu_textline_t	w_title;
 boolean			chat_on;
 static hu_itext_t	w_chat;
 static boolean		always_off = false;
-static char		chat_dest[MAXPLAYERS];
-static hu_itext_t w_inputbuffer[MAXPLAYERS];
+static char		chat_dest[MAXNETPLAYERS];
+static hu_itext_t w_inputbuffer[MAXNETPLAYERS];
 
 static boolean		message_on;
 boolean			message_dontfuckwithme;
@@ -507,6 +507,8 @@ void HU_Ticker(void)
 
     int i, rc;
     char c;
+    char* name;
+    char playername[32];
 
     // tick down message counter if message is up
     if (message_counter && !--message_counter)
@@ -555,8 +557,17 @@ void HU_Ticker(void)
 			    && (chat_dest[i] == consoleplayer+1
 				|| chat_dest[i] == HU_BROADCAST))
 			{
+			    // only the first players have colors
+			    if (i < ORIGPLAYERS)
+				name = player_names[i];
+			    else
+			    {
+				snprintf (playername, sizeof(playername),
+					  "Player %i: ", i+1);
+				name = playername;
+			    }
 			    HUlib_addMessageToSText(&w_message,
-						    player_names[i],
+						    name,
 						    w_inputbuffer[i].l.l);
 			    
 			    message_nottobefuckedwith = true;
@@ -626,7 +637,7 @@ boolean HU_Responder(event_t *ev)
     int			i;
     int			numplayers;
     
-    static char		destination_keys[MAXPLAYERS] =
+    static char		destination_keys[ORIGPLAYERS] =
     {
 	HUSTR_KEYGREEN,
 	HUSTR_KEYINDIGO,
@@ -670,7 +681,7 @@ boolean HU_Responder(event_t *ev)
 	}
 	else if (netgame && numplayers > 2)
 	{
-	    for (i=0; i<MAXPLAYERS ; i++)
+	    for (i=0; i<ORIGPLAYERS ; i++)
 	    {
 		if (ev->data1 == destination_keys[i])
 		{
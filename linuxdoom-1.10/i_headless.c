@@ -0,0 +1,131 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Headless graphics stub, no X display needed.
+//	Refresh still draws into screens[0], nothing
+//	is ever blitted. Link this instead of i_video.c
+//	for timedemo/benchmark runs on boxes w/o X.
+//
+//-----------------------------------------------------------------------------
+
+static const char
+rcsid[] = "$Id: i_headless.c,v 1.0 1997/12/23 12:00:00 b1 Exp $";
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "v_video.h"
+#include "m_argv.h"
+#include "d_main.h"
+
+#include "doomdef.h"
+
+#ifdef __GNUG__
+#pragma implementation "i_video.h"
+#endif
+#include "i_video.h"
+
+
+// Current palette, gamma corrected,
+//  kept for anybody who wants to dump frames.
+byte		headlesspal[256*3];
+
+
+void I_ShutdownGraphics(void)
+{
+}
+
+
+//
+// I_StartFrame
+//
+void I_StartFrame (void)
+{
+}
+
+
+//
+// I_StartTic
+// No input device, so no events.
+//
+void I_StartTic (void)
+{
+}
+
+
+//
+// I_UpdateNoBlit
+//
+void I_UpdateNoBlit (void)
+{
+}
+
+
+//
+// I_FinishUpdate
+// The frame is complete in screens[0],
+//  there is nothing to copy it to.
+//
+void I_FinishUpdate (void)
+{
+}
+
+
+//
+// I_ReadScreen
+//
+void I_ReadScreen (byte* scr)
+{
+    memcpy (scr, screens[0], SCREENWIDTH*SCREENHEIGHT);
+}
+
+
+//
+// I_SetPalette
+//
+void I_SetPalette (byte* palette)
+{
+    int		i;
+
+    for (i=0 ; i<256*3 ; i++)
+	headlesspal[i] = gammatable[usegamma][*palette++];
+}
+
+
+//
+// I_InitGraphics
+// screens[0] is left as allocated by V_Init.
+//
+void I_InitGraphics(void)
+{
+    static int		firsttime=1;
+
+    if (!firsttime)
+	return;
+    firsttime = 0;
+
+    signal(SIGINT, (void (*)(int)) I_Quit);
+
+    printf ("I_InitGraphics: headless, %ix%i\n",
+	    SCREENWIDTH, SCREENHEIGHT);
+}
@@ -23,9 +23,14 @@
 static const char
 rcsid[] = "$Id: m_bbox.c,v 1.1 1997/02/03 22:45:10 b1 Exp $";
 
+#ifdef LINUX
+#define _GNU_SOURCE		// sendmmsg, recvmmsg
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stddef.h>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -34,6 +39,12 @@ rcsid[] = "$Id: m_bbox.c,v 1.1 1997/02/03 22:45:10 b1 Exp $";
 #include <unistd.h>
 #include <netdb.h>
 #include <sys/ioctl.h>
+#ifdef LINUX
+#include <pthread.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 
 #include "i_system.h"
 #include "d_event.h"
@@ -82,6 +93,57 @@ struct	sockaddr_in	sendaddress[MAXNETNODES];
 
 void	(*netget) (void);
 void	(*netsend) (void);
+void	(*netflush) (void);
+
+boolean		netthread;		// -netthread receives
+
+
+//
+// WIRE FORMAT
+// Packets start with NETMAGIC, which holds NETPROTOCOL,
+//  then the checksum's high byte, the rest of it as a
+//  varint, retransmitfrom if NCMD_RETRANSMIT is set,
+//  and the starttic, player and numtics bytes.
+// Each ticcmd (numtics of them, or numtics for each of
+//  the player slots in an NCMD_RELAY packet) follows as
+//  a byte of the fields that differ from the one before
+//  it (the first is compared against an empty ticcmd)
+//  and the new values of those fields.
+//  angleturn and consistancy are sent as zigzag varint
+//  differences, so a turn or step costs a byte or two.
+// Setup packets keep the old doomdata_t layout, so that
+//  old peers can read the version in them and refuse.
+//
+#define NETMAGIC	(0xd0|NETPROTOCOL)
+
+// Length of a doomdata_t holding n ticcmds.
+#define DATALENGTH(n) \
+	((int)(offsetof(doomdata_t, cmds) + (n)*sizeof(ticcmd_t)))
+
+#define TC_FORWARD	1
+#define TC_SIDE		2
+#define TC_ANGLE	4
+#define TC_CONSIST	8
+#define TC_CHAT		16
+#define TC_BUTTONS	32
+
+// Larger than any encoded or old doomdata_t packet,
+//  a ticcmd takes at most 11 bytes.
+#define NETPACKETSIZE	(16 + 11*NETMAXCMDS)
+
+// Packets sent or received in one call.
+#define NETBATCH	16
+
+byte		sendbuf[NETBATCH][NETPACKETSIZE];
+int		sendlen[NETBATCH];
+int		sendnode[NETBATCH];
+int		numsend;
+
+byte		recvbuf[NETBATCH][NETPACKETSIZE];
+int		recvlen[NETBATCH];
+struct	sockaddr_in	recvaddress[NETBATCH];
+int		numrecv;
+int		recvon;
 
 
 //
@@ -122,9 +184,227 @@ BindToLocalPort
 
 
 //
-// PacketSend
+// NetPutVarint
+// Seven bits a byte, low bits first,
+//  the high bit set on all but the last.
 //
-void PacketSend (void)
+static byte* NetPutVarint (byte* p, unsigned v)
+{
+    while (v >= 0x80)
+    {
+	*p++ = (v & 0x7f) | 0x80;
+	v >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+//
+// NetGetVarint
+// Returns NULL if the packet ends inside it.
+//
+static byte* NetGetVarint (byte* p, byte* end, unsigned* v)
+{
+    int		shift;
+
+    *v = 0;
+    for (shift = 0 ; p < end && shift < 32 ; shift += 7)
+    {
+	*v |= (*p & 0x7f) << shift;
+	if (!(*p++ & 0x80))
+	    return p;
+    }
+    return NULL;
+}
+
+
+// Small differences of either sign map to small numbers.
+#define ZIGZAG(d)	((((d)<<1) ^ ((d)>>15)) & 0xffff)
+#define UNZIGZAG(z)	((short)(((z)>>1) ^ -(int)((z)&1)))
+
+
+//
+// PacketCmds
+// How many ticcmds a doomdata_t holds.
+//
+static int PacketCmds (doomdata_t* data)
+{
+    if (data->checksum & NCMD_RELAY)
+	return data->numtics * data->player;
+    return data->numtics;
+}
+
+
+//
+// PacketEncode
+// Writes netbuffer in the wire format, returns the length.
+//
+static int PacketEncode (byte* buf)
+{
+    byte*	p;
+    byte*	mask;
+    ticcmd_t	prev;
+    ticcmd_t*	cmd;
+    int		numcmds;
+    int		d;
+    int		c;
+
+    p = buf;
+    *p++ = NETMAGIC;
+    *p++ = netbuffer->checksum >> 24;
+    p = NetPutVarint (p, netbuffer->checksum & 0xffffff);
+    if (netbuffer->checksum & NCMD_RETRANSMIT)
+	*p++ = netbuffer->retransmitfrom;
+    *p++ = netbuffer->starttic;
+    *p++ = netbuffer->player;
+    *p++ = netbuffer->numtics;
+
+    numcmds = PacketCmds (netbuffer);
+    memset (&prev, 0, sizeof(prev));
+    for (c=0 ; c<numcmds ; c++)
+    {
+	cmd = &netbuffer->cmds[c];
+	mask = p++;
+	*mask = 0;
+	if (cmd->forwardmove != prev.forwardmove)
+	{
+	    *mask |= TC_FORWARD;
+	    *p++ = cmd->forwardmove;
+	}
+	if (cmd->sidemove != prev.sidemove)
+	{
+	    *mask |= TC_SIDE;
+	    *p++ = cmd->sidemove;
+	}
+	if (cmd->angleturn != prev.angleturn)
+	{
+	    *mask |= TC_ANGLE;
+	    d = (short)(cmd->angleturn - prev.angleturn);
+	    p = NetPutVarint (p, ZIGZAG(d));
+	}
+	if (cmd->consistancy != prev.consistancy)
+	{
+	    *mask |= TC_CONSIST;
+	    d = (short)(cmd->consistancy - prev.consistancy);
+	    p = NetPutVarint (p, ZIGZAG(d));
+	}
+	if (cmd->chatchar != prev.chatchar)
+	{
+	    *mask |= TC_CHAT;
+	    *p++ = cmd->chatchar;
+	}
+	if (cmd->buttons != prev.buttons)
+	{
+	    *mask |= TC_BUTTONS;
+	    *p++ = cmd->buttons;
+	}
+	prev = *cmd;
+    }
+    return p - buf;
+}
+
+
+//
+// PacketDecode
+// Reads a wire format packet into data,
+//  returns false if it is malformed.
+//
+static boolean
+PacketDecode
+( doomdata_t*	data,
+  byte*		p,
+  int		len )
+{
+    byte*	end;
+    ticcmd_t	prev;
+    ticcmd_t*	cmd;
+    unsigned	v;
+    int		mask;
+    int		numcmds;
+    int		c;
+
+    end = p + len;
+    if (len < 6)
+	return false;
+    p++;
+    data->checksum = *p++ << 24;
+    if ( !(p = NetGetVarint (p, end, &v)) )
+	return false;
+    // only the high byte carries NCMD_* flags
+    if (v > (NCMD_CHECKSUM & 0xffffff))
+	return false;
+    data->checksum |= v;
+    data->retransmitfrom = 0;
+    if (data->checksum & NCMD_RETRANSMIT)
+    {
+	if (p == end)
+	    return false;
+	data->retransmitfrom = *p++;
+    }
+    if (end - p < 3)
+	return false;
+    data->starttic = *p++;
+    data->player = *p++;
+    data->numtics = *p++;
+    numcmds = PacketCmds (data);
+    if (data->numtics > BACKUPTICS || numcmds > NETMAXCMDS)
+	return false;
+
+    memset (&prev, 0, sizeof(prev));
+    for (c=0 ; c<numcmds ; c++)
+    {
+	cmd = &data->cmds[c];
+	*cmd = prev;
+	if (p == end)
+	    return false;
+	mask = *p++;
+	if (mask & TC_FORWARD)
+	{
+	    if (p == end)
+		return false;
+	    cmd->forwardmove = *p++;
+	}
+	if (mask & TC_SIDE)
+	{
+	    if (p == end)
+		return false;
+	    cmd->sidemove = *p++;
+	}
+	if (mask & TC_ANGLE)
+	{
+	    if ( !(p = NetGetVarint (p, end, &v)) )
+		return false;
+	    cmd->angleturn = prev.angleturn + UNZIGZAG(v);
+	}
+	if (mask & TC_CONSIST)
+	{
+	    if ( !(p = NetGetVarint (p, end, &v)) )
+		return false;
+	    cmd->consistancy = prev.consistancy + UNZIGZAG(v);
+	}
+	if (mask & TC_CHAT)
+	{
+	    if (p == end)
+		return false;
+	    cmd->chatchar = *p++;
+	}
+	if (mask & TC_BUTTONS)
+	{
+	    if (p == end)
+		return false;
+	    cmd->buttons = *p++;
+	}
+	prev = *cmd;
+    }
+    return p == end;
+}
+
+
+//
+// PacketEncodeOld
+// Writes netbuffer as a byte swapped doomdata_t.
+//
+static int PacketEncodeOld (byte* buf)
 {
     int		c;
     doomdata_t	sw;
@@ -144,77 +424,647 @@ void PacketSend (void)
 	sw.cmds[c].chatchar = netbuffer->cmds[c].chatchar;
 	sw.cmds[c].buttons = netbuffer->cmds[c].buttons;
     }
-		
-    //printf ("sending %i\n",gametic);		
-    c = sendto (sendsocket , &sw, doomcom->datalength
-		,0,(void *)&sendaddress[doomcom->remotenode]
-		,sizeof(sendaddress[doomcom->remotenode]));
+
+    memcpy (buf, &sw, doomcom->datalength);
+    return doomcom->datalength;
+}
+
+
+//
+// PacketDecodeOld
+// Reads a byte swapped doomdata_t into data.
+//
+static boolean
+PacketDecodeOld
+( doomdata_t*	data,
+  byte*		buf,
+  int		len )
+{
+    int		c;
+    doomdata_t	sw;
+
+    if (len < DATALENGTH(0)
+	|| len > sizeof(sw))
+	return false;
+    memcpy (&sw, buf, len);
 	
-    //	if (c == -1)
-    //		I_Error ("SendPacket error: %s",strerror(errno));
+    // byte swap
+    data->checksum = ntohl(sw.checksum);
+    data->player = sw.player;
+    data->retransmitfrom = sw.retransmitfrom;
+    data->starttic = sw.starttic;
+    data->numtics = sw.numtics;
+    if (data->numtics > BACKUPTICS)
+	return false;
+
+    for (c=0 ; c< data->numtics ; c++)
+    {
+	data->cmds[c].forwardmove = sw.cmds[c].forwardmove;
+	data->cmds[c].sidemove = sw.cmds[c].sidemove;
+	data->cmds[c].angleturn = ntohs(sw.cmds[c].angleturn);
+	data->cmds[c].consistancy = ntohs(sw.cmds[c].consistancy);
+	data->cmds[c].chatchar = sw.cmds[c].chatchar;
+	data->cmds[c].buttons = sw.cmds[c].buttons;
+    }
+    return true;
 }
 
 
 //
-// PacketGet
+// PING
+// The network layer times each link itself.  A NETPING
+//  carries the sender's I_GetTimeUS, which the other end
+//  sends straight back in a NETPONG.
 //
-void PacketGet (void)
+#define NETPING		0xe0
+#define NETPONG		0xe1
+#define NETPINGSIZE	5
+
+static netnode_t	netnodes[MAXNETNODES];
+
+// When the last pings went.  Only the thread that
+//  sends the pings touches it.
+static unsigned	netpingtime;
+
+
+//
+// NetNodeBegin, NetNodeEnd
+// Bracket a change to a node's counters.  The network
+//  thread makes them while the main thread reads, so
+//  the counters are stored with __atomic, and the
+//  sequence is odd during the change so I_NetNodeStats
+//  can tell a mixed read and retry.  There is only ever
+//  one writer: the thread, or the main loop without it.
+//
+#define NETSTORE(field, value) \
+	__atomic_store_n (&(field), (value), __ATOMIC_RELAXED)
+
+static void NetNodeBegin (netnode_t* n)
+{
+    NETSTORE (n->sequence, n->sequence+1);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+static void NetNodeEnd (netnode_t* n)
+{
+    __atomic_store_n (&n->sequence, n->sequence+1, __ATOMIC_RELEASE);
+}
+
+static void
+NetNodeCount
+( netnode_t*	n,
+  int*		counter )
+{
+    NetNodeBegin (n);
+    NETSTORE (*counter, *counter+1);
+    NetNodeEnd (n);
+}
+
+
+//
+// I_NetNodeStats
+// Copies the counters of a node as of one moment.
+//
+void
+I_NetNodeStats
+( int		node,
+  netnode_t*	copy )
+{
+    netnode_t*	n;
+    unsigned	sequence;
+
+    n = &netnodes[node];
+    do
+    {
+	sequence = __atomic_load_n (&n->sequence, __ATOMIC_ACQUIRE);
+	copy->rtt = __atomic_load_n (&n->rtt, __ATOMIC_RELAXED);
+	copy->jitter = __atomic_load_n (&n->jitter, __ATOMIC_RELAXED);
+	copy->pings = __atomic_load_n (&n->pings, __ATOMIC_RELAXED);
+	copy->pongs = __atomic_load_n (&n->pongs, __ATOMIC_RELAXED);
+	copy->packets = __atomic_load_n (&n->packets, __ATOMIC_RELAXED);
+	copy->dropped = __atomic_load_n (&n->dropped, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+    } while ((sequence & 1)
+	     || sequence != __atomic_load_n (&n->sequence,
+					     __ATOMIC_RELAXED));
+    copy->sequence = sequence;
+    copy->arrival = n->arrival;		// only the main thread sets it
+}
+
+
+//
+// PacketNode
+// Finds the node a packet came from, by port too
+//  if there are several on one host, -1 if none.
+//
+static int PacketNode (struct sockaddr_in* from)
+{
+    int		i;
+    
+    for (i=0 ; i<doomcom->numnodes ; i++)
+	if ( from->sin_addr.s_addr == sendaddress[i].sin_addr.s_addr
+	     && from->sin_port == sendaddress[i].sin_port )
+	    return i;
+    for (i=0 ; i<doomcom->numnodes ; i++)
+	if ( from->sin_addr.s_addr == sendaddress[i].sin_addr.s_addr )
+	    return i;
+    return -1;
+}
+
+
+//
+// PacketPings
+// Pings every node each NETPINGUS.
+//
+static void PacketPings (unsigned now)
+{
+    byte	buf[NETPINGSIZE];
+    int		i;
+
+    if (now - netpingtime < NETPINGUS)
+	return;
+    netpingtime = now;
+    
+    buf[0] = NETPING;
+    buf[1] = now;
+    buf[2] = now>>8;
+    buf[3] = now>>16;
+    buf[4] = now>>24;
+    for (i=1 ; i<doomcom->numnodes ; i++)
+    {
+	sendto (sendsocket, buf, NETPINGSIZE, 0,
+		(void *)&sendaddress[i], sizeof(sendaddress[i]));
+	NetNodeCount (&netnodes[i], &netnodes[i].pings);
+    }
+}
+
+
+//
+// PacketPing
+// Answers a ping or times a pong, returns false
+//  for any other packet.
+//
+static boolean
+PacketPing
+( byte*			buf,
+  int			len,
+  struct sockaddr_in*	from,
+  int			node,
+  unsigned		now )
+{
+    netnode_t*	n;
+    unsigned	stamp;
+    int		rtt;
+    int		smoothed;
+    int		jitter;
+
+    if (len != NETPINGSIZE || (buf[0] != NETPING && buf[0] != NETPONG))
+	return false;
+    if (node < 1)
+	return true;			// not one of the players
+    
+    if (buf[0] == NETPING)
+    {
+	buf[0] = NETPONG;
+	sendto (sendsocket, buf, len, 0, (void *)from, sizeof(*from));
+	return true;
+    }
+
+    stamp = buf[1] | (buf[2]<<8) | (buf[3]<<16) | ((unsigned)buf[4]<<24);
+    rtt = now - stamp;
+    if (rtt < 0)
+	return true;
+
+    // smoothed as TCP does it
+    n = &netnodes[node];
+    if (!n->pongs)
+    {
+	smoothed = rtt;
+	jitter = rtt/2;
+    }
+    else
+    {
+	jitter = n->jitter + (abs (rtt - n->rtt) - n->jitter)/4;
+	smoothed = n->rtt + (rtt - n->rtt)/8;
+    }
+    NetNodeBegin (n);
+    NETSTORE (n->rtt, smoothed);
+    NETSTORE (n->jitter, jitter);
+    NETSTORE (n->pongs, n->pongs+1);
+    NetNodeEnd (n);
+    return true;
+}
+
+
+//
+// PacketFlush
+// Sends the queued packets, in one sendmmsg where there is one.
+//
+void PacketFlush (void)
+{
+    int		i;
+    int		c;
+#ifdef LINUX
+    struct mmsghdr	msgs[NETBATCH];
+    struct iovec	iov[NETBATCH];
+
+    memset (msgs, 0, numsend*sizeof(*msgs));
+    for (i=0 ; i<numsend ; i++)
+    {
+	iov[i].iov_base = sendbuf[i];
+	iov[i].iov_len = sendlen[i];
+	msgs[i].msg_hdr.msg_name = &sendaddress[sendnode[i]];
+	msgs[i].msg_hdr.msg_namelen = sizeof(sendaddress[sendnode[i]]);
+	msgs[i].msg_hdr.msg_iov = &iov[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // a packet that can't go is dropped, as with sendto
+    for (i=0 ; i<numsend ; i+=c)
+    {
+	c = sendmmsg (sendsocket, msgs+i, numsend-i, 0);
+	if (c <= 0)
+	    c = 1;
+    }
+#else
+    for (i=0 ; i<numsend ; i++)
+	c = sendto (sendsocket, sendbuf[i], sendlen[i]
+		    ,0,(void *)&sendaddress[sendnode[i]]
+		    ,sizeof(sendaddress[sendnode[i]]));
+#endif
+    numsend = 0;
+
+    if (!netthread)
+	PacketPings (I_GetTimeUS ());
+}
+
+
+//
+// PacketSend
+// Queues the packet until PacketFlush.
+//
+void PacketSend (void)
+{
+    if (numsend == NETBATCH)
+	PacketFlush ();
+
+    if (netbuffer->checksum & NCMD_SETUP)
+	sendlen[numsend] = PacketEncodeOld (sendbuf[numsend]);
+    else
+	sendlen[numsend] = PacketEncode (sendbuf[numsend]);
+    sendnode[numsend] = doomcom->remotenode;
+    numsend++;
+    //printf ("sending %i\n",gametic);		
+}
+
+
+//
+// PacketRecv
+// Refills the receive queue, with one recvmmsg where there is one.
+//
+void PacketRecv (void)
 {
-    int			i;
     int			c;
-    struct sockaddr_in	fromaddress;
+#ifdef LINUX
+    int			i;
+    struct mmsghdr	msgs[NETBATCH];
+    struct iovec	iov[NETBATCH];
+
+    memset (msgs, 0, sizeof(msgs));
+    for (i=0 ; i<NETBATCH ; i++)
+    {
+	iov[i].iov_base = recvbuf[i];
+	iov[i].iov_len = NETPACKETSIZE;
+	msgs[i].msg_hdr.msg_name = &recvaddress[i];
+	msgs[i].msg_hdr.msg_namelen = sizeof(recvaddress[i]);
+	msgs[i].msg_hdr.msg_iov = &iov[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    c = recvmmsg (insocket, msgs, NETBATCH, MSG_DONTWAIT, NULL);
+    for (i=0 ; i<c ; i++)
+	recvlen[i] = msgs[i].msg_len;
+#else
     int			fromlen;
-    doomdata_t		sw;
-				
-    fromlen = sizeof(fromaddress);
-    c = recvfrom (insocket, &sw, sizeof(sw), 0
-		  , (struct sockaddr *)&fromaddress, &fromlen );
-    if (c == -1 )
+
+    fromlen = sizeof(recvaddress[0]);
+    c = recvfrom (insocket, recvbuf[0], NETPACKETSIZE, 0
+		  , (struct sockaddr *)&recvaddress[0], &fromlen );
+    recvlen[0] = c;
+    if (c != -1)
+	c = 1;
+#endif
+    if (c == -1)
     {
 	if (errno != EWOULDBLOCK)
 	    I_Error ("GetPacket: %s",strerror(errno));
-	doomcom->remotenode = -1;		// no packet
-	return;
+	c = 0;
     }
+    numrecv = c;
+    recvon = 0;
+}
+
+
+//
+// PacketGet
+//
+void PacketGet (void)
+{
+    int			i;
+    int			c;
+    byte*		buf;
+    boolean		good;
 
+    do
     {
-	static int first=1;
-	if (first)
-	    printf("len=%d:p=[0x%x 0x%x] \n", c, *(int*)&sw, *((int*)&sw+1));
-	first = 0;
-    }
+	if (recvon == numrecv)
+	    PacketRecv ();
+	if (recvon == numrecv)
+	{
+	    doomcom->remotenode = -1;		// no packet
+	    return;
+	}
+	buf = recvbuf[recvon];
+	c = recvlen[recvon];
 
-    // find remote node number
-    for (i=0 ; i<doomcom->numnodes ; i++)
-	if ( fromaddress.sin_addr.s_addr == sendaddress[i].sin_addr.s_addr )
-	    break;
+	{
+	    static int first=1;
+	    if (first)
+		printf("len=%d:p=[0x%x 0x%x] \n",
+		       c, *(int*)buf, *((int*)buf+1));
+	    first = 0;
+	}
+
+	i = PacketNode (&recvaddress[recvon]);
+	recvon++;
+    } while (PacketPing (buf, c, &recvaddress[recvon-1], i, I_GetTimeUS ()));
 
-    if (i == doomcom->numnodes)
+    if (i == -1)
     {
 	// packet is not from one of the players (new game broadcast)
 	doomcom->remotenode = -1;		// no packet
 	return;
     }
+
+    if (c > 0 && buf[0] == NETMAGIC)
+    {
+	good = PacketDecode (netbuffer, buf, c);
+	c = DATALENGTH(PacketCmds (netbuffer));
+    }
+    else
+	good = PacketDecodeOld (netbuffer, buf, c);
+
+    if (!good)
+    {
+	doomcom->remotenode = -1;		// malformed, drop it
+	return;
+    }
 	
     doomcom->remotenode = i;			// good packet from a game player
     doomcom->datalength = c;
+    NetNodeCount (&netnodes[i], &netnodes[i].packets);
+    netnodes[i].arrival = I_GetTimeUS ();
+}
+
+
+#ifdef LINUX
+//
+// NETWORK THREAD
+// With -netthread a thread waits on the socket with epoll,
+//  answers and sends pings itself, and stamps and decodes
+//  game packets into netring for PacketGetRing.  Only the
+//  thread moves nethead and only PacketGetRing nettail,
+//  so the ring needs no lock.
+//
+#define NETRING		(256*1024)	// bytes, a power of two
+
+typedef struct
+{
+    int		node;		// -1 if the ring wraps here
+    int		length;
+    unsigned	arrival;
+} netrecord_t;
+
+// A record and the doomdata_t after it, in 16 byte steps.
+#define NETRECORD(length)	((sizeof(netrecord_t)+(length)+15) & ~15)
+#define NETRECORDMAX		NETRECORD(sizeof(doomdata_t))
+
+pthread_t	netthreadid;
+int		netepoll;
+int		netwake;		// eventfd the thread writes
+unsigned	netring[NETRING/4];
+unsigned	nethead;
+unsigned	nettail;
+
+byte		threadbuf[NETBATCH][NETPACKETSIZE];
+struct	sockaddr_in	threadaddress[NETBATCH];
+
+
+//
+// NetThreadRecv
+// Queues what one recvmmsg brings.
+//
+static void NetThreadRecv (void)
+{
+    struct mmsghdr	msgs[NETBATCH];
+    struct iovec	iov[NETBATCH];
+    netrecord_t*	rec;
+    doomdata_t*		data;
+    unsigned		now;
+    unsigned		head;
+    unsigned		pos;
+    long long		wake;
+    int			node;
+    int			len;
+    int			c;
+    int			i;
+    boolean		good;
+
+    memset (msgs, 0, sizeof(msgs));
+    for (i=0 ; i<NETBATCH ; i++)
+    {
+	iov[i].iov_base = threadbuf[i];
+	iov[i].iov_len = NETPACKETSIZE;
+	msgs[i].msg_hdr.msg_name = &threadaddress[i];
+	msgs[i].msg_hdr.msg_namelen = sizeof(threadaddress[i]);
+	msgs[i].msg_hdr.msg_iov = &iov[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    
+    c = recvmmsg (insocket, msgs, NETBATCH, MSG_DONTWAIT, NULL);
+    if (c <= 0)
+	return;
+    
+    now = I_GetTimeUS ();
+    head = nethead;
+    for (i=0 ; i<c ; i++)
+    {
+	len = msgs[i].msg_len;
+	node = PacketNode (&threadaddress[i]);
+	if (PacketPing (threadbuf[i], len, &threadaddress[i], node, now)
+	    || node == -1)
+	    continue;
+
+	// room for the largest record, after a wrap if needed
+	pos = head & (NETRING-1);
+	if (pos + NETRECORDMAX > NETRING)
+	{
+	    if (head + NETRING-pos + NETRECORDMAX
+		- __atomic_load_n (&nettail, __ATOMIC_ACQUIRE) > NETRING)
+	    {
+		NetNodeCount (&netnodes[node], &netnodes[node].dropped);
+		continue;
+	    }
+	    rec = (netrecord_t *)((byte *)netring + pos);
+	    rec->node = -1;
+	    head += NETRING-pos;
+	    pos = 0;
+	}
+	else if (head + NETRECORDMAX
+		 - __atomic_load_n (&nettail, __ATOMIC_ACQUIRE) > NETRING)
+	{
+	    NetNodeCount (&netnodes[node], &netnodes[node].dropped);
+	    continue;
+	}
 	
-    // byte swap
-    netbuffer->checksum = ntohl(sw.checksum);
-    netbuffer->player = sw.player;
-    netbuffer->retransmitfrom = sw.retransmitfrom;
-    netbuffer->starttic = sw.starttic;
-    netbuffer->numtics = sw.numtics;
+	rec = (netrecord_t *)((byte *)netring + pos);
+	data = (doomdata_t *)(rec+1);
+	if (len > 0 && threadbuf[i][0] == NETMAGIC)
+	{
+	    good = PacketDecode (data, threadbuf[i], len);
+	    len = DATALENGTH(PacketCmds (data));
+	}
+	else
+	    good = PacketDecodeOld (data, threadbuf[i], len);
+	if (!good)
+	    continue;
 
-    for (c=0 ; c< netbuffer->numtics ; c++)
+	rec->node = node;
+	rec->length = len;
+	rec->arrival = now;
+	head += NETRECORD(len);
+	NetNodeCount (&netnodes[node], &netnodes[node].packets);
+    }
+
+    if (head != nethead)
+    {
+	__atomic_store_n (&nethead, head, __ATOMIC_RELEASE);
+	wake = 1;
+	write (netwake, &wake, 8);
+    }
+}
+
+
+//
+// NetThread
+//
+static void* NetThread (void* unused)
+{
+    struct epoll_event	ev;
+    int			wait;
+    
+    while (1)
+    {
+	wait = (int)(netpingtime + NETPINGUS - I_GetTimeUS ()) / 1000;
+	if (wait < 0)
+	    wait = 0;
+	if (epoll_wait (netepoll, &ev, 1, wait+1) > 0)
+	    NetThreadRecv ();
+	PacketPings (I_GetTimeUS ());
+    }
+    return NULL;
+}
+
+
+//
+// PacketGetRing
+// PacketGet for when the network thread receives.
+//
+void PacketGetRing (void)
+{
+    netrecord_t*	rec;
+    unsigned		pos;
+
+    while (nettail != __atomic_load_n (&nethead, __ATOMIC_ACQUIRE))
+    {
+	pos = nettail & (NETRING-1);
+	rec = (netrecord_t *)((byte *)netring + pos);
+	if (rec->node == -1)
+	{
+	    __atomic_store_n (&nettail, nettail + NETRING-pos,
+			      __ATOMIC_RELEASE);
+	    continue;
+	}
+
+	memcpy (netbuffer, rec+1, rec->length);
+	doomcom->remotenode = rec->node;
+	doomcom->datalength = rec->length;
+	netnodes[rec->node].arrival = rec->arrival;
+	__atomic_store_n (&nettail, nettail + NETRECORD(rec->length),
+			  __ATOMIC_RELEASE);
+	return;
+    }
+    doomcom->remotenode = -1;			// no packet
+}
+
+
+//
+// I_InitNetThread
+//
+void I_InitNetThread (void)
+{
+    struct epoll_event	ev;
+    
+    netepoll = epoll_create1 (0);
+    netwake = eventfd (0, EFD_NONBLOCK);
+    if (netepoll == -1 || netwake == -1)
+	I_Error ("I_InitNetThread: %s", strerror(errno));
+    
+    memset (&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    if (epoll_ctl (netepoll, EPOLL_CTL_ADD, insocket, &ev) == -1)
+	I_Error ("I_InitNetThread: epoll_ctl: %s", strerror(errno));
+
+    netget = PacketGetRing;
+    netthread = true;
+    if (pthread_create (&netthreadid, NULL, NetThread, NULL))
+	I_Error ("I_InitNetThread: can't start the network thread");
+    printf ("I_InitNetThread: network thread\n");
+}
+#endif
+
+
+//
+// I_NetWait
+// Sleeps until I_GetTimeUS reaches us or a packet arrives.
+// Without the network thread only polling can tell,
+//  so it returns false at once.
+//
+boolean I_NetWait (unsigned us)
+{
+#ifdef LINUX
+    struct pollfd	pfd;
+    struct timespec	tp;
+    long long		count;
+    int			wait;
+
+    if (!netthread)
+	return false;
+
+    read (netwake, &count, sizeof(count));	// old arrivals
+    wait = (int)(us - I_GetTimeUS ());
+    if (wait > 0 && nettail == __atomic_load_n (&nethead, __ATOMIC_ACQUIRE))
     {
-	netbuffer->cmds[c].forwardmove = sw.cmds[c].forwardmove;
-	netbuffer->cmds[c].sidemove = sw.cmds[c].sidemove;
-	netbuffer->cmds[c].angleturn = ntohs(sw.cmds[c].angleturn);
-	netbuffer->cmds[c].consistancy = ntohs(sw.cmds[c].consistancy);
-	netbuffer->cmds[c].chatchar = sw.cmds[c].chatchar;
-	netbuffer->cmds[c].buttons = sw.cmds[c].buttons;
+	pfd.fd = netwake;
+	pfd.events = POLLIN;
+	tp.tv_sec = wait / 1000000;
+	tp.tv_nsec = (wait % 1000000) * 1000;
+	ppoll (&pfd, 1, &tp, NULL);
     }
+    return true;
+#else
+    return false;
+#endif
 }
 
 
@@ -246,6 +1096,9 @@ void I_InitNetwork (void)
     boolean		trueval = true;
     int			i;
     int			p;
+    int			port;
+    char		host[256];
+    char*		colon;
     struct hostent*	hostentry;	// host information entry
 	
     doomcom = malloc (sizeof (*doomcom) );
@@ -277,7 +1130,8 @@ void I_InitNetwork (void)
     }
     
     // parse network game options,
-    //  -net <consoleplayer> <host> <host> ...
+    //  -net <consoleplayer> <host>[:<port>] <host>[:<port>] ...
+    // clients of a -relay key player list only its host
     i = M_CheckParm ("-net");
     if (!i)
     {
@@ -292,28 +1146,42 @@ void I_InitNetwork (void)
 
     netsend = PacketSend;
     netget = PacketGet;
+    netflush = PacketFlush;
     netgame = true;
 
     // parse player number and host list
-    doomcom->consoleplayer = myargv[i+1][0]-'1';
+    doomcom->consoleplayer = atoi (myargv[i+1])-1;
 
     doomcom->numnodes = 1;	// this node for sure
 	
     i++;
     while (++i < myargc && myargv[i][0] != '-')
     {
+	if (doomcom->numnodes == MAXNETNODES)
+	    I_Error ("I_InitNetwork: more than %i nodes", MAXNETNODES);
+	
+	strncpy (host, myargv[i], sizeof(host)-1);
+	host[sizeof(host)-1] = 0;
+	port = DOOMPORT;
+	colon = strchr (host, ':');
+	if (colon)
+	{
+	    *colon = 0;
+	    port = atoi (colon+1);
+	}
+	
 	sendaddress[doomcom->numnodes].sin_family = AF_INET;
-	sendaddress[doomcom->numnodes].sin_port = htons(DOOMPORT);
-	if (myargv[i][0] == '.')
+	sendaddress[doomcom->numnodes].sin_port = htons(port);
+	if (host[0] == '.')
 	{
 	    sendaddress[doomcom->numnodes].sin_addr.s_addr 
-		= inet_addr (myargv[i]+1);
+		= inet_addr (host+1);
 	}
 	else
 	{
-	    hostentry = gethostbyname (myargv[i]);
+	    hostentry = gethostbyname (host);
 	    if (!hostentry)
-		I_Error ("gethostbyname: couldn't find %s", myargv[i]);
+		I_Error ("gethostbyname: couldn't find %s", host);
 	    sendaddress[doomcom->numnodes].sin_addr.s_addr 
 		= *(int *)hostentry->h_addr_list[0];
 	}
@@ -328,7 +1196,18 @@ void I_InitNetwork (void)
     BindToLocalPort (insocket,htons(DOOMPORT));
     ioctl (insocket, FIONBIO, &trueval);
 
-    sendsocket = UDPsocket ();
+    // send from the bound port, so that nodes
+    //  sharing a host can be told apart by it
+    sendsocket = insocket;
+
+    if (M_CheckParm ("-netthread"))
+    {
+#ifdef LINUX
+	I_InitNetThread ();
+#else
+	printf ("I_InitNetwork: no network thread on this system\n");
+#endif
+    }
 }
 
 
@@ -342,6 +1221,10 @@ void I_NetCmd (void)
     {
 	netget ();
     }
+    else if (doomcom->command == CMD_FLUSH)
+    {
+	netflush ();
+    }
     else
 	I_Error ("Bad net cmd: %i\n",doomcom->command);
 }
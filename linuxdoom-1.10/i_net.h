@@ -28,6 +28,32 @@
 #pragma interface
 #endif
 
+#include "d_net.h"
+
+
+//
+// Each link as the network layer measures it,
+//  times in microseconds.  The network thread
+//  updates them without a lock, so read them
+//  through I_NetNodeStats.
+//
+typedef struct
+{
+    int		rtt;		// smoothed round trip time
+    int		jitter;		// smoothed deviation from it
+    int		pings;		// pings sent
+    int		pongs;		// and answered
+    int		packets;	// game packets received
+    int		dropped;	// and lost to a full queue
+    unsigned	arrival;	// I_GetTimeUS of the last one got
+    unsigned	sequence;	// odd while being updated
+
+} netnode_t;
+
+// Each node is pinged this often.
+#define NETPINGUS	250000
+
+void I_NetNodeStats (int node, netnode_t* copy);
 
 
 // Called by D_DoomMain.
@@ -36,6 +62,10 @@
 void I_InitNetwork (void);
 void I_NetCmd (void);
 
+// Sleeps until I_GetTimeUS reaches us or a packet
+//  arrives, false if it can't tell and didn't wait.
+boolean I_NetWait (unsigned us);
+
 
 #endif
 //-----------------------------------------------------------------------------
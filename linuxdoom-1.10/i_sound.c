@@ -29,6 +29,13 @@ rcsid[] = "$Id: i_unix.c,v 1.5 1997/02/03 22:45:10 b1 Exp $";
 #include <stdarg.h>
 
 #include <math.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <sys/time.h>
 #include <sys/types.h>
@@ -90,18 +97,37 @@ static int flag = 0;
 
 
 // Needed for calling the actual sound output.
+// SAMPLECOUNT is at SAMPLERATE, mixsamples
+//  the same time span at the output rate.
 #define SAMPLECOUNT		512
-#define NUM_CHANNELS		8
+#define MAXSAMPLECOUNT		2304	// 48000 Hz, multiple of 8
+#define NUM_CHANNELS		32	// default, -mixchannels
+#define MAXMIXCHANNELS		64
 // It is 2 for 16bit, and 2 for two channels.
 #define BUFMUL                  4
-#define MIXBUFFERSIZE		(SAMPLECOUNT*BUFMUL)
+#define MIXBUFFERSIZE		(MAXSAMPLECOUNT*2)
 
 #define SAMPLERATE		11025	// Hz
+#define MAXSAMPLERATE		48000
 #define SAMPLESIZE		2   	// 16bit
 
+// Output rate, -samplerate, and samples per update.
+int		snd_samplerate = SAMPLERATE;
+int		mixsamples = SAMPLECOUNT;
+
+// Internal channels in use, -mixchannels.
+int		numMixChannels = NUM_CHANNELS;
+
+// Sounds the game plays at once, snd_channels,
+//  never more than the mixer has.
+extern int	numChannels;
+
 // The actual lengths of all sound effects.
 int 		lengths[NUMSFX];
 
+// The sample rates from the DMX headers.
+int		rates[NUMSFX];
+
 // The actual output device.
 int	audio_fd;
 
@@ -111,16 +137,23 @@ int	audio_fd;
 //  that is submitted to the audio device.
 signed short	mixbuffer[MIXBUFFERSIZE];
 
+// Left and right sums for one update,
+//  and one channel's resampled data.
+static float	mixleft[MAXSAMPLECOUNT];
+static float	mixright[MAXSAMPLECOUNT];
+static float	mixchannel[MAXSAMPLECOUNT];
 
-// The channel step amount...
-unsigned int	channelstep[NUM_CHANNELS];
+
+// The channel step amount, 16.16 source samples
+//  per output sample, with the rate conversion...
+unsigned int	channelstep[MAXMIXCHANNELS];
 // ... and a 0.16 bit remainder of last step.
-unsigned int	channelstepremainder[NUM_CHANNELS];
+unsigned int	channelstepremainder[MAXMIXCHANNELS];
 
 
 // The channel data pointers, start and end.
-unsigned char*	channels[NUM_CHANNELS];
-unsigned char*	channelsend[NUM_CHANNELS];
+unsigned char*	channels[MAXMIXCHANNELS];
+unsigned char*	channelsend[MAXMIXCHANNELS];
 
 
 // Time/gametic that the channel started playing,
@@ -128,27 +161,25 @@ unsigned char*	channelsend[NUM_CHANNELS];
 //  has lowest priority.
 // In case number of active sounds exceeds
 //  available channels.
-int		channelstart[NUM_CHANNELS];
+int		channelstart[MAXMIXCHANNELS];
 
 // The sound in channel handles,
 //  determined on registration,
 //  might be used to unregister/stop/modify,
 //  currently unused.
-int 		channelhandles[NUM_CHANNELS];
+int 		channelhandles[MAXMIXCHANNELS];
 
 // SFX id of the playing sound effect.
 // Used to catch duplicates (like chainsaw).
-int		channelids[NUM_CHANNELS];			
+int		channelids[MAXMIXCHANNELS];			
 
-// Pitch to stepping lookup, unused.
+// Pitch to stepping lookup.
 int		steptable[256];
 
-// Volume lookups.
-int		vol_lookup[128*256];
-
-// Hardware left and right channel volume lookup.
-int*		channelleftvol_lookup[NUM_CHANNELS];
-int*		channelrightvol_lookup[NUM_CHANNELS];
+// Hardware left and right channel gain,
+//  also turns the unsigned samples into 16 bit.
+float		channelleftgain[MAXMIXCHANNELS];
+float		channelrightgain[MAXMIXCHANNELS];
 
 
 
@@ -229,15 +260,16 @@ getsfx
     // The original realloc would interfere with zone memory.
     paddedsize = ((size-8 + (SAMPLECOUNT-1)) / SAMPLECOUNT) * SAMPLECOUNT;
 
-    // Allocate from zone memory.
-    paddedsfx = (unsigned char*)Z_Malloc( paddedsize+8, PU_STATIC, 0 );
+    // Allocate from zone memory, one more byte
+    //  for the mixer to interpolate towards.
+    paddedsfx = (unsigned char*)Z_Malloc( paddedsize+9, PU_STATIC, 0 );
     // ddt: (unsigned char *) realloc(sfx, paddedsize+8);
     // This should interfere with zone memory handling,
     //  which does not kick in in the soundserver.
 
     // Now copy and pad.
     memcpy(  paddedsfx, sfx, size );
-    for (i=size ; i<paddedsize+8 ; i++)
+    for (i=size ; i<paddedsize+9 ; i++)
         paddedsfx[i] = 128;
 
     // Remove the cached lump.
@@ -290,7 +322,7 @@ addsfx
 	 || sfxid == sfx_pistol	 )
     {
 	// Loop all channels, check.
-	for (i=0 ; i<NUM_CHANNELS ; i++)
+	for (i=0 ; i<numMixChannels ; i++)
 	{
 	    // Active, and using the same SFX?
 	    if ( (channels[i])
@@ -306,7 +338,7 @@ addsfx
     }
 
     // Loop all channels to find oldest SFX.
-    for (i=0; (i<NUM_CHANNELS) && (channels[i]); i++)
+    for (i=0; (i<numMixChannels) && (channels[i]); i++)
     {
 	if (channelstart[i] < oldest)
 	{
@@ -319,7 +351,7 @@ addsfx
     // If we found a channel, fine.
     // If not, we simply overwrite the first one, 0.
     // Probably only happens at startup.
-    if (i == NUM_CHANNELS)
+    if (i == numMixChannels)
 	slot = oldestnum;
     else
 	slot = i;
@@ -339,9 +371,9 @@ addsfx
     // Preserved so sounds could be stopped (unused).
     channelhandles[slot] = rc = handlenums++;
 
-    // Set stepping???
-    // Kinda getting the impression this is never used.
-    channelstep[slot] = step;
+    // Pitch, and the sfx rate over the output rate.
+    channelstep[slot] =
+	(unsigned int)((double)step * rates[sfxid] / snd_samplerate);
     // ???
     channelstepremainder[slot] = 0;
     // Should be gametic, I presume.
@@ -367,10 +399,9 @@ addsfx
     if (leftvol < 0 || leftvol > 127)
 	I_Error("leftvol out of bounds");
     
-    // Get the proper lookup table piece
-    //  for this volume level???
-    channelleftvol_lookup[slot] = &vol_lookup[leftvol*256];
-    channelrightvol_lookup[slot] = &vol_lookup[rightvol*256];
+    // Same scale the old volume lookups had.
+    channelleftgain[slot] = leftvol*256/127.0f;
+    channelrightgain[slot] = rightvol*256/127.0f;
 
     // Preserve sound SFX id,
     //  e.g. for avoiding duplicates of chainsaw.
@@ -399,7 +430,6 @@ void I_SetChannels()
   // This function sets up internal lookups used during
   //  the mixing process. 
   int		i;
-  int		j;
     
   int*	steptablemid = steptable + 128;
   
@@ -410,17 +440,8 @@ void I_SetChannels()
   }*/
 
   // This table provides step widths for pitch parameters.
-  // I fail to see that this is currently used.
   for (i=-128 ; i<128 ; i++)
     steptablemid[i] = (int)(pow(2.0, (i/64.0))*65536.0);
-  
-  
-  // Generates volume lookup tables
-  //  which also turn the unsigned samples
-  //  into signed samples.
-  for (i=0 ; i<128 ; i++)
-    for (j=0 ; j<256 ; j++)
-      vol_lookup[i*256+j] = (i*(j-128)*256)/127;
 }	
 
  
@@ -523,16 +544,168 @@ int I_SoundIsPlaying(int handle)
 
 
 
+//
+// I_ResampleChannel
+// Steps through the raw data of one channel,
+//  interpolating between source samples,
+//  into mixchannel. Returns the samples made,
+//  fewer if the sound ends.
+//
+static int I_ResampleChannel (int chan)
+{
+    unsigned char*	data;
+    unsigned char*	end;
+    unsigned int	step;
+    unsigned int	frac;
+    int			i;
+
+    data = channels[chan];
+    end = channelsend[chan];
+    step = channelstep[chan];
+    frac = channelstepremainder[chan];
+
+    // The data is padded past the end,
+    //  so data[1] is always there.
+    for (i=0 ; i<mixsamples ; )
+    {
+	mixchannel[i++] = (data[0]-128)
+	    + (data[1]-data[0]) * (frac * (1.0f/65536));
+	frac += step;
+	data += frac >> 16;
+	frac &= 65536-1;
+
+	if (data >= end)
+	{
+	    data = 0;
+	    break;
+	}
+    }
+
+    channels[chan] = data;
+    channelstepremainder[chan] = frac;
+    return i;
+}
+
+
+//
+// I_MixChannel
+// Adds mixchannel into the left and right sums.
+//
+static void
+I_MixChannel
+( int		count,
+  float		left,
+  float		right )
+{
+    int		i;
+
+    i = 0;
+    
+#if defined(__AVX2__)
+    {
+	__m256	l = _mm256_set1_ps (left);
+	__m256	r = _mm256_set1_ps (right);
+	__m256	in;
+
+	for ( ; i+8 <= count ; i+=8)
+	{
+	    in = _mm256_loadu_ps (mixchannel+i);
+	    _mm256_storeu_ps (mixleft+i, _mm256_add_ps
+			      (_mm256_loadu_ps (mixleft+i),
+			       _mm256_mul_ps (in, l)));
+	    _mm256_storeu_ps (mixright+i, _mm256_add_ps
+			      (_mm256_loadu_ps (mixright+i),
+			       _mm256_mul_ps (in, r)));
+	}
+    }
+#elif defined(__SSE2__)
+    {
+	__m128	l = _mm_set1_ps (left);
+	__m128	r = _mm_set1_ps (right);
+	__m128	in;
+
+	for ( ; i+4 <= count ; i+=4)
+	{
+	    in = _mm_loadu_ps (mixchannel+i);
+	    _mm_storeu_ps (mixleft+i, _mm_add_ps (_mm_loadu_ps (mixleft+i),
+						  _mm_mul_ps (in, l)));
+	    _mm_storeu_ps (mixright+i, _mm_add_ps (_mm_loadu_ps (mixright+i),
+						   _mm_mul_ps (in, r)));
+	}
+    }
+#endif
+
+    for ( ; i<count ; i++)
+    {
+	mixleft[i] += mixchannel[i] * left;
+	mixright[i] += mixchannel[i] * right;
+    }
+}
+
+
+//
+// I_WriteMix
+// Rounds and clamps the sums into the
+//  interleaved 16 bit mixbuffer.
+//
+static void I_WriteMix (void)
+{
+    signed short*	out;
+    int			i;
+    long		v;
+
+    out = mixbuffer;
+    i = 0;
+
+#if defined(__AVX2__)
+    {
+	__m256i	l;
+	__m256i	r;
+
+	// packs works per 128 bit lane,
+	//  which keeps the pairs in order
+	for ( ; i+8 <= mixsamples ; i+=8, out+=16)
+	{
+	    l = _mm256_cvtps_epi32 (_mm256_loadu_ps (mixleft+i));
+	    r = _mm256_cvtps_epi32 (_mm256_loadu_ps (mixright+i));
+	    _mm256_storeu_si256 ((__m256i *)out, _mm256_packs_epi32
+				 (_mm256_unpacklo_epi32 (l, r),
+				  _mm256_unpackhi_epi32 (l, r)));
+	}
+    }
+#elif defined(__SSE2__)
+    {
+	__m128i	l;
+	__m128i	r;
+
+	for ( ; i+4 <= mixsamples ; i+=4, out+=8)
+	{
+	    l = _mm_cvtps_epi32 (_mm_loadu_ps (mixleft+i));
+	    r = _mm_cvtps_epi32 (_mm_loadu_ps (mixright+i));
+	    _mm_storeu_si128 ((__m128i *)out, _mm_packs_epi32
+			      (_mm_unpacklo_epi32 (l, r),
+			       _mm_unpackhi_epi32 (l, r)));
+	}
+    }
+#endif
+
+    for ( ; i<mixsamples ; i++)
+    {
+	v = lrintf (mixleft[i]);
+	*out++ = v > 0x7fff ? 0x7fff : v < -0x8000 ? -0x8000 : v;
+	v = lrintf (mixright[i]);
+	*out++ = v > 0x7fff ? 0x7fff : v < -0x8000 ? -0x8000 : v;
+    }
+}
+
+
 //
 // This function loops all active (internal) sound
-//  channels, retrieves a given number of samples
-//  from the raw sound data, modifies it according
-//  to the current (internal) channel parameters,
-//  mixes the per channel samples into the global
-//  mixbuffer, clamping it to the allowed range,
-//  and sets up everything for transferring the
-//  contents of the mixbuffer to the (two)
-//  hardware channels (left and right, that is).
+//  channels, resamples each to the output rate,
+//  mixes the per channel samples into the left and
+//  right sums a block at a time, then clamps them
+//  into the global mixbuffer for transferring to the
+//  (two) hardware channels (left and right, that is).
 //
 // This function currently supports only 16bit.
 //
@@ -543,97 +716,25 @@ void I_UpdateSound( void )
   static int misses = 0;
 #endif
 
-  
-  // Mix current sound data.
-  // Data, from raw sound, for right and left.
-  register unsigned int	sample;
-  register int		dl;
-  register int		dr;
-  
-  // Pointers in global mixbuffer, left, right, end.
-  signed short*		leftout;
-  signed short*		rightout;
-  signed short*		leftend;
-  // Step in mixbuffer, left and right, thus two.
-  int				step;
-
   // Mixing channel index.
   int				chan;
+  int				count;
+
+    memset (mixleft, 0, mixsamples*sizeof(*mixleft));
+    memset (mixright, 0, mixsamples*sizeof(*mixright));
     
-    // Left and right channel
-    //  are in global mixbuffer, alternating.
-    leftout = mixbuffer;
-    rightout = mixbuffer+1;
-    step = 2;
-
-    // Determine end, for left channel only
-    //  (right channel is implicit).
-    leftend = mixbuffer + SAMPLECOUNT*step;
-
-    // Mix sounds into the mixing buffer.
-    // Loop over step*SAMPLECOUNT,
-    //  that is 512 values for two channels.
-    while (leftout != leftend)
+    for ( chan = 0; chan < numMixChannels; chan++ )
     {
-	// Reset left/right value. 
-	dl = 0;
-	dr = 0;
-
-	// Love thy L2 chache - made this a loop.
-	// Now more channels could be set at compile time
-	//  as well. Thus loop those  channels.
-	for ( chan = 0; chan < NUM_CHANNELS; chan++ )
-	{
-	    // Check channel, if active.
-	    if (channels[ chan ])
-	    {
-		// Get the raw data from the channel. 
-		sample = *channels[ chan ];
-		// Add left and right part
-		//  for this channel (sound)
-		//  to the current data.
-		// Adjust volume accordingly.
-		dl += channelleftvol_lookup[ chan ][sample];
-		dr += channelrightvol_lookup[ chan ][sample];
-		// Increment index ???
-		channelstepremainder[ chan ] += channelstep[ chan ];
-		// MSB is next sample???
-		channels[ chan ] += channelstepremainder[ chan ] >> 16;
-		// Limit to LSB???
-		channelstepremainder[ chan ] &= 65536-1;
-
-		// Check whether we are done.
-		if (channels[ chan ] >= channelsend[ chan ])
-		    channels[ chan ] = 0;
-	    }
-	}
-	
-	// Clamp to range. Left hardware channel.
-	// Has been char instead of short.
-	// if (dl > 127) *leftout = 127;
-	// else if (dl < -128) *leftout = -128;
-	// else *leftout = dl;
-
-	if (dl > 0x7fff)
-	    *leftout = 0x7fff;
-	else if (dl < -0x8000)
-	    *leftout = -0x8000;
-	else
-	    *leftout = dl;
-
-	// Same for right hardware channel.
-	if (dr > 0x7fff)
-	    *rightout = 0x7fff;
-	else if (dr < -0x8000)
-	    *rightout = -0x8000;
-	else
-	    *rightout = dr;
-
-	// Increment current pointers in mixbuffer.
-	leftout += step;
-	rightout += step;
+	// Check channel, if active.
+	if (!channels[ chan ])
+	    continue;
+
+	count = I_ResampleChannel (chan);
+	I_MixChannel (count, channelleftgain[chan], channelrightgain[chan]);
     }
 
+    I_WriteMix ();
+
 #ifdef SNDINTR
     // Debug check.
     if ( flag )
@@ -666,7 +767,7 @@ void
 I_SubmitSound(void)
 {
   // Write it to DSP device.
-  write(audio_fd, mixbuffer, SAMPLECOUNT*BUFMUL);
+  write(audio_fd, mixbuffer, mixsamples*BUFMUL);
 }
 
 
@@ -711,7 +812,7 @@ void I_ShutdownSound(void)
   
   while ( !done )
   {
-    for( i=0 ; i<8 && !channels[i] ; i++);
+    for( i=0 ; i<numMixChannels && !channels[i] ; i++);
     
     // FIXME. No proper channel output.
     //if (i==8)
@@ -737,9 +838,41 @@ void I_ShutdownSound(void)
 void
 I_InitSound()
 { 
+  int i;
 #ifdef SNDSERV
   char buffer[256];
+#endif
+
+  // Output rate and channels.
+  i = M_CheckParm ("-samplerate");
+  if (i && i<myargc-1)
+  {
+    snd_samplerate = atoi (myargv[i+1]);
+    if (snd_samplerate < SAMPLERATE)
+      snd_samplerate = SAMPLERATE;
+    if (snd_samplerate > MAXSAMPLERATE)
+      snd_samplerate = MAXSAMPLERATE;
+  }
+  mixsamples = (SAMPLECOUNT*snd_samplerate/SAMPLERATE + 7) & ~7;
   
+  i = M_CheckParm ("-mixchannels");
+  if (i && i<myargc-1)
+  {
+    numMixChannels = atoi (myargv[i+1]);
+    if (numMixChannels < 1)
+      numMixChannels = 1;
+    if (numMixChannels > MAXMIXCHANNELS)
+      numMixChannels = MAXMIXCHANNELS;
+
+    // asking for more channels means hearing them
+    numChannels = numMixChannels;
+  }
+  if (numChannels < 1)
+    numChannels = 1;
+  if (numChannels > numMixChannels)
+    numChannels = numMixChannels;
+
+#ifdef SNDSERV
   if (getenv("DOOMWADDIR"))
     sprintf(buffer, "%s/%s",
 	    getenv("DOOMWADDIR"),
@@ -751,14 +884,17 @@ I_InitSound()
   if ( !access(buffer, X_OK) )
   {
     strcat(buffer, " -quiet");
+    sprintf(buffer+strlen(buffer), " -samplerate %i -mixchannels %i",
+	    snd_samplerate, numMixChannels);
     sndserver = popen(buffer, "w");
   }
   else
     fprintf(stderr, "Could not start sound server [%s]\n", buffer);
 #else
     
-  int i;
-  
+  int link;
+  unsigned char* header;
+
 #ifdef SNDINTR
   fprintf( stderr, "I_SoundSetTimer: %d microsecs\n", SOUND_INTERVAL );
   I_SoundSetTimer( SOUND_INTERVAL );
@@ -772,11 +908,13 @@ I_InitSound()
     fprintf(stderr, "Could not open /dev/dsp\n");
   
                      
-  i = 11 | (2<<16);                                           
+  // Two fragments of at least one update.
+  for (i=11 ; (1<<i) < mixsamples*BUFMUL ; i++);
+  i |= 2<<16;
   myioctl(audio_fd, SNDCTL_DSP_SETFRAGMENT, &i);
   myioctl(audio_fd, SNDCTL_DSP_RESET, 0);
   
-  i=SAMPLERATE;
+  i=snd_samplerate;
   
   myioctl(audio_fd, SNDCTL_DSP_SPEED, &i);
   
@@ -803,12 +941,20 @@ I_InitSound()
     {
       // Load data from WAD file.
       S_sfx[i].data = getsfx( S_sfx[i].name, &lengths[i] );
+
+      // DMX header, the rate is the second short.
+      header = (unsigned char *)S_sfx[i].data - 8;
+      rates[i] = header[2] | (header[3]<<8);
+      if (!rates[i])
+	rates[i] = SAMPLERATE;
     }	
     else
     {
       // Previously loaded already?
+      link = S_sfx[i].link - S_sfx;
       S_sfx[i].data = S_sfx[i].link->data;
-      lengths[i] = lengths[(S_sfx[i].link - S_sfx)/sizeof(sfxinfo_t)];
+      lengths[i] = lengths[link];
+      rates[i] = rates[link];
     }
   }
 
@@ -819,7 +965,8 @@ I_InitSound()
     mixbuffer[i] = 0;
   
   // Finished initialization.
-  fprintf(stderr, "I_InitSound: sound module ready\n");
+  fprintf(stderr, "I_InitSound: sound module ready, %i Hz, %i channels\n",
+	  snd_samplerate, numMixChannels);
     
 #endif
 }
@@ -924,7 +1071,7 @@ void I_HandleSoundTimer( int ignore )
   {
     // See I_SubmitSound().
     // Write it to DSP device.
-    write(audio_fd, mixbuffer, SAMPLECOUNT*BUFMUL);
+    write(audio_fd, mixbuffer, mixsamples*BUFMUL);
 
     // Reset flag counter.
     flag = 0;
@@ -29,7 +29,8 @@ rcsid[] = "$Id: m_bbox.c,v 1.1 1997/02/03 22:45:10 b1 Exp $";
 #include <string.h>
 
 #include <stdarg.h>
-#include <sys/time.h>
+#include <time.h>
+#include <errno.h>
 #include <unistd.h>
 
 #include "doomdef.h"
@@ -39,6 +40,7 @@ rcsid[] = "$Id: m_bbox.c,v 1.1 1997/02/03 22:45:10 b1 Exp $";
 
 #include "d_net.h"
 #include "g_game.h"
+#include "m_bench.h"
 
 #ifdef __GNUG__
 #pragma implementation "i_system.h"
@@ -80,23 +82,92 @@ byte* I_ZoneBase (int*	size)
 }
 
 
+byte* I_ZoneArena (int size)
+{
+    return (byte *) malloc (size);
+}
+
+
+void I_FreeArena (byte* arena)
+{
+    free (arena);
+}
+
+
+
+//
+// I_GetTimeNS
+// Nanoseconds since the first call, on a clock
+//  that setting the date does not move.
+//
+static long long	basetime = -1;
+
+static long long I_GetTimeNS (void)
+{
+    struct timespec	tp;
+    long long		ns;
+
+    clock_gettime (CLOCK_MONOTONIC, &tp);
+    ns = (long long)tp.tv_sec*1000000000 + tp.tv_nsec;
+    if (basetime < 0)
+	basetime = ns;
+    return ns - basetime;
+}
+
 
 //
 // I_GetTime
-// returns time in 1/70th second tics
+// returns time in 1/35th second tics
 //
 int  I_GetTime (void)
 {
-    struct timeval	tp;
-    struct timezone	tzp;
-    int			newtics;
-    static int		basetime=0;
-  
-    gettimeofday(&tp, &tzp);
-    if (!basetime)
-	basetime = tp.tv_sec;
-    newtics = (tp.tv_sec-basetime)*TICRATE + tp.tv_usec*TICRATE/1000000;
-    return newtics;
+    return (int)(I_GetTimeNS () * TICRATE / 1000000000);
+}
+
+
+//
+// I_GetTimeUS
+// returns time in microseconds
+//
+unsigned I_GetTimeUS (void)
+{
+    return (unsigned)(I_GetTimeNS () / 1000);
+}
+
+
+//
+// I_TicStartUS
+// The first microsecond I_GetTime returns tic.
+//
+unsigned I_TicStartUS (int tic)
+{
+    return (unsigned)(((long long)tic*1000000 + TICRATE-1) / TICRATE);
+}
+
+
+//
+// I_SleepUntilUS
+// Sleeps to an absolute time so that
+//  waking late does not add up over tics.
+//
+void I_SleepUntilUS (unsigned us)
+{
+    struct timespec	tp;
+    long long		now;
+    long long		wake;
+    int			wait;
+
+    now = I_GetTimeNS ();
+    wait = (int)(us - (unsigned)(now / 1000));
+    if (wait <= 0)
+	return;
+
+    wake = basetime + now + (long long)wait*1000;
+    tp.tv_sec = wake / 1000000000;
+    tp.tv_nsec = wake % 1000000000;
+    while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &tp, NULL)
+	   == EINTR)
+	;
 }
 
 
@@ -119,6 +190,8 @@ void I_Quit (void)
     I_ShutdownSound();
     I_ShutdownMusic();
     M_SaveDefaults ();
+    M_ZoneStatsReport ();
+    M_TicStatsReport ();
     I_ShutdownGraphics();
     exit(0);
 }
@@ -39,11 +39,28 @@ void I_Init (void);
 // for the zone management.
 byte*	I_ZoneBase (int *size);
 
+// Extra zone arenas, when the base runs out.
+byte*	I_ZoneArena (int size);
+void	I_FreeArena (byte* arena);
+
 
 // Called by D_DoomLoop,
 // returns current time in tics.
 int I_GetTime (void);
 
+// Returns a free running microsecond count
+// on the same monotonic clock as I_GetTime.
+// Wraps, so only differences are meaningful.
+unsigned I_GetTimeUS (void);
+
+// The I_GetTimeUS time at which I_GetTime
+// reaches tic.
+unsigned I_TicStartUS (int tic);
+
+// Sleeps until I_GetTimeUS reaches us,
+// returns at once if it already has.
+void I_SleepUntilUS (unsigned us);
+
 
 //
 // Called by D_DoomLoop,
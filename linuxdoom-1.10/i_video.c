@@ -34,6 +34,11 @@ rcsid[] = "$Id: i_x.c,v 1.6 1997/02/03 22:45:10 b1 Exp $";
 #include <X11/keysym.h>
 
 #include <X11/extensions/XShm.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 // Had to dig up XShm.c for this one.
 // It is in the libXext, but not in the XFree86 headers.
 #ifdef LINUX
@@ -84,12 +89,29 @@ boolean		grabMouse;
 int		doPointerWarp = POINTER_WARP_COUNTDOWN;
 
 // Blocky mode,
-// replace each 320x200 pixel with multiply*multiply pixels.
+// replace each screen pixel with multiply*multiply pixels.
 // According to Dave Taylor, it still is a bonehead thing
 // to use ....
 static int	multiply=1;
 
 
+//
+// Output stage.
+// screens[0] is rendered on its own and expanded into the image
+//  at blit time, through truepalette on TrueColor visuals.
+// Only rows that changed since the last blit are expanded and sent.
+//
+static boolean		truecolor;
+static unsigned		truepalette[256];
+
+static byte*		lastscreen;	// screens[0] as last expanded
+static boolean		expandall;	// palette changed
+static boolean		putall;		// window exposed
+
+// screen column for each image column, when not a whole multiple
+static int*		xsource;
+
+
 //
 //  Translates the key currently in X_event
 //
@@ -268,6 +290,9 @@ void I_GetEvent(void)
 	break;
 	
       case Expose:
+	putall = true;
+	break;
+
       case ConfigureNotify:
 	break;
 	
@@ -346,6 +371,114 @@ void I_UpdateNoBlit (void)
     // what is this?
 }
 
+//
+// I_ExpandRow32
+// Expands one screen row through truepalette into an image row.
+//
+static void
+I_ExpandRow32
+( byte*		src,
+  unsigned*	dest )
+{
+    int		x;
+    unsigned	p;
+
+    x = 0;
+    
+    if (xsource)
+    {
+	for ( ; x<X_width ; x++)
+	    dest[x] = truepalette[src[xsource[x]]];
+	return;
+    }
+
+    if (multiply == 1)
+    {
+#if defined(__AVX2__)
+	for ( ; x+8 <= SCREENWIDTH ; x+=8)
+	    _mm256_storeu_si256 ((__m256i *)(dest+x), _mm256_i32gather_epi32
+				 ((const int *)truepalette,
+				  _mm256_cvtepu8_epi32
+				  (_mm_loadl_epi64 ((__m128i *)(src+x))), 4));
+#endif
+	for ( ; x<SCREENWIDTH ; x++)
+	    dest[x] = truepalette[src[x]];
+    }
+    else if (multiply == 2)
+    {
+#if defined(__SSE2__)
+	__m128i	four;
+
+	for ( ; x+4 <= SCREENWIDTH ; x+=4, dest+=8)
+	{
+	    four = _mm_setr_epi32 (truepalette[src[x]],
+				   truepalette[src[x+1]],
+				   truepalette[src[x+2]],
+				   truepalette[src[x+3]]);
+	    _mm_storeu_si128 ((__m128i *)dest, _mm_unpacklo_epi32 (four, four));
+	    _mm_storeu_si128 ((__m128i *)(dest+4),
+			      _mm_unpackhi_epi32 (four, four));
+	}
+#endif
+	for ( ; x<SCREENWIDTH ; x++, dest+=2)
+	    dest[0] = dest[1] = truepalette[src[x]];
+    }
+    else if (multiply == 4)
+    {
+#if defined(__SSE2__)
+	for ( ; x<SCREENWIDTH ; x++, dest+=4)
+	    _mm_storeu_si128 ((__m128i *)dest,
+			      _mm_set1_epi32 (truepalette[src[x]]));
+#else
+	for ( ; x<SCREENWIDTH ; x++, dest+=4)
+	{
+	    p = truepalette[src[x]];
+	    dest[0] = dest[1] = dest[2] = dest[3] = p;
+	}
+#endif
+    }
+    else
+    {
+	int	i;
+
+	for ( ; x<SCREENWIDTH ; x++, dest+=multiply)
+	{
+	    p = truepalette[src[x]];
+	    for (i=0 ; i<multiply ; i++)
+		dest[i] = p;
+	}
+    }
+}
+
+
+//
+// I_ExpandRow8
+// Copies one screen row into a PseudoColor image row.
+//
+static void
+I_ExpandRow8
+( byte*		src,
+  byte*		dest )
+{
+    int		x;
+    int		i;
+
+    if (xsource)
+    {
+	for (x=0 ; x<X_width ; x++)
+	    dest[x] = src[xsource[x]];
+    }
+    else if (multiply == 1)
+	memcpy (dest, src, SCREENWIDTH);
+    else
+    {
+	for (x=0 ; x<SCREENWIDTH ; x++)
+	    for (i=0 ; i<multiply ; i++)
+		*dest++ = src[x];
+    }
+}
+
+
 //
 // I_FinishUpdate
 //
@@ -355,7 +488,14 @@ void I_FinishUpdate (void)
     static int	lasttic;
     int		tics;
     int		i;
-    // UNUSED static unsigned char *bigscreen=0;
+    int		y;
+    int		top;
+    int		bottom;
+    int		oy;
+    int		nexty;
+    byte*	src;
+    byte*	last;
+    char*	dest;
 
     // draws little dots on the bottom of the screen
     if (devparm)
@@ -373,113 +513,51 @@ void I_FinishUpdate (void)
     
     }
 
-    // scales the screen size before blitting it
-    if (multiply == 2)
+    // expand the changed rows, each is
+    //  converted once and copied down the image
+    top = X_height;
+    bottom = 0;
+    src = screens[0];
+    last = lastscreen;
+    oy = 0;
+    
+    for (y=0 ; y<SCREENHEIGHT ; y++, src+=SCREENWIDTH, last+=SCREENWIDTH)
     {
-	unsigned int *olineptrs[2];
-	unsigned int *ilineptr;
-	int x, y, i;
-	unsigned int twoopixels;
-	unsigned int twomoreopixels;
-	unsigned int fouripixels;
-
-	ilineptr = (unsigned int *) (screens[0]);
-	for (i=0 ; i<2 ; i++)
-	    olineptrs[i] = (unsigned int *) &image->data[i*X_width];
-
-	y = SCREENHEIGHT;
-	while (y--)
+	nexty = ((y+1)*X_height + SCREENHEIGHT-1) / SCREENHEIGHT;
+	
+	if (nexty > oy
+	    && (expandall || memcmp (src, last, SCREENWIDTH)))
 	{
-	    x = SCREENWIDTH;
-	    do
-	    {
-		fouripixels = *ilineptr++;
-		twoopixels =	(fouripixels & 0xff000000)
-		    |	((fouripixels>>8) & 0xffff00)
-		    |	((fouripixels>>16) & 0xff);
-		twomoreopixels =	((fouripixels<<16) & 0xff000000)
-		    |	((fouripixels<<8) & 0xffff00)
-		    |	(fouripixels & 0xff);
-#ifdef __BIG_ENDIAN__
-		*olineptrs[0]++ = twoopixels;
-		*olineptrs[1]++ = twoopixels;
-		*olineptrs[0]++ = twomoreopixels;
-		*olineptrs[1]++ = twomoreopixels;
-#else
-		*olineptrs[0]++ = twomoreopixels;
-		*olineptrs[1]++ = twomoreopixels;
-		*olineptrs[0]++ = twoopixels;
-		*olineptrs[1]++ = twoopixels;
-#endif
-	    } while (x-=4);
-	    olineptrs[0] += X_width/4;
-	    olineptrs[1] += X_width/4;
-	}
+	    memcpy (last, src, SCREENWIDTH);
+	    dest = image->data + oy*image->bytes_per_line;
+	    
+	    if (truecolor)
+		I_ExpandRow32 (src, (unsigned *)dest);
+	    else
+		I_ExpandRow8 (src, (byte *)dest);
+	    
+	    for (i=oy+1 ; i<nexty ; i++)
+		memcpy (image->data + i*image->bytes_per_line,
+			dest, image->bytes_per_line);
 
-    }
-    else if (multiply == 3)
-    {
-	unsigned int *olineptrs[3];
-	unsigned int *ilineptr;
-	int x, y, i;
-	unsigned int fouropixels[3];
-	unsigned int fouripixels;
-
-	ilineptr = (unsigned int *) (screens[0]);
-	for (i=0 ; i<3 ; i++)
-	    olineptrs[i] = (unsigned int *) &image->data[i*X_width];
-
-	y = SCREENHEIGHT;
-	while (y--)
-	{
-	    x = SCREENWIDTH;
-	    do
-	    {
-		fouripixels = *ilineptr++;
-		fouropixels[0] = (fouripixels & 0xff000000)
-		    |	((fouripixels>>8) & 0xff0000)
-		    |	((fouripixels>>16) & 0xffff);
-		fouropixels[1] = ((fouripixels<<8) & 0xff000000)
-		    |	(fouripixels & 0xffff00)
-		    |	((fouripixels>>8) & 0xff);
-		fouropixels[2] = ((fouripixels<<16) & 0xffff0000)
-		    |	((fouripixels<<8) & 0xff00)
-		    |	(fouripixels & 0xff);
-#ifdef __BIG_ENDIAN__
-		*olineptrs[0]++ = fouropixels[0];
-		*olineptrs[1]++ = fouropixels[0];
-		*olineptrs[2]++ = fouropixels[0];
-		*olineptrs[0]++ = fouropixels[1];
-		*olineptrs[1]++ = fouropixels[1];
-		*olineptrs[2]++ = fouropixels[1];
-		*olineptrs[0]++ = fouropixels[2];
-		*olineptrs[1]++ = fouropixels[2];
-		*olineptrs[2]++ = fouropixels[2];
-#else
-		*olineptrs[0]++ = fouropixels[2];
-		*olineptrs[1]++ = fouropixels[2];
-		*olineptrs[2]++ = fouropixels[2];
-		*olineptrs[0]++ = fouropixels[1];
-		*olineptrs[1]++ = fouropixels[1];
-		*olineptrs[2]++ = fouropixels[1];
-		*olineptrs[0]++ = fouropixels[0];
-		*olineptrs[1]++ = fouropixels[0];
-		*olineptrs[2]++ = fouropixels[0];
-#endif
-	    } while (x-=4);
-	    olineptrs[0] += 2*X_width/4;
-	    olineptrs[1] += 2*X_width/4;
-	    olineptrs[2] += 2*X_width/4;
+	    if (oy < top)
+		top = oy;
+	    bottom = nexty;
 	}
-
+	oy = nexty;
     }
-    else if (multiply == 4)
+    expandall = false;
+
+    if (putall)
     {
-	// Broken. Gotta fix this some day.
-	void Expand4(unsigned *, double *);
-  	Expand4 ((unsigned *)(screens[0]), (double *) (image->data));
+	top = 0;
+	bottom = X_height;
+	putall = false;
     }
 
+    if (top >= bottom)
+	return;
+
     if (doShm)
     {
 
@@ -487,9 +565,9 @@ void I_FinishUpdate (void)
 				X_mainWindow,
 				X_gc,
 				image,
-				0, 0,
-				0, 0,
-				X_width, X_height,
+				0, top,
+				0, top,
+				X_width, bottom-top,
 				True ))
 	    I_Error("XShmPutImage() failed\n");
 
@@ -509,9 +587,9 @@ void I_FinishUpdate (void)
 			X_mainWindow,
 			X_gc,
 			image,
-			0, 0,
-			0, 0,
-			X_width, X_height );
+			0, top,
+			0, top,
+			X_width, bottom-top );
 
 	// sync up with server
 	XSync(X_display, False);
@@ -535,12 +613,64 @@ void I_ReadScreen (byte* scr)
 //
 static XColor	colors[256];
 
+//
+// I_TrueComponent
+// Places an 8 bit colour component under a visual's mask.
+//
+static unsigned
+I_TrueComponent
+( int		c,
+  unsigned long	mask )
+{
+    int		shift;
+    int		bits;
+
+    for (shift=0 ; !(mask & 1) ; shift++)
+	mask >>= 1;
+    for (bits=0 ; mask & 1 ; bits++)
+	mask >>= 1;
+
+    if (bits < 8)
+	return (c >> (8-bits)) << shift;
+    return c << (shift+bits-8);
+}
+
 void UploadNewPalette(Colormap cmap, byte *palette)
 {
 
     register int	i;
     register int	c;
     static boolean	firstcall = true;
+    unsigned		p;
+    union
+    {
+	unsigned	u;
+	byte		b[4];
+    } order;
+
+    if (truecolor)
+    {
+	// the pixels go into the image in the server's byte order
+	order.u = 1;
+	
+	for (i=0 ; i<256 ; i++)
+	{
+	    c = gammatable[usegamma][*palette++];
+	    p = I_TrueComponent (c, X_visual->red_mask);
+	    c = gammatable[usegamma][*palette++];
+	    p |= I_TrueComponent (c, X_visual->green_mask);
+	    c = gammatable[usegamma][*palette++];
+	    p |= I_TrueComponent (c, X_visual->blue_mask);
+
+	    if ((image->byte_order == MSBFirst) == (order.b[0] == 1))
+		p = (p>>24) | ((p>>8)&0xff00) | ((p<<8)&0xff0000) | (p<<24);
+	    truepalette[i] = p;
+	}
+
+	// every row has to be expanded again
+	expandall = true;
+	return;
+    }
 
 #ifdef __cplusplus
     if (X_visualinfo.c_class == PseudoColor && X_visualinfo.depth == 8)
@@ -728,6 +858,24 @@ void I_InitGraphics(void)
     X_width = SCREENWIDTH * multiply;
     X_height = SCREENHEIGHT * multiply;
 
+    // any other window size is scaled to
+    if ( (pnum=M_CheckParm("-winwidth")) && pnum < myargc-1)
+	X_width = atoi (myargv[pnum+1]);
+    if ( (pnum=M_CheckParm("-winheight")) && pnum < myargc-1)
+	X_height = atoi (myargv[pnum+1]);
+
+    if (X_width < 1 || X_height < 1)
+	I_Error ("bad -winwidth or -winheight");
+
+    if (X_width != SCREENWIDTH * multiply)
+    {
+	xsource = malloc (X_width*sizeof(*xsource));
+	if (!xsource)
+	    I_Error ("I_InitGraphics: couldn't malloc xsource");
+	for (n=0 ; n<X_width ; n++)
+	    xsource[n] = n*SCREENWIDTH/X_width;
+    }
+
     // check for command-line display name
     if ( (pnum=M_CheckParm("-disp")) ) // suggest parentheses around assignment
 	displayname = myargv[pnum+1];
@@ -766,10 +914,15 @@ void I_InitGraphics(void)
 	    I_Error("Could not open display (DISPLAY=[%s])", getenv("DISPLAY"));
     }
 
-    // use the default visual 
+    // prefer a TrueColor visual, palette changes
+    //  then only rebuild truepalette
     X_screen = DefaultScreen(X_display);
-    if (!XMatchVisualInfo(X_display, X_screen, 8, PseudoColor, &X_visualinfo))
-	I_Error("xdoom currently only supports 256-color PseudoColor screens");
+    if (XMatchVisualInfo(X_display, X_screen, 24, TrueColor, &X_visualinfo))
+	truecolor = true;
+    else if (!XMatchVisualInfo(X_display, X_screen, 8, PseudoColor,
+			       &X_visualinfo))
+	I_Error("xdoom needs a 24 bit TrueColor or 256-color "
+		"PseudoColor screen");
     X_visual = X_visualinfo.visual;
 
     // check for the MITSHM extension
@@ -792,7 +945,8 @@ void I_InitGraphics(void)
 
     // create the colormap
     X_cmap = XCreateColormap(X_display, RootWindow(X_display,
-						   X_screen), X_visual, AllocAll);
+						   X_screen), X_visual,
+			     truecolor ? AllocNone : AllocAll);
 
     // setup attributes for main window
     attribmask = CWEventMask | CWColormap | CWBorderPixel;
@@ -811,7 +965,7 @@ void I_InitGraphics(void)
 					x, y,
 					X_width, X_height,
 					0, // borderwidth
-					8, // depth
+					X_visualinfo.depth,
 					InputOutput,
 					X_visual,
 					attribmask,
@@ -858,7 +1012,7 @@ void I_InitGraphics(void)
 	// create the image
 	image = XShmCreateImage(	X_display,
 					X_visual,
-					8,
+					X_visualinfo.depth,
 					ZPixmap,
 					0,
 					&X_shminfo,
@@ -897,154 +1051,26 @@ void I_InitGraphics(void)
     {
 	image = XCreateImage(	X_display,
     				X_visual,
-    				8,
+    				X_visualinfo.depth,
     				ZPixmap,
     				0,
-    				(char*)malloc(X_width * X_height),
+    				(char*)malloc(X_width * X_height
+					      * (truecolor ? 4 : 1)),
     				X_width, X_height,
-    				8,
-    				X_width );
-
-    }
+    				truecolor ? 32 : 8,
+    				0 );
 
-    if (multiply == 1)
-	screens[0] = (unsigned char *) (image->data);
-    else
-	screens[0] = (unsigned char *) malloc (SCREENWIDTH * SCREENHEIGHT);
-
-}
-
-
-unsigned	exptable[256];
-
-void InitExpand (void)
-{
-    int		i;
-	
-    for (i=0 ; i<256 ; i++)
-	exptable[i] = i | (i<<8) | (i<<16) | (i<<24);
-}
-
-double		exptable2[256*256];
-
-void InitExpand2 (void)
-{
-    int		i;
-    int		j;
-    // UNUSED unsigned	iexp, jexp;
-    double*	exp;
-    union
-    {
-	double 		d;
-	unsigned	u[2];
-    } pixel;
-	
-    printf ("building exptable2...\n");
-    exp = exptable2;
-    for (i=0 ; i<256 ; i++)
-    {
-	pixel.u[0] = i | (i<<8) | (i<<16) | (i<<24);
-	for (j=0 ; j<256 ; j++)
-	{
-	    pixel.u[1] = j | (j<<8) | (j<<16) | (j<<24);
-	    *exp++ = pixel.d;
-	}
     }
-    printf ("done.\n");
-}
 
-int	inited;
+    if (truecolor && image->bits_per_pixel != 32)
+	I_Error("I_InitGraphics: %i bits per TrueColor pixel, need 32",
+		image->bits_per_pixel);
 
-void
-Expand4
-( unsigned*	lineptr,
-  double*	xline )
-{
-    double	dpixel;
-    unsigned	x;
-    unsigned 	y;
-    unsigned	fourpixels;
-    unsigned	step;
-    double*	exp;
-	
-    exp = exptable2;
-    if (!inited)
-    {
-	inited = 1;
-	InitExpand2 ();
-    }
-		
-		
-    step = 3*SCREENWIDTH/2;
-	
-    y = SCREENHEIGHT-1;
-    do
-    {
-	x = SCREENWIDTH;
+    // screens[0] stays as allocated by V_Init,
+    //  the first blit expands every row
+    lastscreen = (byte *) malloc (SCREENWIDTH * SCREENHEIGHT);
+    if (!lastscreen)
+	I_Error("I_InitGraphics: couldn't malloc lastscreen");
+    expandall = true;
 
-	do
-	{
-	    fourpixels = lineptr[0];
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff0000)>>13) );
-	    xline[0] = dpixel;
-	    xline[160] = dpixel;
-	    xline[320] = dpixel;
-	    xline[480] = dpixel;
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff)<<3 ) );
-	    xline[1] = dpixel;
-	    xline[161] = dpixel;
-	    xline[321] = dpixel;
-	    xline[481] = dpixel;
-
-	    fourpixels = lineptr[1];
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff0000)>>13) );
-	    xline[2] = dpixel;
-	    xline[162] = dpixel;
-	    xline[322] = dpixel;
-	    xline[482] = dpixel;
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff)<<3 ) );
-	    xline[3] = dpixel;
-	    xline[163] = dpixel;
-	    xline[323] = dpixel;
-	    xline[483] = dpixel;
-
-	    fourpixels = lineptr[2];
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff0000)>>13) );
-	    xline[4] = dpixel;
-	    xline[164] = dpixel;
-	    xline[324] = dpixel;
-	    xline[484] = dpixel;
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff)<<3 ) );
-	    xline[5] = dpixel;
-	    xline[165] = dpixel;
-	    xline[325] = dpixel;
-	    xline[485] = dpixel;
-
-	    fourpixels = lineptr[3];
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff0000)>>13) );
-	    xline[6] = dpixel;
-	    xline[166] = dpixel;
-	    xline[326] = dpixel;
-	    xline[486] = dpixel;
-			
-	    dpixel = *(double *)( (int)exp + ( (fourpixels&0xffff)<<3 ) );
-	    xline[7] = dpixel;
-	    xline[167] = dpixel;
-	    xline[327] = dpixel;
-	    xline[487] = dpixel;
-
-	    lineptr+=4;
-	    xline+=8;
-	} while (x-=16);
-	xline += step;
-    } while (y--);
 }
-
-
@@ -0,0 +1,484 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Per frame subsystem timing for -timedemo benchmarks.
+//	Timings are kept in microseconds, plus a few counts,
+//	one row per frame, and dumped as CSV or JSON
+//	when the demo ends.
+//	Also the -zonestats overlay and exit summary,
+//	and the -ticstats lateness histogram.
+//
+//-----------------------------------------------------------------------------
+
+static const char
+rcsid[] = "$Id: m_bench.c,v 1.0 1997/12/23 12:00:00 b1 Exp $";
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+#include "doomstat.h"
+#include "i_system.h"
+#include "z_zone.h"
+#include "m_menu.h"
+
+#ifdef __GNUG__
+#pragma implementation "m_bench.h"
+#endif
+#include "m_bench.h"
+
+
+// Total frame time is stored after the sections,
+//  the counters come last.
+#define FRAMECOLUMN	NUMBENCHSECTIONS
+#define COUNTCOLUMN	(NUMBENCHSECTIONS+1)
+#define BENCHCOLUMNS	(COUNTCOLUMN+NUMBENCHCOUNTERS)
+
+static char*	sectionnames[BENCHCOLUMNS] =
+{
+    "bsp",
+    "planes",
+    "masked",
+    "ticker",
+    "blit",
+    "frame",
+    "sprites",
+    "sightrej",
+    "sightpr",
+    "sightch",
+    "sighttr"
+};
+
+boolean		benchmarking;
+
+static char*	benchfile;
+static boolean	benchjson;
+
+// Accumulators for the frame in progress.
+static unsigned	benchstart[NUMBENCHSECTIONS];
+static unsigned	benchaccum[NUMBENCHSECTIONS];
+static unsigned	benchcount[NUMBENCHCOUNTERS];
+static unsigned	framestart;
+
+// BENCHCOLUMNS per frame, realloced as frames come in.
+static unsigned*	samples;
+static int		numframes;
+static int		maxframes;
+
+
+
+//
+// M_BenchInit
+//
+void M_BenchInit (char* filename)
+{
+    int		len;
+    
+    benchfile = filename;
+    len = strlen (filename);
+    benchjson = len > 5 && !strcasecmp (filename+len-5, ".json");
+
+    numframes = maxframes = 0;
+    samples = NULL;
+    memset (benchaccum, 0, sizeof(benchaccum));
+    memset (benchcount, 0, sizeof(benchcount));
+    framestart = I_GetTimeUS ();
+    
+    benchmarking = true;
+}
+
+
+//
+// M_BenchBegin
+//
+void M_BenchBegin (benchsection_t section)
+{
+    if (!benchmarking)
+	return;
+    benchstart[section] = I_GetTimeUS ();
+}
+
+
+//
+// M_BenchEnd
+//
+void M_BenchEnd (benchsection_t section)
+{
+    if (!benchmarking)
+	return;
+    benchaccum[section] += I_GetTimeUS () - benchstart[section];
+}
+
+
+//
+// M_BenchCount
+//
+void M_BenchCount (benchcounter_t counter, int count)
+{
+    if (!benchmarking)
+	return;
+    benchcount[counter] += count;
+}
+
+
+//
+// M_BenchFrame
+// Closes the current frame and starts the next.
+//
+void M_BenchFrame (void)
+{
+    unsigned	now;
+    unsigned*	row;
+    
+    if (!benchmarking)
+	return;
+
+    if (numframes == maxframes)
+    {
+	maxframes = maxframes ? maxframes*2 : 1024;
+	samples = realloc (samples,
+			   maxframes*BENCHCOLUMNS*sizeof(*samples));
+	if (!samples)
+	    I_Error ("M_BenchFrame: couldn't realloc samples");
+    }
+
+    now = I_GetTimeUS ();
+    row = samples + numframes*BENCHCOLUMNS;
+    memcpy (row, benchaccum, sizeof(benchaccum));
+    row[FRAMECOLUMN] = now - framestart;
+    memcpy (row+COUNTCOLUMN, benchcount, sizeof(benchcount));
+    numframes++;
+
+    memset (benchaccum, 0, sizeof(benchaccum));
+    memset (benchcount, 0, sizeof(benchcount));
+    framestart = now;
+}
+
+
+
+static int CompareSamples (const void* a, const void* b)
+{
+    unsigned	x = *(const unsigned *)a;
+    unsigned	y = *(const unsigned *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+
+//
+// Sorts one column into sorted,
+//  returns min/median/p99 in stats.
+//
+static void
+BenchColumnStats
+( int		column,
+  unsigned*	sorted,
+  unsigned*	stats )
+{
+    int		i;
+    int		p99;
+
+    for (i=0 ; i<numframes ; i++)
+	sorted[i] = samples[i*BENCHCOLUMNS + column];
+    qsort (sorted, numframes, sizeof(*sorted), CompareSamples);
+
+    p99 = (numframes*99 + 99)/100 - 1;
+    
+    stats[0] = sorted[0];
+    stats[1] = sorted[numframes/2];
+    stats[2] = sorted[p99];
+}
+
+
+//
+// M_BenchReport
+//
+void M_BenchReport (void)
+{
+    FILE*	f;
+    unsigned*	sorted;
+    unsigned*	row;
+    unsigned	stats[BENCHCOLUMNS][3];
+    int		i;
+    int		j;
+
+    if (!benchmarking)
+	return;
+    benchmarking = false;
+
+    if (!numframes)
+    {
+	printf ("M_BenchReport: no frames recorded\n");
+	return;
+    }
+
+    sorted = malloc (numframes*sizeof(*sorted));
+    if (!sorted)
+	I_Error ("M_BenchReport: couldn't malloc %i samples", numframes);
+    
+    for (j=0 ; j<BENCHCOLUMNS ; j++)
+	BenchColumnStats (j, sorted, stats[j]);
+    free (sorted);
+
+    printf ("benchmark: %i frames, microseconds (counts) "
+	    "min/median/p99\n", numframes);
+    for (j=0 ; j<BENCHCOLUMNS ; j++)
+	printf ("  %-8s %8u %8u %8u\n", sectionnames[j],
+		stats[j][0], stats[j][1], stats[j][2]);
+
+    f = fopen (benchfile, "w");
+    if (!f)
+    {
+	printf ("M_BenchReport: couldn't write %s\n", benchfile);
+	return;
+    }
+
+    if (benchjson)
+    {
+	fprintf (f, "{\n  \"frames\": %i,\n  \"summary\": {\n", numframes);
+	for (j=0 ; j<BENCHCOLUMNS ; j++)
+	    fprintf (f, "    \"%s\": { \"min\": %u, \"median\": %u, "
+		     "\"p99\": %u }%s\n",
+		     sectionnames[j], stats[j][0], stats[j][1], stats[j][2],
+		     j<BENCHCOLUMNS-1 ? "," : "");
+	fprintf (f, "  },\n  \"columns\": [");
+	for (j=0 ; j<BENCHCOLUMNS ; j++)
+	    fprintf (f, "\"%s\"%s", sectionnames[j],
+		     j<BENCHCOLUMNS-1 ? ", " : "");
+	fprintf (f, "],\n  \"samples\": [\n");
+
+	for (i=0, row=samples ; i<numframes ; i++, row+=BENCHCOLUMNS)
+	{
+	    fprintf (f, "    [");
+	    for (j=0 ; j<BENCHCOLUMNS ; j++)
+		fprintf (f, "%u%s", row[j], j<BENCHCOLUMNS-1 ? ", " : "");
+	    fprintf (f, "]%s\n", i<numframes-1 ? "," : "");
+	}
+	fprintf (f, "  ]\n}\n");
+    }
+    else
+    {
+	// Summary as comment lines, then one row per frame.
+	for (j=0 ; j<BENCHCOLUMNS ; j++)
+	    fprintf (f, "# %s min %u median %u p99 %u\n",
+		     sectionnames[j], stats[j][0], stats[j][1], stats[j][2]);
+
+	fprintf (f, "frame");
+	for (j=0 ; j<BENCHCOLUMNS ; j++)
+	    fprintf (f, ",%s", sectionnames[j]);
+	fprintf (f, "\n");
+
+	for (i=0, row=samples ; i<numframes ; i++, row+=BENCHCOLUMNS)
+	{
+	    fprintf (f, "%i", i);
+	    for (j=0 ; j<BENCHCOLUMNS ; j++)
+		fprintf (f, ",%u", row[j]);
+	    fprintf (f, "\n");
+	}
+    }
+    
+    fclose (f);
+    printf ("benchmark written to %s\n", benchfile);
+}
+
+
+
+//
+// ZONE STATISTICS
+//
+boolean		zonestats;
+
+// Allocations per tic, from the totals at the last new tic.
+static int	statstic;
+static unsigned long long	statsallocs;
+static unsigned long long	statsbytes;
+static int	ticallocs;
+static int	ticbytes;
+
+
+//
+// M_ZoneStatsLines
+// Formats the statistics, one line per call,
+//  returns false when there are no more.
+//
+static boolean
+M_ZoneStatsLines
+( zonestats_t*	stats,
+  int		line,
+  char*		text )
+{
+    int		frag;
+    int		t;
+
+    // share of the free space not in the largest block
+    frag = stats->freebytes ?
+	100 - (int)((long long)stats->largestfree*100/stats->freebytes) : 0;
+    
+    switch (line)
+    {
+      case 0:
+	sprintf (text, "zone %ik in %i arenas",
+		 stats->zonesize>>10, stats->arenas);
+	return true;
+      case 1:
+	sprintf (text, "free %ik in %i, largest %ik, frag %i%%",
+		 stats->freebytes>>10, stats->freeblocks,
+		 stats->largestfree>>10, frag);
+	return true;
+      case 2:
+	sprintf (text, "slab free %ik, purges %llu",
+		 stats->slabfree>>10, stats->purges);
+	return true;
+      case 3:
+	sprintf (text, "allocs %llu, per tic %i (%ik)",
+		 stats->allocs, ticallocs, ticbytes>>10);
+	return true;
+    }
+
+    t = line - 4;
+    if (t >= NUMZONETAGS)
+	return false;
+    sprintf (text, "%s %ik", zonetagnames[t], stats->tagbytes[t]>>10);
+    return true;
+}
+
+
+//
+// M_DrawZoneStats
+//
+void M_DrawZoneStats (void)
+{
+    zonestats_t	stats;
+    char	text[80];
+    int		line;
+
+    if (!zonestats)
+	return;
+
+    Z_GetStats (&stats);
+
+    if (gametic > statstic)
+    {
+	ticallocs = (stats.allocs - statsallocs) / (gametic - statstic);
+	ticbytes = (stats.allocbytes - statsbytes) / (gametic - statstic);
+	statstic = gametic;
+	statsallocs = stats.allocs;
+	statsbytes = stats.allocbytes;
+    }
+
+    for (line=0 ; M_ZoneStatsLines (&stats, line, text) ; line++)
+	M_WriteText (4, 24+line*8, text);
+}
+
+
+//
+// M_ZoneStatsReport
+//
+void M_ZoneStatsReport (void)
+{
+    zonestats_t	stats;
+    char	text[80];
+    int		line;
+
+    if (!zonestats)
+	return;
+
+    Z_GetStats (&stats);
+    
+    printf ("zone statistics:\n");
+    for (line=0 ; M_ZoneStatsLines (&stats, line, text) ; line++)
+	printf ("  %s\n", text);
+}
+
+
+
+//
+// TIC LATENESS
+//
+boolean		ticstats;
+
+// Upper bounds in microseconds, the last bucket
+//  takes everything later than two tics.
+#define NUMLATEBUCKETS	6
+
+static int	latebounds[NUMLATEBUCKETS-1] =
+{
+    250, 1000, 5000, 1000000/TICRATE, 2*1000000/TICRATE
+};
+
+static int	latebuckets[NUMLATEBUCKETS];
+static int	latebatches;
+static int	latetics;
+static int	catchuptics;
+static int	latemax;
+static long long latetotal;
+
+
+//
+// M_TicLate
+//
+void M_TicLate (int us, int tics)
+{
+    int		i;
+
+    if (!ticstats)
+	return;
+
+    if (us < 0)
+	us = 0;
+    
+    for (i=0 ; i<NUMLATEBUCKETS-1 ; i++)
+	if (us < latebounds[i])
+	    break;
+    latebuckets[i]++;
+
+    latebatches++;
+    latetics += tics;
+    catchuptics += tics-1;
+    latetotal += us;
+    if (us > latemax)
+	latemax = us;
+}
+
+
+//
+// M_TicStatsReport
+//
+void M_TicStatsReport (void)
+{
+    int		i;
+
+    if (!ticstats || !latebatches)
+	return;
+
+    printf ("tic lateness: %i tics in %i runs, %i caught up\n",
+	    latetics, latebatches, catchuptics);
+    printf ("  mean %i us, max %i us\n",
+	    (int)(latetotal / latebatches), latemax);
+    for (i=0 ; i<NUMLATEBUCKETS ; i++)
+    {
+	if (i < NUMLATEBUCKETS-1)
+	    printf ("  < %6i us", latebounds[i]);
+	else
+	    printf ("  >=%6i us", latebounds[i-1]);
+	printf (" %6i (%i%%)\n", latebuckets[i],
+		latebuckets[i]*100/latebatches);
+    }
+}
@@ -0,0 +1,113 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Per frame subsystem timing for -timedemo benchmarks,
+//	zone memory statistics for -zonestats.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __M_BENCH__
+#define __M_BENCH__
+
+
+#include "doomtype.h"
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+//
+// Timed sections.
+// One accumulator each, summed over a frame.
+//
+typedef enum
+{
+    bs_bsp,		// R_RenderBSPNode
+    bs_planes,		// R_DrawPlanes
+    bs_masked,		// R_DrawMasked
+    bs_ticker,		// P_Ticker
+    bs_blit,		// I_FinishUpdate
+    NUMBENCHSECTIONS
+    
+} benchsection_t;
+
+
+//
+// Per frame counts, reported like the timings.
+//
+typedef enum
+{
+    bc_sprites,		// vissprites sorted and drawn
+    bc_sightreject,	// P_CheckSight answered by REJECT,
+    bc_sightpair,	//  the subsector pair table,
+    bc_sightcache,	//  the sight cache,
+    bc_sighttrace,	//  or a trace
+    NUMBENCHCOUNTERS
+    
+} benchcounter_t;
+
+
+// True while a -bench run collects samples.
+extern boolean	benchmarking;
+
+
+// Start collecting, report goes to filename.
+// A .json extension selects JSON, anything else CSV.
+void M_BenchInit (char* filename);
+
+void M_BenchBegin (benchsection_t section);
+void M_BenchEnd (benchsection_t section);
+
+// Adds to a counter of the current frame.
+void M_BenchCount (benchcounter_t counter, int count);
+
+// Called once per displayed frame by D_DoomLoop.
+void M_BenchFrame (void);
+
+// Writes the samples and prints min/median/p99.
+void M_BenchReport (void);
+
+
+// True with -zonestats.
+extern boolean	zonestats;
+
+// Zone statistics overlay, called by D_Display.
+void M_DrawZoneStats (void);
+
+// Prints the zone statistics, called by I_Quit.
+void M_ZoneStatsReport (void);
+
+
+// True with -ticstats.
+extern boolean	ticstats;
+
+// Called by TryRunTics for each run of tics,
+//  us after the first of them was due.
+void M_TicLate (int us, int tics);
+
+// Prints the lateness histogram, called by I_Quit.
+void M_TicStatsReport (void);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -54,6 +54,9 @@ void M_Init (void);
 // does nothing if menu is already up.
 void M_StartControlPanel (void);
 
+// Writes a string with the hu_font into the screen buffer.
+void M_WriteText (int x, int y, char* string);
+
 
 
 
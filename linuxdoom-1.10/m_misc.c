@@ -87,7 +87,7 @@ M_DrawText
 	}
 		
 	w = SHORT (hu_font[c]->width);
-	if (x+w > SCREENWIDTH)
+	if (x+w > ORIGWIDTH)
 	    break;
 	if (direct)
 	    V_DrawPatchDirect(x, y, 0, hu_font[c]);
@@ -279,7 +279,7 @@ default_t	defaults[] =
     {"screenblocks",&screenblocks, 9},
     {"detaillevel",&detailLevel, 0},
 
-    {"snd_channels",&numChannels, 3},
+    {"snd_channels",&numChannels, 8},
 
 
 
@@ -35,6 +35,9 @@ int M_Random (void);
 // As M_Random, but used only by the play simulation.
 int P_Random (void);
 
+// Position in the table of P_Random.
+extern int	prndindex;
+
 // Fix randoms for demos.
 void M_ClearRandom (void);
 
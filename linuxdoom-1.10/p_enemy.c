@@ -510,9 +510,9 @@ P_LookForPlayers
     sector = actor->subsector->sector;
 	
     c = 0;
-    stop = (actor->lastlook-1)&3;
+    stop = (actor->lastlook+MAXPLAYERS-1)%MAXPLAYERS;
 	
-    for ( ; ; actor->lastlook = (actor->lastlook+1)&3 )
+    for ( ; ; actor->lastlook = (actor->lastlook+1)%MAXPLAYERS )
     {
 	if (!playeringame[actor->lastlook])
 	    continue;
@@ -1013,6 +1013,7 @@ void A_SkelMissile (mobj_t* actor)
 
     mo->x += mo->momx;
     mo->y += mo->momy;
+    P_MoveBlockThing (mo);
     mo->tracer = actor->target;
 }
 
@@ -1810,6 +1811,9 @@ mobj_t*		braintargets[32];
 int		numbraintargets;
 int		braintargeton;
 
+// A_BrainSpit only spits every other call on easy.
+int		braineasy;
+
 void A_BrainAwake (mobj_t* mo)
 {
     thinker_t*	thinker;
@@ -1903,10 +1907,8 @@ void A_BrainSpit (mobj_t*	mo)
     mobj_t*	targ;
     mobj_t*	newmobj;
     
-    static int	easy = 0;
-	
-    easy ^= 1;
-    if (gameskill <= sk_easy && (!easy))
+    braineasy ^= 1;
+    if (gameskill <= sk_easy && (!braineasy))
 	return;
 		
     // shoot a cube at current target
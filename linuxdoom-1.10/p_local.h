@@ -132,6 +132,24 @@ void P_NoiseAlert (mobj_t* target, mobj_t* emmiter);
 //
 // P_MAPUTL
 //
+
+// A thing linked into a mapblock, with the position
+// and radius it had when it was linked.
+typedef struct
+{
+    mobj_t*	mobj;
+    fixed_t	x;
+    fixed_t	y;
+    fixed_t	radius;
+} blockthing_t;
+
+typedef struct
+{
+    blockthing_t*	things;		// oldest link first
+    int			numthings;
+    int			maxthings;
+} blocklink_t;
+
 typedef struct
 {
     fixed_t	x;
@@ -175,6 +193,13 @@ void 	P_LineOpening (line_t* linedef);
 boolean P_BlockLinesIterator (int x, int y, boolean(*func)(line_t*) );
 boolean P_BlockThingsIterator (int x, int y, boolean(*func)(mobj_t*) );
 
+boolean
+P_BlockThingsFilterIterator
+( int		x,
+  int		y,
+  boolean	(*filter)(blockthing_t*),
+  boolean	(*func)(mobj_t*) );
+
 #define PT_ADDLINES		1
 #define PT_ADDTHINGS	2
 #define PT_EARLYOUT		4
@@ -190,8 +215,10 @@ P_PathTraverse
   int		flags,
   boolean	(*trav) (intercept_t *));
 
+blockthing_t* P_AddBlockThing (blocklink_t* link);
 void P_UnsetThingPosition (mobj_t* thing);
 void P_SetThingPosition (mobj_t* thing);
+void P_MoveBlockThing (mobj_t* thing);
 
 
 //
@@ -212,6 +239,12 @@ boolean P_TryMove (mobj_t* thing, fixed_t x, fixed_t y);
 boolean P_TeleportMove (mobj_t* thing, fixed_t x, fixed_t y);
 void	P_SlideMove (mobj_t* mo);
 boolean P_CheckSight (mobj_t* t1, mobj_t* t2);
+
+// Bumped on every sector height change.
+extern int	sightepoch;
+
+void	P_InitSight (void);
+void	P_ClearSightCache (void);
 void 	P_UseLines (player_t* player);
 
 boolean P_ChangeSector (sector_t* sector, boolean crunch);
@@ -250,7 +283,7 @@ extern int		bmapwidth;
 extern int		bmapheight;	// in mapblocks
 extern fixed_t		bmaporgx;
 extern fixed_t		bmaporgy;	// origin of block map
-extern mobj_t**		blocklinks;	// for thing chains
+extern blocklink_t*	blocklinks;	// things in each mapblock
 
 
 
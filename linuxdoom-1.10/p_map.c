@@ -71,6 +71,22 @@ int		numspechit;
 
 
 
+//
+// PIF_ThingInReach
+// Mapblock filter for PIT_StompThing and PIT_CheckThing,
+// which ignore anything further than the two radii apart.
+//
+static boolean PIF_ThingInReach (blockthing_t* bt)
+{
+    fixed_t	blockdist;
+
+    blockdist = bt->radius + tmthing->radius;
+
+    return abs(bt->x - tmx) < blockdist
+	&& abs(bt->y - tmy) < blockdist;
+}
+
+
 //
 // TELEPORT MOVE
 // 
@@ -159,7 +175,8 @@ P_TeleportMove
 
     for (bx=xl ; bx<=xh ; bx++)
 	for (by=yl ; by<=yh ; by++)
-	    if (!P_BlockThingsIterator(bx,by,PIT_StompThing))
+	    if (!P_BlockThingsFilterIterator(bx,by,PIF_ThingInReach,
+					     PIT_StompThing))
 		return false;
     
     // the move is ok,
@@ -424,7 +441,8 @@ P_CheckPosition
 
     for (bx=xl ; bx<=xh ; bx++)
 	for (by=yl ; by<=yh ; by++)
-	    if (!P_BlockThingsIterator(bx,by,PIT_CheckThing))
+	    if (!P_BlockThingsFilterIterator(bx,by,PIF_ThingInReach,
+					     PIT_CheckThing))
 		return false;
     
     // check lines
@@ -1198,6 +1216,26 @@ boolean PIT_RadiusAttack (mobj_t* thing)
 }
 
 
+//
+// PIF_ThingInBlast
+// Mapblock filter for PIT_RadiusAttack.
+//
+static boolean PIF_ThingInBlast (blockthing_t* bt)
+{
+    fixed_t	dx;
+    fixed_t	dy;
+    fixed_t	dist;
+
+    dx = abs(bt->x - bombspot->x);
+    dy = abs(bt->y - bombspot->y);
+
+    dist = dx>dy ? dx : dy;
+    dist = (dist - bt->radius) >> FRACBITS;
+
+    return dist < bombdamage;
+}
+
+
 //
 // P_RadiusAttack
 // Source is the creature that caused the explosion at spot.
@@ -1229,7 +1267,8 @@ P_RadiusAttack
 	
     for (y=yl ; y<=yh ; y++)
 	for (x=xl ; x<=xh ; x++)
-	    P_BlockThingsIterator (x, y, PIT_RadiusAttack );
+	    P_BlockThingsFilterIterator (x, y, PIF_ThingInBlast,
+					 PIT_RadiusAttack );
 }
 
 
@@ -1327,6 +1366,9 @@ P_ChangeSector
 	
     nofit = false;
     crushchange = crunch;
+
+    // cached sight checks through here are stale
+    sector->sightstamp = ++sightepoch;
 	
     // re-check heights for all things near the moving sector
     for (x=sector->blockbox[BOXLEFT] ; x<= sector->blockbox[BOXRIGHT] ; x++)
@@ -29,9 +29,12 @@ rcsid[] = "$Id: p_maputl.c,v 1.5 1997/02/03 22:45:11 b1 Exp $";
 
 
 #include <stdlib.h>
+#include <string.h>
 
 
 #include "m_bbox.h"
+#include "i_system.h"
+#include "z_zone.h"
 
 #include "doomdef.h"
 #include "p_local.h"
@@ -336,6 +339,84 @@ void P_LineOpening (line_t* linedef)
 // THING POSITION SETTING
 //
 
+// Each mapblock keeps its things in a contiguous array,
+// oldest link first, with a copy of the position and
+// radius taken when the thing was linked, so the block
+// iterators can reject most things without touching them.
+// Things move by being unlinked and relinked, except for
+// the missile spawn nudges, which refresh the copy with
+// P_MoveBlockThing.  Radius only ever shrinks, so the
+// copies are safe to reject on.  Each thing remembers its
+// mapblock, and is unlinked from that one even if it has
+// since been nudged out of it.
+
+// Iterators currently walking a block, innermost first.
+// Removing a thing shifts the newer things in its block
+// down one slot, so the cursors have to follow.
+typedef struct blockiter_s
+{
+    blocklink_t*	link;
+    int			index;
+    struct blockiter_s*	prev;
+} blockiter_t;
+
+static blockiter_t*	blockiters;
+
+
+//
+// P_BlockLinkForPoint
+// Returns the mapblock containing x,y,
+// or NULL when it is off the map.
+//
+static blocklink_t*
+P_BlockLinkForPoint
+( fixed_t	x,
+  fixed_t	y )
+{
+    int		blockx;
+    int		blocky;
+
+    blockx = (x - bmaporgx)>>MAPBLOCKSHIFT;
+    blocky = (y - bmaporgy)>>MAPBLOCKSHIFT;
+
+    if (blockx>=0
+	&& blockx < bmapwidth
+	&& blocky>=0
+	&& blocky < bmapheight)
+    {
+	return &blocklinks[blocky*bmapwidth+blockx];
+    }
+
+    // thing is off the map
+    return NULL;
+}
+
+
+//
+// P_AddBlockThing
+// Returns a new slot at the end of a mapblock.
+//
+blockthing_t* P_AddBlockThing (blocklink_t* link)
+{
+    blockthing_t*	things;
+    
+    if (link->numthings == link->maxthings)
+    {
+	link->maxthings = link->maxthings ? link->maxthings*2 : 4;
+	things = Z_Malloc (link->maxthings*sizeof(*things),
+			   PU_LEVEL, 0);
+	if (link->numthings)
+	{
+	    memcpy (things, link->things,
+		    link->numthings*sizeof(*things));
+	    Z_Free (link->things);
+	}
+	link->things = things;
+    }
+
+    return &link->things[link->numthings++];
+}
+
 
 //
 // P_UnsetThingPosition
@@ -346,8 +427,9 @@ void P_LineOpening (line_t* linedef)
 //
 void P_UnsetThingPosition (mobj_t* thing)
 {
-    int		blockx;
-    int		blocky;
+    blocklink_t*	link;
+    blockiter_t*	iter;
+    int			i;
 
     if ( ! (thing->flags & MF_NOSECTOR) )
     {
@@ -362,26 +444,29 @@ void P_UnsetThingPosition (mobj_t* thing)
 	    thing->subsector->sector->thinglist = thing->snext;
     }
 	
-    if ( ! (thing->flags & MF_NOBLOCKMAP) )
+    if (thing->blockindex >= 0)
     {
-	// inert things don't need to be in blockmap
-	// unlink from block map
-	if (thing->bnext)
-	    thing->bnext->bprev = thing->bprev;
-	
-	if (thing->bprev)
-	    thing->bprev->bnext = thing->bnext;
-	else
-	{
-	    blockx = (thing->x - bmaporgx)>>MAPBLOCKSHIFT;
-	    blocky = (thing->y - bmaporgy)>>MAPBLOCKSHIFT;
-
-	    if (blockx>=0 && blockx < bmapwidth
-		&& blocky>=0 && blocky <bmapheight)
-	    {
-		blocklinks[blocky*bmapwidth+blockx] = thing->bnext;
-	    }
-	}
+	// unlink from the block it was linked into,
+	// which is not always the one under it now
+	link = &blocklinks[thing->blockindex];
+
+	for (i = link->numthings-1 ; i>=0 ; i--)
+	    if (link->things[i].mobj == thing)
+		break;
+
+	if (i < 0)
+	    I_Error ("P_UnsetThingPosition: thing not in mapblock %i",
+		     thing->blockindex);
+
+	thing->blockindex = -1;
+	link->numthings--;
+	memmove (&link->things[i], &link->things[i+1],
+		 (link->numthings-i)*sizeof(*link->things));
+
+	// keep any iterator in this block on its current thing
+	for (iter = blockiters ; iter ; iter = iter->prev)
+	    if (iter->link == link && iter->index > i)
+		iter->index--;
     }
 }
 
@@ -397,9 +482,8 @@ P_SetThingPosition (mobj_t* thing)
 {
     subsector_t*	ss;
     sector_t*		sec;
-    int			blockx;
-    int			blocky;
-    mobj_t**		link;
+    blocklink_t*	link;
+    blockthing_t*	bt;
 
     
     // link into subsector
@@ -422,34 +506,54 @@ P_SetThingPosition (mobj_t* thing)
 
     
     // link into blockmap
+    thing->blockindex = -1;
     if ( ! (thing->flags & MF_NOBLOCKMAP) )
     {
 	// inert things don't need to be in blockmap		
-	blockx = (thing->x - bmaporgx)>>MAPBLOCKSHIFT;
-	blocky = (thing->y - bmaporgy)>>MAPBLOCKSHIFT;
+	link = P_BlockLinkForPoint (thing->x, thing->y);
 
-	if (blockx>=0
-	    && blockx < bmapwidth
-	    && blocky>=0
-	    && blocky < bmapheight)
-	{
-	    link = &blocklinks[blocky*bmapwidth+blockx];
-	    thing->bprev = NULL;
-	    thing->bnext = *link;
-	    if (*link)
-		(*link)->bprev = thing;
+	if (!link)
+	    return;
 
-	    *link = thing;
-	}
-	else
-	{
-	    // thing is off the map
-	    thing->bnext = thing->bprev = NULL;
-	}
+	thing->blockindex = link - blocklinks;
+	bt = P_AddBlockThing (link);
+	bt->mobj = thing;
+	bt->x = thing->x;
+	bt->y = thing->y;
+	bt->radius = thing->radius;
     }
 }
 
 
+//
+// P_MoveBlockThing
+// Refreshes the mapblock copy of the position of a thing
+// that was moved without being relinked.  The thing stays
+// in the block it was linked into, as it always has.
+//
+void P_MoveBlockThing (mobj_t* thing)
+{
+    blocklink_t*	link;
+    int			i;
+
+    if (thing->blockindex < 0)
+	return;
+
+    link = &blocklinks[thing->blockindex];
+
+    for (i = link->numthings-1 ; i>=0 ; i--)
+	if (link->things[i].mobj == thing)
+	    break;
+
+    if (i < 0)
+	I_Error ("P_MoveBlockThing: thing not in mapblock %i",
+		 thing->blockindex);
+
+    link->things[i].x = thing->x;
+    link->things[i].y = thing->y;
+}
+
+
 
 //
 // BLOCK MAP ITERATORS
@@ -507,15 +611,21 @@ P_BlockLinesIterator
 
 
 //
-// P_BlockThingsIterator
+// P_BlockThingsFilterIterator
+// Calls func for each thing in the block that filter,
+// given the thing's link time position and radius,
+// doesn't reject. The newest links are visited first,
+// and things linked during the walk are not visited.
 //
 boolean
-P_BlockThingsIterator
+P_BlockThingsFilterIterator
 ( int			x,
   int			y,
+  boolean(*filter)(blockthing_t*),
   boolean(*func)(mobj_t*) )
 {
-    mobj_t*		mobj;
+    blockiter_t		iter;
+    boolean		ok;
 	
     if ( x<0
 	 || y<0
@@ -524,16 +634,41 @@ P_BlockThingsIterator
     {
 	return true;
     }
-    
 
-    for (mobj = blocklinks[y*bmapwidth+x] ;
-	 mobj ;
-	 mobj = mobj->bnext)
+    iter.link = &blocklinks[y*bmapwidth+x];
+    iter.prev = blockiters;
+    blockiters = &iter;
+
+    ok = true;
+    for (iter.index = iter.link->numthings-1 ;
+	 iter.index >= 0 ;
+	 iter.index--)
     {
-	if (!func( mobj ) )
-	    return false;
+	if (filter && !filter (&iter.link->things[iter.index]))
+	    continue;
+	
+	if (!func( iter.link->things[iter.index].mobj ) )
+	{
+	    ok = false;
+	    break;
+	}
     }
-    return true;
+
+    blockiters = iter.prev;
+    return ok;
+}
+
+
+//
+// P_BlockThingsIterator
+//
+boolean
+P_BlockThingsIterator
+( int			x,
+  int			y,
+  boolean(*func)(mobj_t*) )
+{
+    return P_BlockThingsFilterIterator (x, y, NULL, func);
 }
 
 
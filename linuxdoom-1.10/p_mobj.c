@@ -526,6 +526,11 @@ P_SpawnMobj
     else 
 	mobj->z = z;
 
+    mobj->oldx = mobj->x;
+    mobj->oldy = mobj->y;
+    mobj->oldz = mobj->z;
+    mobj->oldangle = mobj->angle;
+
     mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 	
     P_AddThinker (&mobj->thinker);
@@ -666,7 +671,7 @@ void P_SpawnPlayer (mapthing_t* mthing)
 
     // set color translations for player sprites
     if (mthing->type > 1)		
-	mobj->flags |= (mthing->type-1)<<MF_TRANSSHIFT;
+	mobj->flags |= ((mthing->type-1)%ORIGPLAYERS)<<MF_TRANSSHIFT;
 		
     mobj->angle	= ANG45 * (mthing->angle/45);
     mobj->player = p;
@@ -682,6 +687,11 @@ void P_SpawnPlayer (mapthing_t* mthing)
     p->fixedcolormap = 0;
     p->viewheight = VIEWHEIGHT;
 
+    // P_CalcHeight sets it properly on the first tic,
+    //  uncapped frames before then need a sane height
+    p->viewz = mobj->z + VIEWHEIGHT;
+    p->oldviewz = p->viewz;
+
     // setup gun psprite
     P_SetupPsprites (p);
     
@@ -876,6 +886,7 @@ void P_CheckMissileSpawn (mobj_t* th)
     th->x += (th->momx>>1);
     th->y += (th->momy>>1);
     th->z += (th->momz>>1);
+    P_MoveBlockThing (th);
 
     if (!P_TryMove (th, th->x, th->y))
 	P_ExplodeMissile (th);
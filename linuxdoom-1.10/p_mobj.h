@@ -224,9 +224,8 @@ typedef struct mobj_s
     int			frame;	// might be ORed with FF_FULLBRIGHT
 
     // Interaction info, by BLOCKMAP.
-    // Links in blocks (if needed).
-    struct mobj_s*	bnext;
-    struct mobj_s*	bprev;
+    // Mapblock this thing is linked into, or -1.
+    int			blockindex;
     
     struct subsector_s*	subsector;
 
@@ -282,6 +281,13 @@ typedef struct mobj_s
 
     // Thing being chased/attacked for tracers.
     struct mobj_s*	tracer;	
+
+    // Position and angle at the start of the tic,
+    //  uncapped frames are drawn between them and the current ones.
+    fixed_t		oldx;
+    fixed_t		oldy;
+    fixed_t		oldz;
+    angle_t		oldangle;
     
 } mobj_t;
 
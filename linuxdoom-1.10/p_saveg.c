@@ -95,6 +95,7 @@ void P_UnArchivePlayers (void)
 	players[i].mo = NULL;	
 	players[i].message = NULL;
 	players[i].attacker = NULL;
+	players[i].oldviewz = players[i].viewz;
 
 	for (j=0 ; j<NUMPSPRITES ; j++)
 	{
@@ -180,6 +181,8 @@ void P_UnArchiveWorld (void)
     {
 	sec->floorheight = *get++ << FRACBITS;
 	sec->ceilingheight = *get++ << FRACBITS;
+	sec->oldfloorheight = sec->floorheight;
+	sec->oldceilingheight = sec->ceilingheight;
 	sec->floorpic = *get++;
 	sec->ceilingpic = *get++;
 	sec->lightlevel = *get++;
@@ -208,6 +211,7 @@ void P_UnArchiveWorld (void)
 	}
     }
     save_p = (byte *)get;	
+    P_ClearSightCache ();
 }
 
 
@@ -310,6 +314,10 @@ void P_UnArchiveThinkers (void)
 	    mobj->info = &mobjinfo[mobj->type];
 	    mobj->floorz = mobj->subsector->sector->floorheight;
 	    mobj->ceilingz = mobj->subsector->sector->ceilingheight;
+	    mobj->oldx = mobj->x;
+	    mobj->oldy = mobj->y;
+	    mobj->oldz = mobj->z;
+	    mobj->oldangle = mobj->angle;
 	    mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 	    P_AddThinker (&mobj->thinker);
 	    break;
@@ -92,7 +92,7 @@ short*		blockmaplump;
 fixed_t		bmaporgx;
 fixed_t		bmaporgy;
 // for thing chains
-mobj_t**	blocklinks;		
+blocklink_t*	blocklinks;		
 
 
 // REJECT
@@ -110,7 +110,7 @@ byte*		rejectmatrix;
 
 mapthing_t	deathmatchstarts[MAX_DEATHMATCH_STARTS];
 mapthing_t*	deathmatch_p;
-mapthing_t	playerstarts[MAXPLAYERS];
+mapthing_t*	playerstarts;
 
 
 
@@ -246,6 +246,8 @@ void P_LoadSectors (int lump)
     {
 	ss->floorheight = SHORT(ms->floorheight)<<FRACBITS;
 	ss->ceilingheight = SHORT(ms->ceilingheight)<<FRACBITS;
+	ss->oldfloorheight = ss->floorheight;
+	ss->oldceilingheight = ss->ceilingheight;
 	ss->floorpic = R_FlatNumForName(ms->floorpic);
 	ss->ceilingpic = R_FlatNumForName(ms->ceilingpic);
 	ss->lightlevel = SHORT(ms->lightlevel);
@@ -483,7 +485,7 @@ void P_LoadBlockMap (int lump)
     bmapwidth = blockmaplump[2];
     bmapheight = blockmaplump[3];
 	
-    // clear out mobj chains
+    // clear out mapblock thing lists
     count = sizeof(*blocklinks)* bmapwidth*bmapheight;
     blocklinks = Z_Malloc (count,PU_LEVEL, 0);
     memset (blocklinks, 0, count);
@@ -606,6 +608,9 @@ P_SetupLevel
     // Make sure all sounds are stopped before Z_FreeTags.
     S_Start ();			
 
+    // The composite worker draws into PU_LEVEL blocks.
+    R_FinishComposites (true);
+
     
 #if 0 // UNUSED
     if (debugfile)
@@ -658,10 +663,26 @@ P_SetupLevel
 	
     rejectmatrix = W_CacheLumpNum (lumpnum+ML_REJECT,PU_LEVEL);
     P_GroupLines ();
+    P_InitSight ();
 
     bodyqueslot = 0;
     deathmatch_p = deathmatchstarts;
     P_LoadThings (lumpnum+ML_THINGS);
+
+    // players past the map's starts share theirs
+    for (i=ORIGPLAYERS ; i<MAXPLAYERS ; i++)
+    {
+	playerstarts[i] = playerstarts[i%ORIGPLAYERS];
+	playerstarts[i].type = i+1;
+	if (playeringame[i])
+	    players[i].mo = NULL;
+    }
+    if (!deathmatch)
+    {
+	for (i=ORIGPLAYERS ; i<MAXPLAYERS ; i++)
+	    if (playeringame[i])
+		G_ExtraSpawnPlayer (i);
+    }
     
     // if deathmatch, randomly spawn the active players
     if (deathmatch)
@@ -18,6 +18,7 @@
 //
 // DESCRIPTION:
 //	LineOfSight/Visibility checks, uses REJECT Lookup Table.
+//	Results are cached, see SIGHT CACHE below.
 //
 //-----------------------------------------------------------------------------
 
@@ -25,9 +26,17 @@ static const char
 rcsid[] = "$Id: p_sight.c,v 1.3 1997/01/28 22:08:28 b1 Exp $";
 
 
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
 #include "doomdef.h"
 
 #include "i_system.h"
+#include "z_zone.h"
+#include "m_argv.h"
+#include "m_bbox.h"
+#include "m_bench.h"
 #include "p_local.h"
 
 // State.
@@ -44,7 +53,96 @@ divline_t	strace;			// from t1 to t2
 fixed_t		t2x;
 fixed_t		t2y;
 
-int		sightcounts[2];
+
+
+//
+// SIGHT CACHE
+//
+// Monsters check sight to every player each time they look,
+//  mostly from the same few places, so answers are kept two ways.
+//
+// An exact cache of recent checks, keyed by the two subsectors
+//  and the eye and target coordinates. An entry holds while none
+//  of the sectors whose heights the trace read has moved since.
+//
+// A subsector pair table, set when the one sided line that
+//  stopped a trace is proven to stop every trace P_CrossBSPNode
+//  could make between the two subsectors. Walls never move,
+//  so those hold for the whole level. The proof covers the hull
+//  of each subsector's seg vertices pulled in by PROOFMARGIN,
+//  the table is only asked for things SIGHTMARGIN inside it,
+//  which leaves room for the truncation P_DivlineSide does.
+//
+#define SIGHTCACHESIZE		1024	// power of two
+#define SIGHTSECTORS		8
+#define SIGHTMARGIN		2.0
+#define PROOFMARGIN		0.5
+#define MAXREGIONPOINTS		128
+#define MAXSIGHTSUBSECTORS	2048	// a 1MB pair table
+
+// Keeps the P_DivlineSide products in range.
+#define MAXSIGHTEXTENT		32000
+
+// Pair states, two bits each.
+#define SP_UNKNOWN		0
+#define SP_BLOCKED		1
+#define SP_UNPROVEN		2
+
+typedef struct
+{
+    int		ss1;		// -1 if empty
+    int		ss2;
+    fixed_t	x1;
+    fixed_t	y1;
+    fixed_t	z1;		// sightzstart
+    fixed_t	x2;
+    fixed_t	y2;
+    fixed_t	z2;
+    fixed_t	top2;
+
+    // sightepoch when stored,
+    //  numsectors -1 if any height change counts
+    int		epoch;
+    int		numsectors;
+    sector_t*	sectors[SIGHTSECTORS];
+
+    boolean	result;
+    
+} sightentry_t;
+
+typedef struct
+{
+    // x,y pairs in map units, counterclockwise,
+    //  no points if the subsector is too thin
+    int		numpoints;
+    double*	points;		// pulled in by PROOFMARGIN
+    int		numinner;
+    double*	inner;		// pulled in by SIGHTMARGIN
+    
+    double	minx;
+    double	maxx;
+    
+} sightregion_t;
+
+
+int			sightepoch;
+
+static sightentry_t	sightcache[SIGHTCACHESIZE];
+
+// Sectors whose heights the trace read, -1 if too many.
+static sector_t*	tracesectors[SIGHTSECTORS];
+static int		numtracesectors;
+
+// The one sided line that stopped the trace.
+static seg_t*		traceblockseg;
+static int		traceblocksub;
+
+static sightregion_t*	sightregions;
+static byte*		sightpairs;	// NULL if not kept
+
+// Parent node<<1 + side, -1 for the head node.
+static int*		subparent;
+static int*		nodeparent;
 
 
 //
@@ -127,6 +225,28 @@ P_InterceptVector2
     return frac;
 }
 
+//
+// P_TraceSector
+// Notes a sector whose heights the trace reads.
+//
+static void P_TraceSector (sector_t* sec)
+{
+    int		i;
+
+    if (numtracesectors < 0)
+	return;
+    
+    for (i=0 ; i<numtracesectors ; i++)
+	if (tracesectors[i] == sec)
+	    return;
+
+    if (numtracesectors == SIGHTSECTORS)
+	numtracesectors = -1;
+    else
+	tracesectors[numtracesectors++] = sec;
+}
+
+
 //
 // P_CrossSubsector
 // Returns true
@@ -196,11 +316,17 @@ boolean P_CrossSubsector (int num)
 	// stop because it is not two sided anyway
 	// might do this after updating validcount?
 	if ( !(line->flags & ML_TWOSIDED) )
+	{
+	    traceblockseg = seg;
+	    traceblocksub = num;
 	    return false;
+	}
 	
 	// crosses a two sided line
 	front = seg->frontsector;
 	back = seg->backsector;
+	P_TraceSector (front);
+	P_TraceSector (back);
 
 	// no wall to block sight with?
 	if (front->floorheight == back->floorheight
@@ -290,11 +416,617 @@ boolean P_CrossBSPNode (int bspnum)
 }
 
 
+//
+// P_SightPair
+//
+static int P_SightPair (int ss1, int ss2)
+{
+    int		pnum;
+
+    pnum = ss1*numsubsectors + ss2;
+    return (sightpairs[pnum>>2] >> ((pnum&3)*2)) & 3;
+}
+
+static void
+P_SetSightPair
+( int		ss1,
+  int		ss2,
+  int		state )
+{
+    int		pnum;
+    int		shift;
+
+    pnum = ss1*numsubsectors + ss2;
+    shift = (pnum&3)*2;
+    sightpairs[pnum>>2] = (sightpairs[pnum>>2] & ~(3<<shift)) | (state<<shift);
+}
+
+
+//
+// P_DeepInRegion
+// Things that close to the edge are left to the trace.
+//
+static boolean
+P_DeepInRegion
+( sightregion_t*	r,
+  mobj_t*		mo )
+{
+    double*	p;
+    double*	q;
+    double	x;
+    double	y;
+    int		i;
+
+    if (!r->numinner)
+	return false;
+
+    x = mo->x / (double)FRACUNIT;
+    y = mo->y / (double)FRACUNIT;
+    for (i=0 ; i<r->numinner ; i++)
+    {
+	p = &r->inner[i*2];
+	q = &r->inner[((i+1)%r->numinner)*2];
+	if ((q[0]-p[0])*(y-p[1]) - (q[1]-p[1])*(x-p[0]) < 0)
+	    return false;
+    }
+    return true;
+}
+
+
+//
+// P_RegionSide
+// Returns -1 if every point of the region is on the front
+//  of the line, 1 if all are on the back, else 0.
+//
+static int
+P_RegionSide
+( sightregion_t*	r,
+  double		x,
+  double		y,
+  double		dx,
+  double		dy )
+{
+    double*	p;
+    double	c;
+    int		i;
+    int		front;
+    int		back;
+
+    front = back = 0;
+    for (i=0, p=r->points ; i<r->numpoints ; i++, p+=2)
+    {
+	c = dx*(p[1]-y) - dy*(p[0]-x);
+	if (c < 0)
+	    front++;
+	else if (c > 0)
+	    back++;
+	else
+	    return 0;
+    }
+
+    if (!back)
+	return -1;
+    if (!front)
+	return 1;
+    return 0;
+}
+
+
+//
+// P_TraceSide
+// Same for a point against every line from region a to region b.
+// The cross product is linear in either end,
+//  so the corners decide.
+//
+static int
+P_TraceSide
+( sightregion_t*	a,
+  sightregion_t*	b,
+  double		x,
+  double		y )
+{
+    double*	p;
+    double*	q;
+    double	c;
+    int		i;
+    int		j;
+    int		front;
+    int		back;
+
+    front = back = 0;
+    for (i=0, p=a->points ; i<a->numpoints ; i++, p+=2)
+    {
+	for (j=0, q=b->points ; j<b->numpoints ; j++, q+=2)
+	{
+	    c = (q[0]-p[0])*(y-p[1]) - (q[1]-p[1])*(x-p[0]);
+	    if (c < 0)
+		front++;
+	    else if (c > 0)
+		back++;
+	    else
+		return 0;
+	}
+	if (front && back)
+	    return 0;
+    }
+
+    return back ? 1 : -1;
+}
+
+
+//
+// P_RegionSpansX
+// P_DivlineSide compares x with the y of a horizontal line,
+//  so a point can be "on" one it is nowhere near.
+// For the trace and the blocking line that takes
+//  t1 and t2 in a row or column, P_CheckSight
+//  leaves those to the trace.
+//
+static boolean
+P_RegionSpansX
+( sightregion_t*	r,
+  double		v )
+{
+    return r->minx <= v && v <= r->maxx;
+}
+
+
+//
+// P_ProveBlocked
+// Returns true if the line that stopped the last trace
+//  stops every trace from subsector ss1 to ss2.
+//
+static boolean
+P_ProveBlocked
+( int		ss1,
+  int		ss2 )
+{
+    sightregion_t*	a;
+    sightregion_t*	b;
+    line_t*		line;
+    node_t*		bsp;
+    double		x1;
+    double		y1;
+    double		x2;
+    double		y2;
+    int			side1;
+    int			side2;
+    int			p;
+
+    a = &sightregions[ss1];
+    b = &sightregions[ss2];
+    if (!a->numpoints || !b->numpoints)
+	return false;
+    
+    line = traceblockseg->linedef;
+    x1 = line->v1->x>>FRACBITS;
+    y1 = line->v1->y>>FRACBITS;
+    x2 = line->v2->x>>FRACBITS;
+    y2 = line->v2->y>>FRACBITS;
+
+    // the line ends are on either side of every trace
+    side1 = P_TraceSide (a, b, x1, y1);
+    side2 = P_TraceSide (a, b, x2, y2);
+    if (!side1 || side1 != -side2)
+	return false;
+
+    // the trace ends are on either side of the line
+    side1 = P_RegionSide (a, x1, y1, x2-x1, y2-y1);
+    side2 = P_RegionSide (b, x1, y1, x2-x1, y2-y1);
+    if (!side1 || side1 != -side2)
+	return false;
+
+    // P_CrossBSPNode gets down to the subsector holding the line,
+    // it only skips a side that neither end is on
+    for (p = subparent[traceblocksub] ; p != -1 ; p = nodeparent[p>>1])
+    {
+	bsp = &nodes[p>>1];
+	side1 = (p&1) ? 1 : -1;
+	x1 = bsp->x>>FRACBITS;
+	y1 = bsp->y>>FRACBITS;
+	x2 = bsp->dx>>FRACBITS;
+	y2 = bsp->dy>>FRACBITS;
+
+	if (P_RegionSide (b, x1, y1, x2, y2) == side1)
+	    continue;
+
+	// the start is taken as front when on the partition
+	if (P_RegionSide (a, x1, y1, x2, y2) == side1
+	    && !(side1 == 1 && !y2 && P_RegionSpansX (a, y1)))
+	    continue;
+
+	return false;
+    }
+
+    return true;
+}
+
+
+//
+// P_ConvexHull
+// Monotone chain, counterclockwise.
+// The points are sorted in place, hull needs numpoints+1 pairs.
+//
+static int P_ComparePoints (const void* a, const void* b)
+{
+    const double*	p = a;
+    const double*	q = b;
+
+    if (p[0] != q[0])
+	return p[0] < q[0] ? -1 : 1;
+    if (p[1] != q[1])
+	return p[1] < q[1] ? -1 : 1;
+    return 0;
+}
+
+static double
+P_HullTurn
+( double*	o,
+  double*	a,
+  double*	b )
+{
+    return (a[0]-o[0])*(b[1]-o[1]) - (a[1]-o[1])*(b[0]-o[0]);
+}
+
+static int
+P_ConvexHull
+( double*	points,
+  int		numpoints,
+  double*	hull )
+{
+    int		lower;
+    int		i;
+    int		n;
+
+    if (numpoints < 3)
+	return 0;
+    
+    qsort (points, numpoints, sizeof(double)*2, P_ComparePoints);
+
+    n = 0;
+    for (i=0 ; i<numpoints ; i++)
+    {
+	while (n >= 2 && P_HullTurn (&hull[(n-2)*2], &hull[(n-1)*2],
+				     &points[i*2]) <= 0)
+	    n--;
+	hull[n*2] = points[i*2];
+	hull[n*2+1] = points[i*2+1];
+	n++;
+    }
+    lower = n+1;
+    for (i=numpoints-2 ; i>=0 ; i--)
+    {
+	while (n >= lower && P_HullTurn (&hull[(n-2)*2], &hull[(n-1)*2],
+					 &points[i*2]) <= 0)
+	    n--;
+	hull[n*2] = points[i*2];
+	hull[n*2+1] = points[i*2+1];
+	n++;
+    }
+
+    // last point is the first
+    n--;
+    return n < 3 ? 0 : n;
+}
+
+
+//
+// P_ShrinkPolygon
+// Moves every edge of a counterclockwise convex polygon
+//  in by dist, returns the new point count.
+//
+static int
+P_ShrinkPolygon
+( double*	poly,
+  int		numpoints,
+  double	dist,
+  double*	out )
+{
+    double	work[2][MAXREGIONPOINTS*4];
+    double	c[MAXREGIONPOINTS*2];
+    double*	in;
+    double*	res;
+    double*	a;
+    double*	b;
+    double*	p;
+    double*	q;
+    double	dx;
+    double	dy;
+    double	len;
+    double	t;
+    int		count;
+    int		n;
+    int		e;
+    int		i;
+
+    memcpy (work[0], poly, numpoints*2*sizeof(double));
+    n = numpoints;
+    
+    for (e=0 ; e<numpoints && n ; e++)
+    {
+	a = &poly[e*2];
+	b = &poly[((e+1)%numpoints)*2];
+	dx = b[0]-a[0];
+	dy = b[1]-a[1];
+	len = sqrt (dx*dx + dy*dy);
+
+	in = work[e&1];
+	res = work[(e&1)^1];
+	for (i=0 ; i<n ; i++)
+	    c[i] = dx*(in[i*2+1]-a[1]) - dy*(in[i*2]-a[0]) - dist*len;
+
+	// keep the inside, c >= 0
+	count = 0;
+	for (i=0 ; i<n ; i++)
+	{
+	    p = &in[i*2];
+	    q = &in[((i+1)%n)*2];
+
+	    if (c[i] >= 0)
+	    {
+		res[count*2] = p[0];
+		res[count*2+1] = p[1];
+		count++;
+	    }
+	    if ((c[i] < 0 && c[(i+1)%n] > 0)
+		|| (c[i] > 0 && c[(i+1)%n] < 0))
+	    {
+		t = c[i] / (c[i] - c[(i+1)%n]);
+		res[count*2] = p[0] + t*(q[0]-p[0]);
+		res[count*2+1] = p[1] + t*(q[1]-p[1]);
+		count++;
+	    }
+	}
+	n = count;
+    }
+
+    if (n < 3)
+	return 0;
+    memcpy (out, work[numpoints&1], n*2*sizeof(double));
+    return n;
+}
+
+
+//
+// P_SetSightRegion
+//
+static void P_SetSightRegion (int num)
+{
+    sightregion_t*	r;
+    subsector_t*	sub;
+    seg_t*		seg;
+    double		points[MAXREGIONPOINTS*2];
+    double		hull[MAXREGIONPOINTS*2+2];
+    double		shrunk[MAXREGIONPOINTS*4];
+    int			numpoints;
+    int			n;
+    int			i;
+
+    r = &sightregions[num];
+    r->numpoints = r->numinner = 0;
+
+    sub = &subsectors[num];
+    if (sub->numlines*2 > MAXREGIONPOINTS)
+	return;
+
+    numpoints = 0;
+    seg = &segs[sub->firstline];
+    for (i=0 ; i<sub->numlines ; i++, seg++)
+    {
+	points[numpoints*2] = seg->v1->x>>FRACBITS;
+	points[numpoints*2+1] = seg->v1->y>>FRACBITS;
+	numpoints++;
+	points[numpoints*2] = seg->v2->x>>FRACBITS;
+	points[numpoints*2+1] = seg->v2->y>>FRACBITS;
+	numpoints++;
+    }
+
+    n = P_ConvexHull (points, numpoints, hull);
+    if (!n)
+	return;
+
+    numpoints = P_ShrinkPolygon (hull, n, SIGHTMARGIN, shrunk);
+    if (!numpoints)
+	return;
+    r->inner = Z_Malloc (numpoints*2*sizeof(double), PU_LEVEL, 0);
+    memcpy (r->inner, shrunk, numpoints*2*sizeof(double));
+    r->numinner = numpoints;
+    
+    numpoints = P_ShrinkPolygon (hull, n, PROOFMARGIN, shrunk);
+    r->points = Z_Malloc (numpoints*2*sizeof(double), PU_LEVEL, 0);
+    memcpy (r->points, shrunk, numpoints*2*sizeof(double));
+    r->numpoints = numpoints;
+
+    r->minx = r->maxx = shrunk[0];
+    for (i=1 ; i<numpoints ; i++)
+    {
+	if (shrunk[i*2] < r->minx)
+	    r->minx = shrunk[i*2];
+	if (shrunk[i*2] > r->maxx)
+	    r->maxx = shrunk[i*2];
+    }
+}
+
+
+//
+// P_SetSightParents
+//
+static void
+P_SetSightParents
+( int		bspnum,
+  int		parent )
+{
+    if (bspnum & NF_SUBSECTOR)
+    {
+	subparent[bspnum&(~NF_SUBSECTOR)] = parent;
+	return;
+    }
+
+    nodeparent[bspnum] = parent;
+    P_SetSightParents (nodes[bspnum].children[0], bspnum<<1);
+    P_SetSightParents (nodes[bspnum].children[1], (bspnum<<1)|1);
+}
+
+
+//
+// P_PrecomputeSightPairs
+// Traces between the middles of every pair of subsectors
+//  REJECT lets through and tries to prove the blocked ones.
+//
+static void P_PrecomputeSightPairs (void)
+{
+    sightregion_t*	a;
+    sightregion_t*	b;
+    int			ss1;
+    int			ss2;
+    int			pnum;
+    int			blocked;
+
+    blocked = 0;
+    for (ss1=0 ; ss1<numsubsectors ; ss1++)
+    {
+	a = &sightregions[ss1];
+	if (!a->numinner)
+	    continue;
+	
+	for (ss2=0 ; ss2<numsubsectors ; ss2++)
+	{
+	    b = &sightregions[ss2];
+	    if (ss1 == ss2 || !b->numinner)
+		continue;
+
+	    pnum = (subsectors[ss1].sector - sectors)*numsectors
+		+ (subsectors[ss2].sector - sectors);
+	    if (rejectmatrix[pnum>>3] & (1<<(pnum&7)))
+		continue;
+
+	    // heights don't matter here, closed doors still stop it
+	    validcount++;
+	    sightzstart = 0;
+	    topslope = MAXINT;
+	    bottomslope = MININT;
+	    strace.x = (fixed_t)(a->inner[0]*FRACUNIT);
+	    strace.y = (fixed_t)(a->inner[1]*FRACUNIT);
+	    t2x = (fixed_t)(b->inner[0]*FRACUNIT);
+	    t2y = (fixed_t)(b->inner[1]*FRACUNIT);
+	    strace.dx = t2x - strace.x;
+	    strace.dy = t2y - strace.y;
+	    numtracesectors = 0;
+	    traceblockseg = NULL;
+	    
+	    P_CrossBSPNode (numnodes-1);
+	    if (traceblockseg)
+	    {
+		if (P_ProveBlocked (ss1, ss2))
+		{
+		    P_SetSightPair (ss1, ss2, SP_BLOCKED);
+		    blocked++;
+		}
+		else
+		    P_SetSightPair (ss1, ss2, SP_UNPROVEN);
+	    }
+	}
+    }
+
+    printf ("P_InitSight: %i of %i subsector pairs blocked\n",
+	    blocked, numsubsectors*numsubsectors);
+}
+
+
+//
+// P_SightEntryFresh
+// Returns false if a sector the trace read has moved.
+//
+static boolean P_SightEntryFresh (sightentry_t* entry)
+{
+    int		i;
+
+    if (entry->numsectors < 0)
+	return entry->epoch == sightepoch;
+
+    for (i=0 ; i<entry->numsectors ; i++)
+	if (entry->sectors[i]->sightstamp > entry->epoch)
+	    return false;
+
+    return true;
+}
+
+
+//
+// P_ClearSightCache
+// Called when sector heights are restored.
+//
+void P_ClearSightCache (void)
+{
+    int		i;
+
+    for (i=0 ; i<SIGHTCACHESIZE ; i++)
+	sightcache[i].ss1 = -1;
+}
+
+
+//
+// P_InitSight
+// Called by P_SetupLevel once the nodes are in.
+// The pair table is filled as traces hit walls,
+//  or all at once with -sighttable.
+//
+void P_InitSight (void)
+{
+    fixed_t	left;
+    fixed_t	right;
+    fixed_t	bottom;
+    fixed_t	top;
+    int		size;
+    int		i;
+
+    P_ClearSightCache ();
+    sightpairs = NULL;
+
+    if (!numnodes
+	|| numsubsectors > MAXSIGHTSUBSECTORS
+	|| M_CheckParm ("-nosightpairs"))
+	return;
+
+    left = bottom = MAXINT;
+    right = top = MININT;
+    for (i=0 ; i<numvertexes ; i++)
+    {
+	if (vertexes[i].x < left)
+	    left = vertexes[i].x;
+	if (vertexes[i].x > right)
+	    right = vertexes[i].x;
+	if (vertexes[i].y < bottom)
+	    bottom = vertexes[i].y;
+	if (vertexes[i].y > top)
+	    top = vertexes[i].y;
+    }
+    if ((right-left)>>FRACBITS > MAXSIGHTEXTENT
+	|| (top-bottom)>>FRACBITS > MAXSIGHTEXTENT)
+	return;
+
+    sightregions = Z_Malloc (numsubsectors*sizeof(*sightregions),
+			     PU_LEVEL, 0);
+    for (i=0 ; i<numsubsectors ; i++)
+	P_SetSightRegion (i);
+    
+    subparent = Z_Malloc (numsubsectors*sizeof(*subparent), PU_LEVEL, 0);
+    nodeparent = Z_Malloc (numnodes*sizeof(*nodeparent), PU_LEVEL, 0);
+    P_SetSightParents (numnodes-1, -1);
+
+    size = (numsubsectors*numsubsectors+3)/4;
+    sightpairs = Z_Malloc (size, PU_LEVEL, 0);
+    memset (sightpairs, 0, size);
+
+    if (M_CheckParm ("-sighttable"))
+	P_PrecomputeSightPairs ();
+}
+
 //
 // P_CheckSight
 // Returns true
 //  if a straight line between t1 and t2 is unobstructed.
-// Uses REJECT.
+// Uses REJECT, then the sight cache.
 //
 boolean
 P_CheckSight
@@ -306,6 +1038,12 @@ P_CheckSight
     int		pnum;
     int		bytenum;
     int		bitnum;
+    int		ss1;
+    int		ss2;
+    int		i;
+    boolean	inbox;
+    boolean	result;
+    sightentry_t* entry;
     
     // First check for trivial rejection.
 
@@ -319,19 +1057,52 @@ P_CheckSight
     // Check in REJECT table.
     if (rejectmatrix[bytenum]&bitnum)
     {
-	sightcounts[0]++;
+	M_BenchCount (bc_sightreject, 1);
 
 	// can't possibly be connected
 	return false;	
     }
 
+    ss1 = t1->subsector - subsectors;
+    ss2 = t2->subsector - subsectors;
+    inbox = sightpairs
+	&& t1->x != t2->x && t1->y != t2->y
+	&& P_DeepInRegion (&sightregions[ss1], t1)
+	&& P_DeepInRegion (&sightregions[ss2], t2);
+
+    // A wall cuts every line between the subsectors.
+    if (inbox && P_SightPair (ss1, ss2) == SP_BLOCKED)
+    {
+	M_BenchCount (bc_sightpair, 1);
+	return false;
+    }
+    
+    sightzstart = t1->z + t1->height - (t1->height>>2);
+
+    // Seen from here before?
+    entry = &sightcache[(ss1*61 + ss2*7
+			 + ((t1->x ^ t2->y)>>FRACBITS)) & (SIGHTCACHESIZE-1)];
+    if (entry->ss1 == ss1
+	&& entry->ss2 == ss2
+	&& entry->x1 == t1->x
+	&& entry->y1 == t1->y
+	&& entry->z1 == sightzstart
+	&& entry->x2 == t2->x
+	&& entry->y2 == t2->y
+	&& entry->z2 == t2->z
+	&& entry->top2 == t2->z+t2->height
+	&& P_SightEntryFresh (entry))
+    {
+	M_BenchCount (bc_sightcache, 1);
+	return entry->result;
+    }
+    
     // An unobstructed LOS is possible.
     // Now look from eyes of t1 to any part of t2.
-    sightcounts[1]++;
+    M_BenchCount (bc_sighttrace, 1);
 
     validcount++;
 	
-    sightzstart = t1->z + t1->height - (t1->height>>2);
     topslope = (t2->z+t2->height) - sightzstart;
     bottomslope = (t2->z) - sightzstart;
 	
@@ -342,8 +1113,38 @@ P_CheckSight
     strace.dx = t2->x - t1->x;
     strace.dy = t2->y - t1->y;
 
+    numtracesectors = 0;
+    traceblockseg = NULL;
+
     // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);	
+    result = P_CrossBSPNode (numnodes-1);
+
+    if (traceblockseg)
+    {
+	// stopped by a wall, heights don't matter
+	numtracesectors = 0;
+	
+	if (inbox && P_SightPair (ss1, ss2) == SP_UNKNOWN)
+	    P_SetSightPair (ss1, ss2, P_ProveBlocked (ss1, ss2) ?
+			    SP_BLOCKED : SP_UNPROVEN);
+    }
+
+    entry->ss1 = ss1;
+    entry->ss2 = ss2;
+    entry->x1 = t1->x;
+    entry->y1 = t1->y;
+    entry->z1 = sightzstart;
+    entry->x2 = t2->x;
+    entry->y2 = t2->y;
+    entry->z2 = t2->z;
+    entry->top2 = t2->z+t2->height;
+    entry->epoch = sightepoch;
+    entry->numsectors = numtracesectors;
+    for (i=0 ; i<numtracesectors ; i++)
+	entry->sectors[i] = tracesectors[i];
+    entry->result = result;
+    
+    return result;
 }
 
 
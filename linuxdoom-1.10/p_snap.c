@@ -0,0 +1,691 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	In-memory snapshots of the play simulation.
+//	Unlike the savegame, everything the next tic can see
+//	 is kept: every thinker in list order, mobj target and
+//	 tracer links, the mapblock and sector thing orders,
+//	 random indices and the little queues the specials keep.
+//	Structures are copied whole. Pointers into the level
+//	 data, states and mobjinfo stay valid for as long as the
+//	 level is loaded, so only pointers to thinkers are turned
+//	 into thinker numbers, 1 based, 0 for none.
+//
+//-----------------------------------------------------------------------------
+
+static const char
+rcsid[] = "$Id: p_snap.c,v 1.0 1997/12/23 12:00:00 b1 Exp $";
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "i_system.h"
+#include "z_zone.h"
+#include "s_sound.h"
+#include "p_local.h"
+
+// State.
+#include "doomstat.h"
+#include "r_state.h"
+
+#ifdef __GNUG__
+#pragma implementation "p_snap.h"
+#endif
+#include "p_snap.h"
+
+
+// Keeps every structure in the buffer aligned.
+#define SNAPALIGN		8
+
+#define MAXBRAINTARGETS		32
+
+
+extern int		prndindex;
+
+extern mobj_t*		braintargets[MAXBRAINTARGETS];
+extern int		numbraintargets;
+extern int		braintargeton;
+extern int		braineasy;
+
+extern byte*		demobuffer;
+extern byte*		demo_p;
+
+
+typedef enum
+{
+    sc_mobj,
+    sc_special
+
+} snapclass_t;
+
+
+typedef struct
+{
+    int			version;
+    int			length;
+
+    // Level load the stored pointers belong to.
+    sector_t*		sectors;
+    subsector_t*	subsectors;
+    line_t*		lines;
+    side_t*		sides;
+    int			numsectors;
+    int			numlines;
+    int			numsides;
+    int			gameepisode;
+    int			gamemap;
+
+    int			numthinkers;
+
+} snapheader_t;
+
+
+typedef struct
+{
+    int			class;
+    int			size;
+
+} snapthinker_t;
+
+
+// Everything outside the thinkers and the level arrays.
+typedef struct
+{
+    int			leveltime;
+    int			rndindex;
+    int			prndindex;
+    int			totalkills;
+    int			totalitems;
+    int			totalsecret;
+
+    mobj_t*		bodyque[BODYQUESIZE];
+    int			bodyqueslot;
+
+    mobj_t*		braintargets[MAXBRAINTARGETS];
+    int			numbraintargets;
+    int			braintargeton;
+    int			braineasy;
+
+    mapthing_t		itemrespawnque[ITEMQUESIZE];
+    int			itemrespawntime[ITEMQUESIZE];
+    int			iquehead;
+    int			iquetail;
+
+    boolean		levelTimer;
+    int			levelTimeCount;
+    button_t		buttonlist[MAXBUTTONS];
+
+    ceiling_t*		activeceilings[MAXCEILINGS];
+    plat_t*		activeplats[MAXPLATS];
+
+    // Read position in the demo, -1 if not playing one.
+    int			demooffset;
+
+} snapglobals_t;
+
+
+static snapshot_t*	snap;
+static int		snap_p;
+
+// Thinkers by number, old ones while taking,
+//  new ones while restoring.
+static thinker_t**	snapthinkers;
+static int		numsnapthinkers;
+static int		maxsnapthinkers;
+
+// Thinker numbers by address, open addressed.
+static int*		snaphash;
+static int		snaphashsize;
+
+static snapglobals_t	snapglobals;
+
+#define SnapHash(p)	((int)(((size_t)(p) >> 3) * 2654435761u) & (snaphashsize-1))
+
+#define TOINDEX(p)	((void *)(size_t)P_SnapIndex (p))
+#define FROMINDEX(p)	((void *)P_SnapThinker ((int)(size_t)(p)))
+
+
+
+//
+// P_SnapPut
+// Appends to the snapshot and returns the copy,
+//  valid until the next put.
+//
+static void* P_SnapPut (void* source, int length)
+{
+    byte*	dest;
+    int		need;
+
+    need = snap_p + length + SNAPALIGN;
+    if (need > snap->size)
+    {
+	while (snap->size < need)
+	    snap->size = snap->size ? snap->size*2 : 0x40000;
+	snap->data = realloc (snap->data, snap->size);
+	if (!snap->data)
+	    I_Error ("P_SnapPut: couldn't realloc %i bytes", snap->size);
+    }
+
+    dest = snap->data + snap_p;
+    memcpy (dest, source, length);
+    snap_p += (length + SNAPALIGN-1) & ~(SNAPALIGN-1);
+
+    return dest;
+}
+
+
+//
+// P_SnapGet
+// Returns the next structure in the snapshot.
+//
+static void* P_SnapGet (int length)
+{
+    byte*	source;
+
+    if (snap_p + length > snap->length)
+	I_Error ("P_SnapGet: snapshot is truncated");
+
+    source = snap->data + snap_p;
+    snap_p += (length + SNAPALIGN-1) & ~(SNAPALIGN-1);
+
+    return source;
+}
+
+
+//
+// P_AddSnapThinker
+//
+static void P_AddSnapThinker (thinker_t* thinker)
+{
+    if (numsnapthinkers == maxsnapthinkers)
+    {
+	maxsnapthinkers = maxsnapthinkers ? maxsnapthinkers*2 : 1024;
+	snapthinkers = realloc (snapthinkers,
+				maxsnapthinkers*sizeof(*snapthinkers));
+	if (!snapthinkers)
+	    I_Error ("P_AddSnapThinker: couldn't realloc %i thinkers",
+		     maxsnapthinkers);
+    }
+    snapthinkers[numsnapthinkers++] = thinker;
+}
+
+
+//
+// P_HashSnapThinkers
+//
+static void P_HashSnapThinkers (void)
+{
+    int		i;
+    int		h;
+
+    if (snaphashsize < numsnapthinkers*2)
+    {
+	if (!snaphashsize)
+	    snaphashsize = 2048;
+	while (snaphashsize < numsnapthinkers*2)
+	    snaphashsize *= 2;
+	free (snaphash);
+	snaphash = malloc (snaphashsize*sizeof(*snaphash));
+	if (!snaphash)
+	    I_Error ("P_HashSnapThinkers: couldn't malloc %i slots",
+		     snaphashsize);
+    }
+    memset (snaphash, 0, snaphashsize*sizeof(*snaphash));
+
+    for (i=0 ; i<numsnapthinkers ; i++)
+    {
+	for (h = SnapHash (snapthinkers[i]) ;
+	     snaphash[h] ;
+	     h = (h+1) & (snaphashsize-1))
+	    ;
+	snaphash[h] = i+1;
+    }
+}
+
+
+//
+// P_SnapIndex
+// Pointers to anything that is no longer
+//  a thinker come back as none.
+//
+static int P_SnapIndex (void* pointer)
+{
+    int		h;
+
+    if (!pointer)
+	return 0;
+
+    for (h = SnapHash (pointer) ;
+	 snaphash[h] ;
+	 h = (h+1) & (snaphashsize-1))
+    {
+	if (snapthinkers[snaphash[h]-1] == pointer)
+	    return snaphash[h];
+    }
+    return 0;
+}
+
+
+static thinker_t* P_SnapThinker (int index)
+{
+    if (!index)
+	return NULL;
+
+    if (index > numsnapthinkers)
+	I_Error ("P_SnapThinker: bad thinker %i", index);
+
+    return snapthinkers[index-1];
+}
+
+
+//
+// P_SnapClass
+// Returns the size of a thinker worth keeping, 0 if not.
+//
+static int P_SnapClass (thinker_t* th, int* class)
+{
+    actionf_p1	func;
+    mobj_t*	mo;
+    int		i;
+
+    func = th->function.acp1;
+    *class = sc_special;
+
+    if (func == (actionf_p1)P_MobjThinker)
+    {
+	*class = sc_mobj;
+	return sizeof(mobj_t);
+    }
+
+    if (th->function.acv == (actionf_v)(-1))
+    {
+	// A removed mobj can still be someone's target
+	//  until its turn comes to free it.
+	// Removed specials are never pointed at.
+	mo = (mobj_t *)th;
+	if (((memblock_t *)((byte *)th - sizeof(memblock_t)))->size
+	    >= sizeof(memblock_t) + sizeof(mobj_t)
+	    && (unsigned)mo->type < NUMMOBJTYPES
+	    && mo->info == &mobjinfo[mo->type])
+	{
+	    *class = sc_mobj;
+	    return sizeof(mobj_t);
+	}
+	return 0;
+    }
+
+    if (!func)
+    {
+	// In stasis.
+	for (i=0 ; i<MAXCEILINGS ; i++)
+	    if (activeceilings[i] == (ceiling_t *)th)
+		return sizeof(ceiling_t);
+	for (i=0 ; i<MAXPLATS ; i++)
+	    if (activeplats[i] == (plat_t *)th)
+		return sizeof(plat_t);
+	return 0;
+    }
+
+    if (func == (actionf_p1)T_MoveCeiling)
+	return sizeof(ceiling_t);
+    if (func == (actionf_p1)T_VerticalDoor)
+	return sizeof(vldoor_t);
+    if (func == (actionf_p1)T_MoveFloor)
+	return sizeof(floormove_t);
+    if (func == (actionf_p1)T_PlatRaise)
+	return sizeof(plat_t);
+    if (func == (actionf_p1)T_LightFlash)
+	return sizeof(lightflash_t);
+    if (func == (actionf_p1)T_StrobeFlash)
+	return sizeof(strobe_t);
+    if (func == (actionf_p1)T_Glow)
+	return sizeof(glow_t);
+    if (func == (actionf_p1)T_FireFlicker)
+	return sizeof(fireflicker_t);
+
+    I_Error ("P_SnapClass: unknown thinker function");
+    return 0;
+}
+
+
+
+//
+// P_TakeSnapshot
+//
+void P_TakeSnapshot (snapshot_t* s)
+{
+    thinker_t*		th;
+    snapheader_t	header;
+    snapthinker_t	record;
+    snapheader_t*	head;
+    mobj_t*		mo;
+    sector_t*		sec;
+    blocklink_t*	link;
+    blockthing_t*	bt;
+    player_t*		player;
+    snapglobals_t*	g;
+    int			size;
+    int			class;
+    int			i;
+    int			j;
+
+    snap = s;
+    snap_p = 0;
+
+    // number every thinker worth keeping
+    numsnapthinkers = 0;
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+	if (P_SnapClass (th, &class))
+	    P_AddSnapThinker (th);
+    P_HashSnapThinkers ();
+
+    memset (&header, 0, sizeof(header));
+    header.version = SNAPSHOTVERSION;
+    header.sectors = sectors;
+    header.subsectors = subsectors;
+    header.lines = lines;
+    header.sides = sides;
+    header.numsectors = numsectors;
+    header.numlines = numlines;
+    header.numsides = numsides;
+    header.gameepisode = gameepisode;
+    header.gamemap = gamemap;
+    header.numthinkers = numsnapthinkers;
+    P_SnapPut (&header, sizeof(header));
+
+    // thinkers, in list order
+    for (i=0 ; i<numsnapthinkers ; i++)
+    {
+	th = snapthinkers[i];
+	size = P_SnapClass (th, &class);
+
+	record.class = class;
+	record.size = size;
+	P_SnapPut (&record, sizeof(record));
+
+	if (class != sc_mobj)
+	{
+	    P_SnapPut (th, size);
+	    continue;
+	}
+
+	mo = P_SnapPut (th, size);
+	mo->snext = TOINDEX(mo->snext);
+	mo->sprev = TOINDEX(mo->sprev);
+	mo->target = TOINDEX(mo->target);
+	mo->tracer = TOINDEX(mo->tracer);
+    }
+
+    // mapblock thing orders, nonempty blocks only
+    for (i=0 ; i<bmapwidth*bmapheight ; i++)
+    {
+	link = &blocklinks[i];
+	if (!link->numthings)
+	    continue;
+
+	P_SnapPut (&i, sizeof(i));
+	P_SnapPut (&link->numthings, sizeof(link->numthings));
+	bt = P_SnapPut (link->things, link->numthings*sizeof(*bt));
+	for (j=0 ; j<link->numthings ; j++)
+	    bt[j].mobj = TOINDEX(bt[j].mobj);
+    }
+    i = -1;
+    P_SnapPut (&i, sizeof(i));
+
+    // the level
+    sec = P_SnapPut (sectors, numsectors*sizeof(*sec));
+    for (i=0 ; i<numsectors ; i++, sec++)
+    {
+	sec->thinglist = TOINDEX(sec->thinglist);
+	sec->soundtarget = TOINDEX(sec->soundtarget);
+	sec->specialdata = TOINDEX(sec->specialdata);
+    }
+    P_SnapPut (lines, numlines*sizeof(*lines));
+    P_SnapPut (sides, numsides*sizeof(*sides));
+
+    // the players
+    P_SnapPut (playeringame, MAXPLAYERS*sizeof(*playeringame));
+    player = P_SnapPut (players, MAXPLAYERS*sizeof(*player));
+    for (i=0 ; i<MAXPLAYERS ; i++, player++)
+    {
+	player->mo = TOINDEX(player->mo);
+	player->attacker = TOINDEX(player->attacker);
+    }
+
+    // and the rest
+    g = &snapglobals;
+    g->leveltime = leveltime;
+    g->rndindex = rndindex;
+    g->prndindex = prndindex;
+    g->totalkills = totalkills;
+    g->totalitems = totalitems;
+    g->totalsecret = totalsecret;
+
+    for (i=0 ; i<BODYQUESIZE ; i++)
+	g->bodyque[i] = TOINDEX(bodyque[i]);
+    g->bodyqueslot = bodyqueslot;
+
+    for (i=0 ; i<MAXBRAINTARGETS ; i++)
+	g->braintargets[i] = TOINDEX(braintargets[i]);
+    g->numbraintargets = numbraintargets;
+    g->braintargeton = braintargeton;
+    g->braineasy = braineasy;
+
+    memcpy (g->itemrespawnque, itemrespawnque, sizeof(itemrespawnque));
+    memcpy (g->itemrespawntime, itemrespawntime, sizeof(itemrespawntime));
+    g->iquehead = iquehead;
+    g->iquetail = iquetail;
+
+    g->levelTimer = levelTimer;
+    g->levelTimeCount = levelTimeCount;
+    memcpy (g->buttonlist, buttonlist, sizeof(buttonlist));
+
+    for (i=0 ; i<MAXCEILINGS ; i++)
+	g->activeceilings[i] = TOINDEX(activeceilings[i]);
+    for (i=0 ; i<MAXPLATS ; i++)
+	g->activeplats[i] = TOINDEX(activeplats[i]);
+
+    g->demooffset = demoplayback ? demo_p - demobuffer : -1;
+
+    P_SnapPut (g, sizeof(*g));
+
+    snap->length = snap_p;
+    head = (snapheader_t *)snap->data;
+    head->length = snap_p;
+}
+
+
+
+//
+// P_RestoreSnapshot
+//
+boolean P_RestoreSnapshot (snapshot_t* s)
+{
+    thinker_t*		th;
+    thinker_t*		next;
+    snapheader_t*	header;
+    snapthinker_t*	record;
+    mobj_t*		mo;
+    sector_t*		sec;
+    blocklink_t*	link;
+    blockthing_t*	bt;
+    blockthing_t*	saved;
+    snapglobals_t*	g;
+    int			block;
+    int			count;
+    int			i;
+    int			j;
+
+    snap = s;
+    snap_p = 0;
+
+    if (snap->length < (int)sizeof(*header))
+	return false;
+
+    header = P_SnapGet (sizeof(*header));
+    if (header->version != SNAPSHOTVERSION
+	|| header->length != snap->length
+	|| header->sectors != sectors
+	|| header->subsectors != subsectors
+	|| header->lines != lines
+	|| header->sides != sides
+	|| header->numsectors != numsectors
+	|| header->numlines != numlines
+	|| header->numsides != numsides
+	|| header->gameepisode != gameepisode
+	|| header->gamemap != gamemap)
+	return false;
+
+    // throw out the current thinkers
+    for (th = thinkercap.next ; th != &thinkercap ; th = next)
+    {
+	next = th->next;
+	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
+	    S_StopSound (th);
+	Z_Free (th);
+    }
+    P_InitThinkers ();
+
+    for (i=0 ; i<bmapwidth*bmapheight ; i++)
+	blocklinks[i].numthings = 0;
+
+    // bring back the saved ones, in the same order
+    numsnapthinkers = 0;
+    for (i=0 ; i<header->numthinkers ; i++)
+    {
+	record = P_SnapGet (sizeof(*record));
+	th = Z_Malloc (record->size, PU_LEVEL, NULL);
+	memcpy (th, P_SnapGet (record->size), record->size);
+	P_AddThinker (th);
+	P_AddSnapThinker (th);
+    }
+
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+    {
+	if (th->function.acp1 != (actionf_p1)P_MobjThinker
+	    && th->function.acv != (actionf_v)(-1))
+	    continue;
+
+	mo = (mobj_t *)th;
+	mo->snext = FROMINDEX(mo->snext);
+	mo->sprev = FROMINDEX(mo->sprev);
+	mo->target = FROMINDEX(mo->target);
+	mo->tracer = FROMINDEX(mo->tracer);
+    }
+
+    // mapblock thing orders
+    while (1)
+    {
+	block = *(int *)P_SnapGet (sizeof(int));
+	if (block == -1)
+	    break;
+
+	if (block < 0 || block >= bmapwidth*bmapheight)
+	    I_Error ("P_RestoreSnapshot: bad mapblock %i", block);
+
+	count = *(int *)P_SnapGet (sizeof(int));
+	saved = P_SnapGet (count*sizeof(*saved));
+	link = &blocklinks[block];
+	for (j=0 ; j<count ; j++)
+	{
+	    bt = P_AddBlockThing (link);
+	    *bt = saved[j];
+	    bt->mobj = FROMINDEX(bt->mobj);
+	}
+    }
+
+    // the level
+    memcpy (sectors, P_SnapGet (numsectors*sizeof(*sectors)),
+	    numsectors*sizeof(*sectors));
+    for (i=0, sec = sectors ; i<numsectors ; i++, sec++)
+    {
+	sec->thinglist = FROMINDEX(sec->thinglist);
+	sec->soundtarget = FROMINDEX(sec->soundtarget);
+	sec->specialdata = FROMINDEX(sec->specialdata);
+    }
+    memcpy (lines, P_SnapGet (numlines*sizeof(*lines)),
+	    numlines*sizeof(*lines));
+    memcpy (sides, P_SnapGet (numsides*sizeof(*sides)),
+	    numsides*sizeof(*sides));
+
+    // the players
+    memcpy (playeringame, P_SnapGet (MAXPLAYERS*sizeof(*playeringame)),
+	    MAXPLAYERS*sizeof(*playeringame));
+    memcpy (players, P_SnapGet (MAXPLAYERS*sizeof(*players)),
+	    MAXPLAYERS*sizeof(*players));
+    for (i=0 ; i<MAXPLAYERS ; i++)
+    {
+	players[i].mo = FROMINDEX(players[i].mo);
+	players[i].attacker = FROMINDEX(players[i].attacker);
+    }
+
+    // and the rest
+    g = P_SnapGet (sizeof(*g));
+    leveltime = g->leveltime;
+    rndindex = g->rndindex;
+    prndindex = g->prndindex;
+    totalkills = g->totalkills;
+    totalitems = g->totalitems;
+    totalsecret = g->totalsecret;
+
+    for (i=0 ; i<BODYQUESIZE ; i++)
+	bodyque[i] = FROMINDEX(g->bodyque[i]);
+    bodyqueslot = g->bodyqueslot;
+
+    for (i=0 ; i<MAXBRAINTARGETS ; i++)
+	braintargets[i] = FROMINDEX(g->braintargets[i]);
+    numbraintargets = g->numbraintargets;
+    braintargeton = g->braintargeton;
+    braineasy = g->braineasy;
+
+    memcpy (itemrespawnque, g->itemrespawnque, sizeof(itemrespawnque));
+    memcpy (itemrespawntime, g->itemrespawntime, sizeof(itemrespawntime));
+    iquehead = g->iquehead;
+    iquetail = g->iquetail;
+
+    levelTimer = g->levelTimer;
+    levelTimeCount = g->levelTimeCount;
+    memcpy (buttonlist, g->buttonlist, sizeof(buttonlist));
+
+    for (i=0 ; i<MAXCEILINGS ; i++)
+	activeceilings[i] = FROMINDEX(g->activeceilings[i]);
+    for (i=0 ; i<MAXPLATS ; i++)
+	activeplats[i] = FROMINDEX(g->activeplats[i]);
+
+    if (demoplayback && g->demooffset != -1)
+	demo_p = demobuffer + g->demooffset;
+
+    // sector stamps went back in time
+    P_ClearSightCache ();
+
+    return true;
+}
+
+
+
+//
+// P_FreeSnapshot
+//
+void P_FreeSnapshot (snapshot_t* s)
+{
+    free (s->data);
+    s->data = NULL;
+    s->length = s->size = 0;
+}
@@ -0,0 +1,67 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	In-memory snapshots of the play simulation.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __P_SNAP__
+#define __P_SNAP__
+
+
+#include "doomtype.h"
+
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// Bumped on every change to the layout,
+//  snapshots of another version are refused.
+#define SNAPSHOTVERSION		1
+
+
+// A snapshot is owned by the caller,
+//  the buffer is reused by the next P_TakeSnapshot.
+typedef struct
+{
+    byte*	data;
+    int		length;		// bytes in use
+    int		size;		// bytes allocated
+    
+} snapshot_t;
+
+
+// Captures the whole level state, call between tics.
+void	P_TakeSnapshot (snapshot_t* snap);
+
+// Puts the level back the way the snapshot found it.
+// Returns false if the snapshot is from another
+//  version or another level load.
+boolean	P_RestoreSnapshot (snapshot_t* snap);
+
+void	P_FreeSnapshot (snapshot_t* snap);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
@@ -29,6 +29,7 @@ rcsid[] = "$Id: p_tick.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 #include "p_local.h"
 
 #include "doomstat.h"
+#include "r_state.h"
 
 
 int	leveltime;
@@ -123,6 +124,43 @@ void P_RunThinkers (void)
 
 
 
+//
+// P_StoreOldPositions
+// Remembers where things, views and planes were
+//  before the tic, uncapped frames are drawn in between.
+//
+static void P_StoreOldPositions (void)
+{
+    thinker_t*	th;
+    mobj_t*	mo;
+    sector_t*	sec;
+    int		i;
+    
+    for (th = thinkercap.next ; th != &thinkercap ; th = th->next)
+    {
+	if (th->function.acp1 != (actionf_p1)P_MobjThinker)
+	    continue;
+	
+	mo = (mobj_t *)th;
+	mo->oldx = mo->x;
+	mo->oldy = mo->y;
+	mo->oldz = mo->z;
+	mo->oldangle = mo->angle;
+    }
+
+    for (i=0, sec = sectors ; i<numsectors ; i++, sec++)
+    {
+	sec->oldfloorheight = sec->floorheight;
+	sec->oldceilingheight = sec->ceilingheight;
+    }
+    
+    for (i=0 ; i<MAXPLAYERS ; i++)
+	if (playeringame[i])
+	    players[i].oldviewz = players[i].viewz;
+}
+
+
+
 //
 // P_Ticker
 //
@@ -144,6 +182,8 @@ void P_Ticker (void)
 	return;
     }
     
+    if (uncapped)
+	P_StoreOldPositions ();
 		
     for (i=0 ; i<MAXPLAYERS ; i++)
 	if (playeringame[i])
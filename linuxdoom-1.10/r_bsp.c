@@ -26,6 +26,8 @@ static const char
 rcsid[] = "$Id: r_bsp.c,v 1.4 1997/02/03 22:45:12 b1 Exp $";
 
 
+#include <stdlib.h>
+
 #include "doomdef.h"
 
 #include "m_bbox.h"
@@ -50,8 +52,9 @@ line_t*		linedef;
 sector_t*	frontsector;
 sector_t*	backsector;
 
-drawseg_t	drawsegs[MAXDRAWSEGS];
+drawseg_t*	drawsegs;
 drawseg_t*	ds_p;
+int		maxdrawsegs;
 
 
 void
@@ -62,11 +65,34 @@ R_StoreWallRange
 
 
 
+//
+// R_GrowDrawSegs
+// Doubles the drawsegs, keeping ds_p in place.
+// Nobody holds on to a drawseg while walls are
+//  added, so the array may move.
+//
+void R_GrowDrawSegs (void)
+{
+    int		count;
+
+    count = ds_p - drawsegs;
+    maxdrawsegs = maxdrawsegs ? maxdrawsegs*2 : MAXDRAWSEGS;
+    drawsegs = realloc (drawsegs, maxdrawsegs*sizeof(*drawsegs));
+    
+    if (!drawsegs)
+	I_Error ("R_GrowDrawSegs: couldn't realloc %i drawsegs",
+		 maxdrawsegs);
+    ds_p = drawsegs + count;
+}
+
+
 //
 // R_ClearDrawSegs
 //
 void R_ClearDrawSegs (void)
 {
+    if (!drawsegs)
+	R_GrowDrawSegs ();
     ds_p = drawsegs;
 }
 
@@ -27,10 +27,13 @@
 static const char
 rcsid[] = "$Id: r_data.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
+#include <pthread.h>
+
 #include "i_system.h"
 #include "z_zone.h"
 
 #include "m_swap.h"
+#include "m_argv.h"
 
 #include "w_wad.h"
 
@@ -162,6 +165,43 @@ fixed_t*	spritetopoffset;
 lighttable_t	*colormaps;
 
 
+// -precomposite builds all composites of a level
+//  on a worker thread while it is set up,
+//  and keeps them until the level is left.
+boolean		precomposite;
+
+// Main thread only, set once a composite is known to be complete.
+static byte*		compositeready;
+
+// Shared with the worker under compositelock.
+enum
+{
+    cs_none,
+    cs_queued,
+    cs_building,
+    cs_ready
+};
+
+static byte*		compositestate;
+static int*		compositequeue;
+static int		numqueued;
+static int		nextqueued;
+static boolean		compositesdone;
+
+// Locked patches by lump, the worker never calls the zone.
+static patch_t**	compositepatch;
+
+static boolean		compositeworker;
+static pthread_t	compositethread;
+static pthread_mutex_t	compositelock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	compositebuilt = PTHREAD_COND_INITIALIZER;
+
+// Stats, printed when the worker is done.
+static unsigned		compositeus;
+static int		compositebytes;
+static int		compositewaits;
+
+
 //
 // MAPTEXTURE_T CACHING
 // When a texture is first needed,
@@ -220,14 +260,18 @@ R_DrawColumnInCache
 
 
 //
-// R_GenerateComposite
+// R_DrawComposite
 // Using the texture definition,
-//  the composite texture is created from the patches,
-//  and each column is cached.
+//  the multi patch columns are drawn into block.
+// The patches come from patches when given,
+//  so a worker can draw without the zone.
 //
-void R_GenerateComposite (int texnum)
+static void
+R_DrawComposite
+( int		texnum,
+  byte*		block,
+  patch_t**	patches )
 {
-    byte*		block;
     texture_t*		texture;
     texpatch_t*		patch;	
     patch_t*		realpatch;
@@ -241,10 +285,6 @@ void R_GenerateComposite (int texnum)
 	
     texture = textures[texnum];
 
-    block = Z_Malloc (texturecompositesize[texnum],
-		      PU_STATIC, 
-		      &texturecomposite[texnum]);	
-
     collump = texturecolumnlump[texnum];
     colofs = texturecolumnofs[texnum];
     
@@ -255,7 +295,10 @@ void R_GenerateComposite (int texnum)
 	 i<texture->patchcount;
 	 i++, patch++)
     {
-	realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
+	if (patches)
+	    realpatch = patches[patch->patch];
+	else
+	    realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
 	x1 = patch->originx;
 	x2 = x1 + SHORT(realpatch->width);
 
@@ -282,10 +325,205 @@ void R_GenerateComposite (int texnum)
 	}
 						
     }
+}
+
+
+
+//
+// R_GenerateComposite
+// The composite texture is created from the patches,
+//  and each column is cached.
+//
+void R_GenerateComposite (int texnum)
+{
+    byte*		block;
+	
+    block = Z_Malloc (texturecompositesize[texnum],
+		      PU_STATIC, 
+		      &texturecomposite[texnum]);	
+
+    R_DrawComposite (texnum, block, NULL);
 
     // Now that the texture has been built in column cache,
     //  it is purgable from zone memory.
     Z_ChangeTag (block, PU_CACHE);
+    compositeready[texnum] = 1;
+}
+
+
+
+//
+// R_WaitComposite
+// A queued composite is needed now,
+//  build it here or wait for the worker to finish it.
+//
+static void R_WaitComposite (int texnum)
+{
+    pthread_mutex_lock (&compositelock);
+
+    if (compositestate[texnum] == cs_queued)
+    {
+	compositestate[texnum] = cs_building;
+	pthread_mutex_unlock (&compositelock);
+	
+	R_DrawComposite (texnum, texturecomposite[texnum], compositepatch);
+	
+	pthread_mutex_lock (&compositelock);
+	compositestate[texnum] = cs_ready;
+	compositewaits++;
+    }
+    else if (compositestate[texnum] == cs_building)
+    {
+	while (compositestate[texnum] != cs_ready)
+	    pthread_cond_wait (&compositebuilt, &compositelock);
+	compositewaits++;
+    }
+    
+    pthread_mutex_unlock (&compositelock);
+    compositeready[texnum] = 1;
+}
+
+
+
+//
+// R_CompositeThread
+// Builds the queued composites in order.
+//
+static void* R_CompositeThread (void* arg)
+{
+    unsigned	start;
+    int		texnum;
+
+    start = I_GetTimeUS ();
+    pthread_mutex_lock (&compositelock);
+
+    while (nextqueued < numqueued)
+    {
+	texnum = compositequeue[nextqueued++];
+	if (compositestate[texnum] != cs_queued)
+	    continue;
+	
+	compositestate[texnum] = cs_building;
+	pthread_mutex_unlock (&compositelock);
+	
+	R_DrawComposite (texnum, texturecomposite[texnum], compositepatch);
+	
+	pthread_mutex_lock (&compositelock);
+	compositestate[texnum] = cs_ready;
+	pthread_cond_broadcast (&compositebuilt);
+    }
+
+    compositeus = I_GetTimeUS () - start;
+    compositesdone = true;
+    pthread_mutex_unlock (&compositelock);
+    
+    return NULL;
+}
+
+
+
+//
+// R_StartComposites
+// Allocates the composites of the present textures PU_LEVEL
+//  and starts the worker on the ones not still cached.
+//
+static void R_StartComposites (char* texturepresent)
+{
+    texture_t*	texture;
+    int		i;
+    int		j;
+    int		lump;
+
+    if (!compositestate)
+    {
+	compositestate = Z_Malloc (numtextures, PU_STATIC, 0);
+	compositequeue = Z_Malloc (numtextures*sizeof(int), PU_STATIC, 0);
+	compositepatch = Z_Malloc (numlumps*sizeof(*compositepatch),
+				   PU_STATIC, 0);
+	memset (compositepatch, 0, numlumps*sizeof(*compositepatch));
+    }
+    
+    memset (compositestate, cs_none, numtextures);
+    numqueued = nextqueued = 0;
+    compositebytes = 0;
+    compositewaits = 0;
+    
+    for (i=0 ; i<numtextures ; i++)
+    {
+	if (!texturepresent[i] || !texturecompositesize[i])
+	    continue;
+
+	if (texturecomposite[i])
+	{
+	    // still cached, keep it for the level
+	    Z_ChangeTag (texturecomposite[i], PU_LEVEL);
+	    compositeready[i] = 1;
+	    continue;
+	}
+	
+	compositebytes += texturecompositesize[i];
+	Z_Malloc (texturecompositesize[i], PU_LEVEL, &texturecomposite[i]);
+	compositeready[i] = 0;
+	compositestate[i] = cs_queued;
+	compositequeue[numqueued++] = i;
+
+	texture = textures[i];
+	for (j=0 ; j<texture->patchcount ; j++)
+	{
+	    lump = texture->patches[j].patch;
+	    if (!compositepatch[lump])
+		compositepatch[lump] = W_LockLumpNum (lump);
+	}
+    }
+
+    if (!numqueued)
+	return;
+
+    compositesdone = false;
+    if (pthread_create (&compositethread, NULL, R_CompositeThread, NULL))
+	I_Error ("R_StartComposites: couldn't start the worker");
+    compositeworker = true;
+}
+
+
+
+//
+// R_FinishComposites
+// Reaps the worker once it is done, or waits for it,
+//  and lets go of the patches it was drawing from.
+//
+void R_FinishComposites (boolean wait)
+{
+    boolean	done;
+    int		i;
+
+    if (!compositeworker)
+	return;
+
+    if (!wait)
+    {
+	pthread_mutex_lock (&compositelock);
+	done = compositesdone;
+	pthread_mutex_unlock (&compositelock);
+	if (!done)
+	    return;
+    }
+
+    pthread_join (compositethread, NULL);
+    compositeworker = false;
+
+    for (i=0 ; i<numlumps ; i++)
+    {
+	if (compositepatch[i])
+	{
+	    W_UnlockLumpNum (i);
+	    compositepatch[i] = NULL;
+	}
+    }
+
+    printf ("R_FinishComposites: %i composites, %i KB in %u ms, "
+	    "%i needed early\n", numqueued, compositebytes>>10,
+	    compositeus/1000, compositewaits);
 }
 
 
@@ -396,6 +634,8 @@ R_GetColumn
 
     if (!texturecomposite[tex])
 	R_GenerateComposite (tex);
+    else if (!compositeready[tex])
+	R_WaitComposite (tex);
 
     return texturecomposite[tex] + ofs;
 }
@@ -484,6 +724,8 @@ void R_InitTextures (void)
     texturecolumnofs = Z_Malloc (numtextures*4, PU_STATIC, 0);
     texturecomposite = Z_Malloc (numtextures*4, PU_STATIC, 0);
     texturecompositesize = Z_Malloc (numtextures*4, PU_STATIC, 0);
+    compositeready = Z_Malloc (numtextures, PU_STATIC, 0);
+    precomposite = M_CheckParm ("-precomposite");
     texturewidthmask = Z_Malloc (numtextures*4, PU_STATIC, 0);
     textureheight = Z_Malloc (numtextures*4, PU_STATIC, 0);
 
@@ -732,6 +974,44 @@ int	R_TextureNumForName (char* name)
 
 
 
+//
+// R_MarkTextures
+// Flags the textures the level's walls can show.
+//
+extern int	switchlist[];
+extern int	numswitches;
+
+static void R_MarkTextures (char* texturepresent)
+{
+    int		i;
+    
+    memset (texturepresent,0, numtextures);
+	
+    for (i=0 ; i<numsides ; i++)
+    {
+	texturepresent[sides[i].toptexture] = 1;
+	texturepresent[sides[i].midtexture] = 1;
+	texturepresent[sides[i].bottomtexture] = 1;
+    }
+
+    // Switches flip to their other texture when used.
+    for (i=0 ; i<numswitches*2 ; i++)
+    {
+	if (texturepresent[switchlist[i]])
+	    texturepresent[switchlist[i^1]] = 1;
+    }
+
+    // Sky texture is always present.
+    // Note that F_SKY1 is the name used to
+    //  indicate a sky floor/ceiling as a flat,
+    //  while the sky texture is stored like
+    //  a wall texture, with an episode dependend
+    //  name.
+    texturepresent[skytexture] = 1;
+}
+
+
+
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
@@ -755,6 +1035,14 @@ void R_PrecacheLevel (void)
     thinker_t*		th;
     spriteframe_t*	sf;
 
+    texturepresent = alloca(numtextures);
+    R_MarkTextures (texturepresent);
+
+    // Composites are built even for demos,
+    //  timedemos should not hitch either.
+    if (precomposite)
+	R_StartComposites (texturepresent);
+
     if (demoplayback)
 	return;
     
@@ -781,24 +1069,6 @@ void R_PrecacheLevel (void)
     }
     
     // Precache textures.
-    texturepresent = alloca(numtextures);
-    memset (texturepresent,0, numtextures);
-	
-    for (i=0 ; i<numsides ; i++)
-    {
-	texturepresent[sides[i].toptexture] = 1;
-	texturepresent[sides[i].midtexture] = 1;
-	texturepresent[sides[i].bottomtexture] = 1;
-    }
-
-    // Sky texture is always present.
-    // Note that F_SKY1 is the name used to
-    //  indicate a sky floor/ceiling as a flat,
-    //  while the sky texture is stored like
-    //  a wall texture, with an episode dependend
-    //  name.
-    texturepresent[skytexture] = 1;
-	
     texturememory = 0;
     for (i=0 ; i<numtextures ; i++)
     {
@@ -42,6 +42,11 @@ R_GetColumn
 void R_InitData (void);
 void R_PrecacheLevel (void);
 
+// Reaps the -precomposite worker, call with wait
+//  before the level's zone blocks are freed.
+void R_FinishComposites (boolean wait);
+extern boolean	precomposite;
+
 
 // Retrieval.
 // Floor/ceiling opaque texture tiles,
@@ -52,6 +52,7 @@
 #define SIL_TOP			2
 #define SIL_BOTH		3
 
+// Initial size, the drawsegs grow as needed.
 #define MAXDRAWSEGS		256
 
 
@@ -123,6 +124,13 @@ typedef	struct
     // if == validcount, already checked
     int		validcount;
 
+    // sightepoch at the last height change
+    int		sightstamp;
+
+    // heights at the start of the tic, for uncapped frames
+    fixed_t	oldfloorheight;
+    fixed_t	oldceilingheight;
+
     // list of mobjs in sector
     mobj_t*	thinglist;
 
@@ -397,6 +405,9 @@ typedef struct vissprite_s
     // negative if flipped
     fixed_t		xiscale;	
 
+    // texture step down a column
+    fixed_t		yiscale;
+
     fixed_t		texturemid;
     int			patch;
 
@@ -457,25 +468,22 @@ typedef struct
 //
 // Now what is a visplane, anyway?
 // 
-typedef struct
+typedef struct visplane_s
 {
+  // next in the R_FindPlane hash chain
+  struct visplane_s*	next;
+  
   fixed_t		height;
   int			picnum;
   int			lightlevel;
   int			minx;
   int			maxx;
   
-  // leave pads for [minx-1]/[maxx+1]
-  
-  byte		pad1;
-  // Here lies the rub for all
-  //  dynamic resize/change of resolution.
-  byte		top[SCREENWIDTH];
-  byte		pad2;
-  byte		pad3;
-  // See above.
-  byte		bottom[SCREENWIDTH];
-  byte		pad4;
+  // [SCREENWIDTH] each, allocated with the plane,
+  //  with pads for [minx-1]/[maxx+1].
+  // Rows are shorts so the screen can be taller than 255.
+  unsigned short*	top;
+  unsigned short*	bottom;
 
 } visplane_t;
 
@@ -28,6 +28,10 @@ static const char
 rcsid[] = "$Id: r_draw.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "doomdef.h"
 
 #include "i_system.h"
@@ -43,11 +47,7 @@ rcsid[] = "$Id: r_draw.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 #include "doomstat.h"
 
 
-// ?
-#define MAXWIDTH			1120
-#define MAXHEIGHT			832
-
-// status bar height at bottom of screen
+// status bar height at bottom of the 2D screen
 #define SBARHEIGHT		32
 
 //
@@ -66,8 +66,21 @@ int		scaledviewwidth;
 int		viewheight;
 int		viewwindowx;
 int		viewwindowy; 
-byte*		ylookup[MAXHEIGHT]; 
-int		columnofs[MAXWIDTH]; 
+byte**		ylookup; 
+int*		columnofs; 
+
+// -transpose draws the walls down the columns of
+//  this buffer, SCREENHEIGHT bytes apart,
+//  and R_TransposeColumns turns them into the view.
+boolean		transposeview;
+static byte*	transposed;
+
+// The view window on the 2D screen,
+//  where the border is drawn around it.
+static int	windowx;
+static int	windowy;
+static int	windowwidth;
+static int	windowheight;
 
 // Color tables for different players,
 //  translate a limited part to another
@@ -82,15 +95,15 @@ byte		translations[3][256];
 // R_DrawColumn
 // Source is the top of the column to scale.
 //
-lighttable_t*		dc_colormap; 
-int			dc_x; 
-int			dc_yl; 
-int			dc_yh; 
-fixed_t			dc_iscale; 
-fixed_t			dc_texturemid;
+DRAWSTATE lighttable_t*	dc_colormap; 
+DRAWSTATE int		dc_x; 
+DRAWSTATE int		dc_yl; 
+DRAWSTATE int		dc_yh; 
+DRAWSTATE fixed_t	dc_iscale; 
+DRAWSTATE fixed_t	dc_texturemid;
 
 // first pixel in a column (possibly virtual) 
-byte*			dc_source;		
+DRAWSTATE byte*		dc_source;		
 
 // just for profiling 
 int			dccount;
@@ -149,6 +162,139 @@ void R_DrawColumn (void)
 
 
 
+//
+// R_DrawColumnTransposed
+// Same as R_DrawColumn, but the column
+//  runs along a row of the transposed buffer,
+//  so every pixel follows the last in memory.
+//
+void R_DrawColumnTransposed (void) 
+{ 
+    int			count; 
+    byte*		dest; 
+    fixed_t		frac;
+    fixed_t		fracstep;	 
+ 
+    count = dc_yh - dc_yl; 
+
+    if (count < 0) 
+	return; 
+				 
+#ifdef RANGECHECK 
+    if ((unsigned)dc_x >= SCREENWIDTH
+	|| dc_yl < 0
+	|| dc_yh >= SCREENHEIGHT) 
+	I_Error ("R_DrawColumnTransposed: %i to %i at %i",
+		 dc_yl, dc_yh, dc_x); 
+#endif 
+
+    dest = transposed + dc_x*SCREENHEIGHT + dc_yl;
+
+    fracstep = dc_iscale; 
+    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+
+    do 
+    {
+	*dest++ = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
+	frac += fracstep;
+	
+    } while (count--); 
+} 
+
+
+
+//
+// R_TransposeColumns
+// Copies view columns x1 to x2 from the
+//  transposed buffer into the view,
+//  16 by 16 pixel blocks at a time.
+//
+void
+R_TransposeColumns
+( int		x1,
+  int		x2 )
+{
+    byte*	src;
+    byte*	dest;
+    int		x;
+    int		y;
+    int		i;
+    int		xend;
+    
+#if defined(__SSE2__)
+    __m128i	a[16];
+    __m128i	b[16];
+    
+    for (x=x1 ; x+16 <= x2+1 ; x+=16)
+    {
+	for (y=0 ; y+16 <= viewheight ; y+=16)
+	{
+	    // rows of a are 16 columns, rows of the result
+	    //  are 16 view rows, by four rounds of interleaving
+	    src = transposed + x*SCREENHEIGHT + y;
+	    for (i=0 ; i<16 ; i++)
+		a[i] = _mm_loadu_si128 ((__m128i *)(src + i*SCREENHEIGHT));
+	    
+	    for (i=0 ; i<16 ; i+=2)
+	    {
+		b[i] = _mm_unpacklo_epi8 (a[i], a[i+1]);
+		b[i+1] = _mm_unpackhi_epi8 (a[i], a[i+1]);
+	    }
+	    for (i=0 ; i<16 ; i+=4)
+	    {
+		a[i] = _mm_unpacklo_epi16 (b[i], b[i+2]);
+		a[i+1] = _mm_unpackhi_epi16 (b[i], b[i+2]);
+		a[i+2] = _mm_unpacklo_epi16 (b[i+1], b[i+3]);
+		a[i+3] = _mm_unpackhi_epi16 (b[i+1], b[i+3]);
+	    }
+	    for (i=0 ; i<4 ; i++)
+	    {
+		b[i*2] = _mm_unpacklo_epi32 (a[i], a[i+4]);
+		b[i*2+1] = _mm_unpackhi_epi32 (a[i], a[i+4]);
+		b[i*2+8] = _mm_unpacklo_epi32 (a[i+8], a[i+12]);
+		b[i*2+9] = _mm_unpackhi_epi32 (a[i+8], a[i+12]);
+	    }
+	    for (i=0 ; i<8 ; i++)
+	    {
+		a[i*2] = _mm_unpacklo_epi64 (b[i], b[i+8]);
+		a[i*2+1] = _mm_unpackhi_epi64 (b[i], b[i+8]);
+	    }
+
+	    for (i=0 ; i<16 ; i++)
+		_mm_storeu_si128 ((__m128i *)(ylookup[y+i] + columnofs[x]),
+				  a[i]);
+	}
+
+	// rows left below the last block
+	for ( ; y<viewheight ; y++)
+	{
+	    dest = ylookup[y] + columnofs[x];
+	    src = transposed + x*SCREENHEIGHT + y;
+	    for (i=0 ; i<16 ; i++)
+		dest[i] = src[i*SCREENHEIGHT];
+	}
+    }
+#else
+    x = x1;
+#endif
+
+    // columns left over, in blocks for the cache
+    for ( ; x<=x2 ; x=xend)
+    {
+	xend = x+16 <= x2+1 ? x+16 : x2+1;
+	
+	for (y=0 ; y<viewheight ; y++)
+	{
+	    dest = ylookup[y] + columnofs[x];
+	    src = transposed + x*SCREENHEIGHT + y;
+	    for (i=0 ; i<xend-x ; i++)
+		dest[i] = src[i*SCREENHEIGHT];
+	}
+    }
+} 
+
+
+
 // UNUSED.
 // Loop unrolled.
 #if 0
@@ -256,8 +402,8 @@ void R_DrawColumnLow (void)
 //
 // Spectre/Invisibility.
 //
-#define FUZZTABLE		50 
-#define FUZZOFF	(SCREENWIDTH)
+// In rows, times SCREENWIDTH when drawn.
+#define FUZZOFF	1
 
 
 int	fuzzoffset[FUZZTABLE] =
@@ -271,7 +417,7 @@ int	fuzzoffset[FUZZTABLE] =
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF 
 }; 
 
-int	fuzzpos = 0; 
+DRAWSTATE int	fuzzpos = 0; 
 
 
 //
@@ -355,7 +501,7 @@ void R_DrawFuzzColumn (void)
 	//  a pixel that is either one column
 	//  left or right of the current one.
 	// Add index from colormap to index.
-	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]]; 
+	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]*SCREENWIDTH]]; 
 
 	// Clamp table lookup index.
 	if (++fuzzpos == FUZZTABLE) 
@@ -379,8 +525,8 @@ void R_DrawFuzzColumn (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-byte*	dc_translation;
-byte*	translationtables;
+DRAWSTATE byte*	dc_translation;
+byte*		translationtables;
 
 void R_DrawTranslatedColumn (void) 
 { 
@@ -497,19 +643,19 @@ void R_InitTranslationTables (void)
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int			ds_y; 
-int			ds_x1; 
-int			ds_x2;
+DRAWSTATE int		ds_y; 
+DRAWSTATE int		ds_x1; 
+DRAWSTATE int		ds_x2;
 
-lighttable_t*		ds_colormap; 
+DRAWSTATE lighttable_t*	ds_colormap; 
 
-fixed_t			ds_xfrac; 
-fixed_t			ds_yfrac; 
-fixed_t			ds_xstep; 
-fixed_t			ds_ystep;
+DRAWSTATE fixed_t	ds_xfrac; 
+DRAWSTATE fixed_t	ds_yfrac; 
+DRAWSTATE fixed_t	ds_xstep; 
+DRAWSTATE fixed_t	ds_ystep;
 
 // start of a 64*64 tile image 
-byte*			ds_source;	
+DRAWSTATE byte*		ds_source;	
 
 // just for profiling
 int			dscount;
@@ -691,6 +837,8 @@ void R_DrawSpanLow (void)
 //  multiplies and other hazzles
 //  for getting the framebuffer address
 //  of a pixel to draw.
+// The window is width x height on the 2D screen,
+//  sets scaledviewwidth and viewheight to its size in pixels.
 //
 void
 R_InitBuffer
@@ -699,23 +847,38 @@ R_InitBuffer
 { 
     int		i; 
 
+    if (!ylookup)
+    {
+	ylookup = Z_Malloc (SCREENHEIGHT*sizeof(*ylookup), PU_STATIC, 0);
+	columnofs = Z_Malloc (SCREENWIDTH*sizeof(*columnofs), PU_STATIC, 0);
+	if (transposeview)
+	    transposed = Z_Malloc (SCREENWIDTH*SCREENHEIGHT, PU_STATIC, 0);
+    }
+
     // Handle resize,
     //  e.g. smaller view windows
     //  with border and/or status bar.
-    viewwindowx = (SCREENWIDTH-width) >> 1; 
-
-    // Column offset. For windows.
-    for (i=0 ; i<width ; i++) 
-	columnofs[i] = viewwindowx + i;
+    windowx = (ORIGWIDTH-width) >> 1; 
+    windowwidth = width;
+    windowheight = height;
 
     // Samw with base row offset.
-    if (width == SCREENWIDTH) 
-	viewwindowy = 0; 
+    if (width == ORIGWIDTH) 
+	windowy = 0; 
     else 
-	viewwindowy = (SCREENHEIGHT-SBARHEIGHT-height) >> 1; 
+	windowy = (ORIGHEIGHT-SBARHEIGHT-height) >> 1; 
+
+    viewwindowx = V_ScaleX (windowx);
+    viewwindowy = V_ScaleY (windowy);
+    scaledviewwidth = V_ScaleX (windowx+width) - viewwindowx;
+    viewheight = V_ScaleY (windowy+height) - viewwindowy;
+
+    // Column offset. For windows.
+    for (i=0 ; i<scaledviewwidth ; i++) 
+	columnofs[i] = viewwindowx + i;
 
     // Preclaculate all row offsets.
-    for (i=0 ; i<height ; i++) 
+    for (i=0 ; i<viewheight ; i++) 
 	ylookup[i] = screens[0] + (i+viewwindowy)*SCREENWIDTH; 
 } 
  
@@ -731,7 +894,6 @@ R_InitBuffer
 void R_FillBackScreen (void) 
 { 
     byte*	src;
-    byte*	dest; 
     int		x;
     int		y; 
     patch_t*	patch;
@@ -744,7 +906,7 @@ void R_FillBackScreen (void)
 
     char*	name;
 	
-    if (scaledviewwidth == 320)
+    if (scaledviewwidth == SCREENWIDTH)
 	return;
 	
     if ( gamemode == commercial)
@@ -753,59 +915,45 @@ void R_FillBackScreen (void)
 	name = name1;
     
     src = W_CacheLumpName (name, PU_CACHE); 
-    dest = screens[1]; 
-	 
-    for (y=0 ; y<SCREENHEIGHT-SBARHEIGHT ; y++) 
-    { 
-	for (x=0 ; x<SCREENWIDTH/64 ; x++) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), 64); 
-	    dest += 64; 
-	} 
-
-	if (SCREENWIDTH&63) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), SCREENWIDTH&63); 
-	    dest += (SCREENWIDTH&63); 
-	} 
-    } 
+    V_TileFlat (src, 1, ORIGHEIGHT-SBARHEIGHT);
 	
+    // The border goes round the window on the 2D screen.
     patch = W_CacheLumpName ("brdr_t",PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch (viewwindowx+x,viewwindowy-8,1,patch);
+    for (x=0 ; x<windowwidth ; x+=8)
+	V_DrawPatch (windowx+x,windowy-8,1,patch);
     patch = W_CacheLumpName ("brdr_b",PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch (viewwindowx+x,viewwindowy+viewheight,1,patch);
+    for (x=0 ; x<windowwidth ; x+=8)
+	V_DrawPatch (windowx+x,windowy+windowheight,1,patch);
     patch = W_CacheLumpName ("brdr_l",PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch (viewwindowx-8,viewwindowy+y,1,patch);
+    for (y=0 ; y<windowheight ; y+=8)
+	V_DrawPatch (windowx-8,windowy+y,1,patch);
     patch = W_CacheLumpName ("brdr_r",PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch (viewwindowx+scaledviewwidth,viewwindowy+y,1,patch);
+    for (y=0 ; y<windowheight ; y+=8)
+	V_DrawPatch (windowx+windowwidth,windowy+y,1,patch);
 
 
     // Draw beveled edge. 
-    V_DrawPatch (viewwindowx-8,
-		 viewwindowy-8,
+    V_DrawPatch (windowx-8,
+		 windowy-8,
 		 1,
 		 W_CacheLumpName ("brdr_tl",PU_CACHE));
     
-    V_DrawPatch (viewwindowx+scaledviewwidth,
-		 viewwindowy-8,
+    V_DrawPatch (windowx+windowwidth,
+		 windowy-8,
 		 1,
 		 W_CacheLumpName ("brdr_tr",PU_CACHE));
     
-    V_DrawPatch (viewwindowx-8,
-		 viewwindowy+viewheight,
+    V_DrawPatch (windowx-8,
+		 windowy+windowheight,
 		 1,
 		 W_CacheLumpName ("brdr_bl",PU_CACHE));
     
-    V_DrawPatch (viewwindowx+scaledviewwidth,
-		 viewwindowy+viewheight,
+    V_DrawPatch (windowx+windowwidth,
+		 windowy+windowheight,
 		 1,
 		 W_CacheLumpName ("brdr_br",PU_CACHE));
 } 
@@ -842,36 +990,36 @@ V_MarkRect
  
 void R_DrawViewBorder (void) 
 { 
-    int		top;
     int		side;
+    int		bottom;
     int		ofs;
     int		i; 
  
     if (scaledviewwidth == SCREENWIDTH) 
 	return; 
-  
-    top = ((SCREENHEIGHT-SBARHEIGHT)-viewheight)/2; 
-    side = (SCREENWIDTH-scaledviewwidth)/2; 
+
+    // The sides and the top and bottom can be
+    //  a pixel apart once scaled.
+    side = SCREENWIDTH - scaledviewwidth; 
+    bottom = V_ScaleY (ORIGHEIGHT-SBARHEIGHT)*SCREENWIDTH;
  
     // copy top and one line of left side 
-    R_VideoErase (0, top*SCREENWIDTH+side); 
- 
-    // copy one line of right side and bottom 
-    ofs = (viewheight+top)*SCREENWIDTH-side; 
-    R_VideoErase (ofs, top*SCREENWIDTH+side); 
+    R_VideoErase (0, viewwindowy*SCREENWIDTH+viewwindowx); 
  
     // copy sides using wraparound 
-    ofs = top*SCREENWIDTH + SCREENWIDTH-side; 
-    side <<= 1;
+    ofs = viewwindowy*SCREENWIDTH + viewwindowx + scaledviewwidth; 
     
     for (i=1 ; i<viewheight ; i++) 
     { 
 	R_VideoErase (ofs, side); 
 	ofs += SCREENWIDTH; 
     } 
+ 
+    // copy one line of right side and bottom 
+    R_VideoErase (ofs, bottom-ofs); 
 
     // ? 
-    V_MarkRect (0,0,SCREENWIDTH, SCREENHEIGHT-SBARHEIGHT); 
+    V_MarkRect (0,0,ORIGWIDTH, ORIGHEIGHT-SBARHEIGHT); 
 } 
  
  
@@ -29,15 +29,20 @@
 #endif
 
 
-extern lighttable_t*	dc_colormap;
-extern int		dc_x;
-extern int		dc_yl;
-extern int		dc_yh;
-extern fixed_t		dc_iscale;
-extern fixed_t		dc_texturemid;
+// The drawer parameters are per thread,
+//  so worker threads can replay deferred
+//  columns and spans, see r_thread.c.
+#define DRAWSTATE	__thread
+
+extern DRAWSTATE lighttable_t*	dc_colormap;
+extern DRAWSTATE int		dc_x;
+extern DRAWSTATE int		dc_yl;
+extern DRAWSTATE int		dc_yh;
+extern DRAWSTATE fixed_t	dc_iscale;
+extern DRAWSTATE fixed_t	dc_texturemid;
 
 // first pixel in a column
-extern byte*		dc_source;		
+extern DRAWSTATE byte*		dc_source;		
 
 
 // The span blitting interface.
@@ -46,7 +51,22 @@ extern byte*		dc_source;
 void 	R_DrawColumn (void);
 void 	R_DrawColumnLow (void);
 
+// -transpose, walls are drawn down a transposed
+//  buffer and copied into the view after the BSP walk.
+extern boolean	transposeview;
+
+void	R_DrawColumnTransposed (void);
+
+void
+R_TransposeColumns
+( int		x1,
+  int		x2 );
+
 // The Spectre/Invisibility effect.
+#define FUZZTABLE		50 
+
+extern DRAWSTATE int	fuzzpos;
+
 void 	R_DrawFuzzColumn (void);
 void 	R_DrawFuzzColumnLow (void);
 
@@ -61,22 +81,22 @@ R_VideoErase
 ( unsigned	ofs,
   int		count );
 
-extern int		ds_y;
-extern int		ds_x1;
-extern int		ds_x2;
+extern DRAWSTATE int		ds_y;
+extern DRAWSTATE int		ds_x1;
+extern DRAWSTATE int		ds_x2;
 
-extern lighttable_t*	ds_colormap;
+extern DRAWSTATE lighttable_t*	ds_colormap;
 
-extern fixed_t		ds_xfrac;
-extern fixed_t		ds_yfrac;
-extern fixed_t		ds_xstep;
-extern fixed_t		ds_ystep;
+extern DRAWSTATE fixed_t	ds_xfrac;
+extern DRAWSTATE fixed_t	ds_yfrac;
+extern DRAWSTATE fixed_t	ds_xstep;
+extern DRAWSTATE fixed_t	ds_ystep;
 
 // start of a 64*64 tile image
-extern byte*		ds_source;		
+extern DRAWSTATE byte*		ds_source;		
 
-extern byte*		translationtables;
-extern byte*		dc_translation;
+extern byte*			translationtables;
+extern DRAWSTATE byte*		dc_translation;
 
 
 // Span blitting for rows, floor/ceiling.
@@ -87,6 +107,8 @@ void 	R_DrawSpan (void);
 void 	R_DrawSpanLow (void);
 
 
+// Sizes the view window on the 2D screen,
+//  scaledviewwidth and viewheight get it in pixels.
 void
 R_InitBuffer
 ( int		width,
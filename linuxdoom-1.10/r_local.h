@@ -44,6 +44,7 @@
 #include "r_data.h"
 #include "r_things.h"
 #include "r_draw.h"
+#include "r_thread.h"
 
 #endif		// __R_LOCAL__
 //-----------------------------------------------------------------------------
@@ -35,7 +35,12 @@ static const char rcsid[] = "$Id: r_main.c,v 1.5 1997/02/03 22:45:12 b1 Exp $";
 #include "doomdef.h"
 #include "d_net.h"
 
+#include "i_system.h"
+
+#include "m_argv.h"
 #include "m_bbox.h"
+#include "m_bench.h"
+#include "z_zone.h"
 
 #include "r_local.h"
 #include "r_sky.h"
@@ -78,6 +83,21 @@ fixed_t			viewz;
 
 angle_t			viewangle;
 
+fixed_t			lightscalemul;
+
+// Walls closer than this are drawn at it.
+static fixed_t		maxwallscale;
+
+// FRACUNIT unless frames are uncapped.
+fixed_t			interpfrac = FRACUNIT;
+
+// Sectors drawn at interpolated heights,
+//  with the real ones to put back after the frame.
+static sector_t**	movedsectors;
+static fixed_t*		movedheights;
+static int		nummoved;
+static int		maxmoved;
+
 fixed_t			viewcos;
 fixed_t			viewsin;
 
@@ -100,7 +120,8 @@ int			viewangletox[FINEANGLES/2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t			xtoviewangle[SCREENWIDTH+1];
+// [SCREENWIDTH+1], allocated by R_Init.
+angle_t*		xtoviewangle;
 
 
 // UNUSED.
@@ -126,6 +147,9 @@ void (*colfunc) (void);
 void (*basecolfunc) (void);
 void (*fuzzcolfunc) (void);
 void (*transcolfunc) (void);
+
+// Walls in the BSP walk, transposed with -transpose.
+static void (*wallcolfunc) (void);
 void (*spanfunc) (void);
 
 
@@ -443,6 +467,24 @@ void R_InitPointToAngle (void)
 }
 
 
+//
+// R_Interpolate
+// Position between the start of the tic and now
+//  for the frame being drawn.
+//
+fixed_t
+R_Interpolate
+( fixed_t	oldval,
+  fixed_t	newval )
+{
+    if (interpfrac >= FRACUNIT)
+	return newval;
+    
+    return oldval + FixedMul (newval-oldval, interpfrac);
+}
+
+
+
 //
 // R_ScaleFromGlobalAngle
 // Returns the texture mapping scale
@@ -490,13 +532,13 @@ fixed_t R_ScaleFromGlobalAngle (angle_t visangle)
     {
 	scale = FixedDiv (num, den);
 
-	if (scale > 64*FRACUNIT)
-	    scale = 64*FRACUNIT;
+	if (scale > maxwallscale)
+	    scale = maxwallscale;
 	else if (scale < 256)
 	    scale = 256;
     }
     else
-	scale = 64*FRACUNIT;
+	scale = maxwallscale;
 	
     return scale;
 }
@@ -626,7 +668,7 @@ void R_InitLightTables (void)
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
 	for (j=0 ; j<MAXLIGHTZ ; j++)
 	{
-	    scale = FixedDiv ((SCREENWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
+	    scale = FixedDiv ((ORIGWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
 	    scale >>= LIGHTSCALESHIFT;
 	    level = startmap - scale/DISTMAP;
 	    
@@ -676,19 +718,25 @@ void R_ExecuteSetViewSize (void)
     int		j;
     int		level;
     int		startmap; 	
+    int		width;
+    int		height;
 
     setsizeneeded = false;
 
+    // The window is sized on the 2D screen,
+    //  R_InitBuffer scales it to pixels.
     if (setblocks == 11)
     {
-	scaledviewwidth = SCREENWIDTH;
-	viewheight = SCREENHEIGHT;
+	width = ORIGWIDTH;
+	height = ORIGHEIGHT;
     }
     else
     {
-	scaledviewwidth = setblocks*32;
-	viewheight = (setblocks*168/10)&~7;
+	width = setblocks*32;
+	height = (setblocks*168/10)&~7;
     }
+
+    R_InitBuffer (width, height);
     
     detailshift = setdetail;
     viewwidth = scaledviewwidth>>detailshift;
@@ -699,7 +747,16 @@ void R_ExecuteSetViewSize (void)
     centeryfrac = centery<<FRACBITS;
     projection = centerxfrac;
 
-    if (!detailshift)
+    if (!detailshift && numrthreads > 1)
+    {
+	// The low detail drawers overrun the span end,
+	//  so only full detail can be cut into strips.
+	colfunc = basecolfunc = R_DeferColumn;
+	fuzzcolfunc = R_DeferFuzzColumn;
+	transcolfunc = R_DeferTranslatedColumn;
+	spanfunc = R_DeferSpan;
+    }
+    else if (!detailshift)
     {
 	colfunc = basecolfunc = R_DrawColumn;
 	fuzzcolfunc = R_DrawFuzzColumn;
@@ -714,13 +771,31 @@ void R_ExecuteSetViewSize (void)
 	spanfunc = R_DrawSpanLow;
     }
 
-    R_InitBuffer (scaledviewwidth, viewheight);
+    // The low detail drawers write pixel pairs across a row.
+    wallcolfunc = basecolfunc;
+    if (transposeview && !detailshift)
+    {
+	wallcolfunc = numrthreads > 1 ? R_DeferColumnTransposed
+	    : R_DrawColumnTransposed;
+    }
+
+    R_SetupStrips ();
 	
     R_InitTextureMapping ();
+
+    // Wall scales grow with the screen,
+    //  light is still looked up at the original size.
+    maxwallscale = (fixed_t)((long long)64*FRACUNIT*SCREENWIDTH/ORIGWIDTH);
+    lightscalemul = (fixed_t)((long long)FRACUNIT*ORIGWIDTH/SCREENWIDTH);
     
-    // psprite scales
-    pspritescale = FRACUNIT*viewwidth/SCREENWIDTH;
-    pspriteiscale = FRACUNIT*SCREENWIDTH/viewwidth;
+    // psprite scales,
+    //  stretched down with the 2D screen.
+    pspritescale = FRACUNIT*viewwidth/ORIGWIDTH;
+    pspriteiscale = FRACUNIT*ORIGWIDTH/viewwidth;
+    pspriteyscale = (fixed_t)((long long)FRACUNIT*scaledviewwidth*SCREENHEIGHT
+			      / ((long long)SCREENWIDTH*ORIGHEIGHT));
+    pspriteyiscale = (fixed_t)((long long)FRACUNIT*SCREENWIDTH*ORIGHEIGHT
+			       / ((long long)scaledviewwidth*SCREENHEIGHT));
     
     // thing clipping
     for (i=0 ; i<viewwidth ; i++)
@@ -772,6 +847,11 @@ extern int	screenblocks;
 
 void R_Init (void)
 {
+    xtoviewangle = Z_Malloc ((SCREENWIDTH+1)*sizeof(*xtoviewangle),
+			     PU_STATIC, 0);
+
+    transposeview = M_CheckParm ("-transpose");
+
     R_InitData ();
     printf ("\nR_InitData");
     R_InitPointToAngle ();
@@ -789,6 +869,7 @@ void R_Init (void)
     printf ("\nR_InitSkyMap");
     R_InitTranslationTables ();
     printf ("\nR_InitTranslationsTables");
+    R_InitThreads ();
 	
     framecount = 0;
 }
@@ -832,12 +913,19 @@ void R_SetupFrame (player_t* player)
     int		i;
     
     viewplayer = player;
-    viewx = player->mo->x;
-    viewy = player->mo->y;
+    viewx = R_Interpolate (player->mo->oldx, player->mo->x);
+    viewy = R_Interpolate (player->mo->oldy, player->mo->y);
     viewangle = player->mo->angle + viewangleoffset;
+    if (interpfrac < FRACUNIT)
+    {
+	// signed difference, turns the short way round
+	viewangle = player->mo->oldangle + viewangleoffset
+	    + FixedMul ((int)(player->mo->angle - player->mo->oldangle),
+			interpfrac);
+    }
     extralight = player->extralight;
 
-    viewz = player->viewz;
+    viewz = R_Interpolate (player->oldviewz, player->viewz);
     
     viewsin = finesine[viewangle>>ANGLETOFINESHIFT];
     viewcos = finecosine[viewangle>>ANGLETOFINESHIFT];
@@ -864,12 +952,75 @@ void R_SetupFrame (player_t* player)
 
 
 
+//
+// R_InterpolateSectors
+// Moves the planes the last tic changed to where
+//  they are at interpfrac, R_RestoreSectors puts them back.
+//
+static void R_InterpolateSectors (void)
+{
+    int		i;
+    sector_t*	sec;
+    
+    nummoved = 0;
+    
+    if (interpfrac >= FRACUNIT)
+	return;
+
+    if (maxmoved < numsectors)
+    {
+	maxmoved = numsectors;
+	movedsectors = realloc (movedsectors, maxmoved*sizeof(*movedsectors));
+	movedheights = realloc (movedheights, 2*maxmoved*sizeof(*movedheights));
+	if (!movedsectors || !movedheights)
+	    I_Error ("R_InterpolateSectors: couldn't realloc %i sectors",
+		     maxmoved);
+    }
+    
+    for (i=0, sec = sectors ; i<numsectors ; i++, sec++)
+    {
+	if (sec->oldfloorheight == sec->floorheight
+	    && sec->oldceilingheight == sec->ceilingheight)
+	    continue;
+	
+	movedsectors[nummoved] = sec;
+	movedheights[nummoved*2] = sec->floorheight;
+	movedheights[nummoved*2+1] = sec->ceilingheight;
+	nummoved++;
+	
+	sec->floorheight = R_Interpolate (sec->oldfloorheight,
+					  sec->floorheight);
+	sec->ceilingheight = R_Interpolate (sec->oldceilingheight,
+					    sec->ceilingheight);
+    }
+}
+
+
+//
+// R_RestoreSectors
+//
+static void R_RestoreSectors (void)
+{
+    int		i;
+    
+    for (i=0 ; i<nummoved ; i++)
+    {
+	movedsectors[i]->floorheight = movedheights[i*2];
+	movedsectors[i]->ceilingheight = movedheights[i*2+1];
+    }
+    nummoved = 0;
+}
+
+
+
 //
 // R_RenderView
 //
 void R_RenderPlayerView (player_t* player)
 {	
+    R_FinishComposites (false);
     R_SetupFrame (player);
+    R_InterpolateSectors ();
 
     // Clear buffers.
     R_ClearClipSegs ();
@@ -881,17 +1032,38 @@ void R_RenderPlayerView (player_t* player)
     NetUpdate ();
 
     // The head node is the last node output.
+    M_BenchBegin (bs_bsp);
+    colfunc = wallcolfunc;
     R_RenderBSPNode (numnodes-1);
+    colfunc = basecolfunc;
+
+    // Only walls are drawn yet, the planes and
+    //  sprites go over the transposed view.
+    if (wallcolfunc == R_DeferColumnTransposed)
+	R_DeferTranspose ();
+    else if (wallcolfunc == R_DrawColumnTransposed)
+	R_TransposeColumns (0, viewwidth-1);
+    M_BenchEnd (bs_bsp);
     
     // Check for new console commands.
     NetUpdate ();
     
+    M_BenchBegin (bs_planes);
     R_DrawPlanes ();
+    M_BenchEnd (bs_planes);
     
     // Check for new console commands.
     NetUpdate ();
     
+    M_BenchBegin (bs_masked);
     R_DrawMasked ();
+    M_BenchEnd (bs_masked);
+
+    // Strips still queued are drawn before the view
+    //  is overdrawn by the HUD or blitted.
+    R_FlushDraws ();
+
+    R_RestoreSectors ();
 
     // Check for new console commands.
     NetUpdate ();				
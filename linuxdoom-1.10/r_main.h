@@ -52,6 +52,10 @@ extern fixed_t		centerxfrac;
 extern fixed_t		centeryfrac;
 extern fixed_t		projection;
 
+// How far the frame is between the last tic and the next,
+//  FRACUNIT draws the positions the last tic left.
+extern fixed_t		interpfrac;
+
 extern int		validcount;
 
 extern int		linecount;
@@ -74,6 +78,10 @@ extern int		loopcount;
 #define MAXLIGHTZ	       128
 #define LIGHTZSHIFT		20
 
+// Scales are multiplied by this before picking a light,
+//  so walls light up as they would on an ORIGWIDTH screen.
+extern fixed_t		lightscalemul;
+
 extern lighttable_t*	scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
 extern lighttable_t*	scalelightfixed[MAXLIGHTSCALE];
 extern lighttable_t*	zlight[LIGHTLEVELS][MAXLIGHTZ];
@@ -100,6 +108,7 @@ extern	int		detailshift;
 extern void		(*colfunc) (void);
 extern void		(*basecolfunc) (void);
 extern void		(*fuzzcolfunc) (void);
+extern void		(*transcolfunc) (void);
 // No shadow effects on floors.
 extern void		(*spanfunc) (void);
 
@@ -138,6 +147,11 @@ R_PointToDist
 
 fixed_t R_ScaleFromGlobalAngle (angle_t visangle);
 
+fixed_t
+R_Interpolate
+( fixed_t	oldval,
+  fixed_t	newval );
+
 subsector_t*
 R_PointInSubsector
 ( fixed_t	x,
@@ -49,15 +49,32 @@ planefunction_t		ceilingfunc;
 //
 
 // Here comes the obnoxious "visplane".
+// Allocated one by one, as floorplane and ceilingplane
+//  are held on to while more are added, and reused
+//  from frame to frame. The pool only grows.
 #define MAXVISPLANES	128
-visplane_t		visplanes[MAXVISPLANES];
-visplane_t*		lastvisplane;
+visplane_t**		visplanes;
+int			numvisplanes;
+int			maxvisplanes;
 visplane_t*		floorplane;
 visplane_t*		ceilingplane;
 
-// ?
-#define MAXOPENINGS	SCREENWIDTH*64
-short			openings[MAXOPENINGS];
+// R_FindPlane lookup on height/picnum/lightlevel.
+// Only the first plane of each kind is hashed,
+//  R_CheckPlane splits are never found by R_FindPlane.
+#define VISPLANEHASH	128
+visplane_t*		visplanehash[VISPLANEHASH];
+
+#define VisplaneHash(h,p,l) \
+    ((unsigned)((h)>>FRACBITS ^ (p)*7 ^ (l)*3) & (VISPLANEHASH-1))
+
+// Drawsegs point into these for the whole frame,
+//  so they come in chunks that are never moved.
+#define MAXOPENINGS	(SCREENWIDTH*64)
+short**			openingchunks;
+int			numopeningchunks;
+int			curopeningchunk;
+short*			openingsend;
 short*			lastopening;
 
 
@@ -66,15 +83,14 @@ short*			lastopening;
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 //
-short			floorclip[SCREENWIDTH];
-short			ceilingclip[SCREENWIDTH];
+short*			floorclip;
+short*			ceilingclip;
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[SCREENHEIGHT];
-int			spanstop[SCREENHEIGHT];
+int*			spanstart;
 
 //
 // texture mapping
@@ -82,25 +98,108 @@ int			spanstop[SCREENHEIGHT];
 lighttable_t**		planezlight;
 fixed_t			planeheight;
 
-fixed_t			yslope[SCREENHEIGHT];
-fixed_t			distscale[SCREENWIDTH];
+fixed_t*		yslope;
+fixed_t*		distscale;
 fixed_t			basexscale;
 fixed_t			baseyscale;
 
-fixed_t			cachedheight[SCREENHEIGHT];
-fixed_t			cacheddistance[SCREENHEIGHT];
-fixed_t			cachedxstep[SCREENHEIGHT];
-fixed_t			cachedystep[SCREENHEIGHT];
+fixed_t*		cachedheight;
+fixed_t*		cacheddistance;
+fixed_t*		cachedxstep;
+fixed_t*		cachedystep;
 
 
 
 //
 // R_InitPlanes
 // Only at game startup.
+// Sizes the tables to the screen.
 //
 void R_InitPlanes (void)
 {
-  // Doh!
+    floorclip = Z_Malloc (SCREENWIDTH*sizeof(*floorclip), PU_STATIC, 0);
+    ceilingclip = Z_Malloc (SCREENWIDTH*sizeof(*ceilingclip), PU_STATIC, 0);
+    distscale = Z_Malloc (SCREENWIDTH*sizeof(*distscale), PU_STATIC, 0);
+    
+    spanstart = Z_Malloc (SCREENHEIGHT*sizeof(*spanstart), PU_STATIC, 0);
+    yslope = Z_Malloc (SCREENHEIGHT*sizeof(*yslope), PU_STATIC, 0);
+    cachedheight = Z_Malloc (SCREENHEIGHT*sizeof(fixed_t), PU_STATIC, 0);
+    cacheddistance = Z_Malloc (SCREENHEIGHT*sizeof(fixed_t), PU_STATIC, 0);
+    cachedxstep = Z_Malloc (SCREENHEIGHT*sizeof(fixed_t), PU_STATIC, 0);
+    cachedystep = Z_Malloc (SCREENHEIGHT*sizeof(fixed_t), PU_STATIC, 0);
+}
+
+
+//
+// R_NewVisplane
+//
+static visplane_t* R_NewVisplane (void)
+{
+    int		i;
+    
+    if (numvisplanes == maxvisplanes)
+    {
+	i = maxvisplanes;
+	maxvisplanes = maxvisplanes ? maxvisplanes*2 : MAXVISPLANES;
+	visplanes = realloc (visplanes, maxvisplanes*sizeof(*visplanes));
+	if (!visplanes)
+	    I_Error ("R_NewVisplane: couldn't realloc %i visplanes",
+		     maxvisplanes);
+
+	// the rows follow the plane, each with a pad either side
+	for ( ; i<maxvisplanes ; i++)
+	{
+	    visplanes[i] = malloc (sizeof(visplane_t)
+				   + 2*(SCREENWIDTH+2)*sizeof(short));
+	    if (!visplanes[i])
+		I_Error ("R_NewVisplane: couldn't malloc visplane");
+	    visplanes[i]->top = (unsigned short *)(visplanes[i]+1) + 1;
+	    visplanes[i]->bottom = visplanes[i]->top + SCREENWIDTH+2;
+	}
+    }
+
+    return visplanes[numvisplanes++];
+}
+
+
+//
+// R_NextOpeningChunk
+//
+static void R_NextOpeningChunk (void)
+{
+    if (++curopeningchunk == numopeningchunks)
+    {
+	numopeningchunks++;
+	openingchunks = realloc (openingchunks,
+				 numopeningchunks*sizeof(*openingchunks));
+	if (!openingchunks)
+	    I_Error ("R_NextOpeningChunk: couldn't realloc chunks");
+	
+	openingchunks[curopeningchunk] =
+	    malloc (MAXOPENINGS*sizeof(**openingchunks));
+	if (!openingchunks[curopeningchunk])
+	    I_Error ("R_NextOpeningChunk: couldn't malloc openings");
+    }
+    
+    lastopening = openingchunks[curopeningchunk];
+    openingsend = lastopening + MAXOPENINGS;
+}
+
+
+//
+// R_CheckOpenings
+// Makes sure count openings fit at lastopening,
+//  moving on to the next chunk if not.
+//
+void R_CheckOpenings (int count)
+{
+    if (openingsend - lastopening >= count)
+	return;
+
+    if (count > MAXOPENINGS)
+	I_Error ("R_CheckOpenings: %i openings", count);
+
+    R_NextOpeningChunk ();
 }
 
 
@@ -194,11 +293,14 @@ void R_ClearPlanes (void)
 	ceilingclip[i] = -1;
     }
 
-    lastvisplane = visplanes;
-    lastopening = openings;
+    numvisplanes = 0;
+    memset (visplanehash, 0, sizeof(visplanehash));
+
+    curopeningchunk = -1;
+    R_NextOpeningChunk ();
     
     // texture calculation
-    memset (cachedheight, 0, sizeof(cachedheight));
+    memset (cachedheight, 0, SCREENHEIGHT*sizeof(*cachedheight));
 
     // left to right mapping
     angle = (viewangle-ANG90)>>ANGLETOFINESHIFT;
@@ -221,31 +323,29 @@ R_FindPlane
   int		lightlevel )
 {
     visplane_t*	check;
+    unsigned	hash;
 	
     if (picnum == skyflatnum)
     {
 	height = 0;			// all skys map together
 	lightlevel = 0;
     }
+
+    hash = VisplaneHash (height, picnum, lightlevel);
 	
-    for (check=visplanes; check<lastvisplane; check++)
+    for (check=visplanehash[hash]; check; check=check->next)
     {
 	if (height == check->height
 	    && picnum == check->picnum
 	    && lightlevel == check->lightlevel)
 	{
-	    break;
+	    return check;
 	}
     }
     
-			
-    if (check < lastvisplane)
-	return check;
-		
-    if (lastvisplane - visplanes == MAXVISPLANES)
-	I_Error ("R_FindPlane: no more visplanes");
-		
-    lastvisplane++;
+    check = R_NewVisplane ();
+    check->next = visplanehash[hash];
+    visplanehash[hash] = check;
 
     check->height = height;
     check->picnum = picnum;
@@ -253,7 +353,7 @@ R_FindPlane
     check->minx = SCREENWIDTH;
     check->maxx = -1;
     
-    memset (check->top,0xff,sizeof(check->top));
+    memset (check->top,0xff,SCREENWIDTH*sizeof(*check->top));
 		
     return check;
 }
@@ -273,6 +373,7 @@ R_CheckPlane
     int		unionl;
     int		unionh;
     int		x;
+    visplane_t*	check;
 	
     if (start < pl->minx)
     {
@@ -297,7 +398,7 @@ R_CheckPlane
     }
 
     for (x=intrl ; x<= intrh ; x++)
-	if (pl->top[x] != 0xff)
+	if (pl->top[x] != NOPLANEROW)
 	    break;
 
     if (x > intrh)
@@ -310,15 +411,17 @@ R_CheckPlane
     }
 	
     // make a new visplane
-    lastvisplane->height = pl->height;
-    lastvisplane->picnum = pl->picnum;
-    lastvisplane->lightlevel = pl->lightlevel;
+    check = R_NewVisplane ();
+    check->next = NULL;
+    check->height = pl->height;
+    check->picnum = pl->picnum;
+    check->lightlevel = pl->lightlevel;
     
-    pl = lastvisplane++;
+    pl = check;
     pl->minx = start;
     pl->maxx = stop;
 
-    memset (pl->top,0xff,sizeof(pl->top));
+    memset (pl->top,0xff,SCREENWIDTH*sizeof(*pl->top));
 		
     return pl;
 }
@@ -367,27 +470,16 @@ R_MakeSpans
 void R_DrawPlanes (void)
 {
     visplane_t*		pl;
+    int			i;
     int			light;
     int			x;
     int			stop;
     int			angle;
 				
-#ifdef RANGECHECK
-    if (ds_p - drawsegs > MAXDRAWSEGS)
-	I_Error ("R_DrawPlanes: drawsegs overflow (%i)",
-		 ds_p - drawsegs);
-    
-    if (lastvisplane - visplanes > MAXVISPLANES)
-	I_Error ("R_DrawPlanes: visplane overflow (%i)",
-		 lastvisplane - visplanes);
-    
-    if (lastopening - openings > MAXOPENINGS)
-	I_Error ("R_DrawPlanes: opening overflow (%i)",
-		 lastopening - openings);
-#endif
-
-    for (pl = visplanes ; pl < lastvisplane ; pl++)
+    for (i=0 ; i<numvisplanes ; i++)
     {
+	pl = visplanes[i];
+	
 	if (pl->minx > pl->maxx)
 	    continue;
 
@@ -395,7 +487,7 @@ void R_DrawPlanes (void)
 	// sky flat
 	if (pl->picnum == skyflatnum)
 	{
-	    dc_iscale = pspriteiscale>>detailshift;
+	    dc_iscale = pspriteyiscale;
 	    
 	    // Sky is allways drawn full bright,
 	    //  i.e. colormaps[0] is used.
@@ -435,8 +527,8 @@ void R_DrawPlanes (void)
 
 	planezlight = zlight[light];
 
-	pl->top[pl->maxx+1] = 0xff;
-	pl->top[pl->minx-1] = 0xff;
+	pl->top[pl->maxx+1] = NOPLANEROW;
+	pl->top[pl->minx-1] = NOPLANEROW;
 		
 	stop = pl->maxx + 1;
 
@@ -34,17 +34,23 @@
 // Visplane related.
 extern  short*		lastopening;
 
+// Call before taking count openings at lastopening.
+void R_CheckOpenings (int count);
+
 
 typedef void (*planefunction_t) (int top, int bottom);
 
 extern planefunction_t	floorfunc;
 extern planefunction_t	ceilingfunc_t;
 
-extern short		floorclip[SCREENWIDTH];
-extern short		ceilingclip[SCREENWIDTH];
+// Top row of an empty visplane column.
+#define NOPLANEROW		0xffff
+
+extern short*		floorclip;
+extern short*		ceilingclip;
 
-extern fixed_t		yslope[SCREENHEIGHT];
-extern fixed_t		distscale[SCREENWIDTH];
+extern fixed_t*		yslope;
+extern fixed_t*		distscale;
 
 void R_InitPlanes (void);
 void R_ClearPlanes (void);
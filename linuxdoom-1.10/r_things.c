@@ -37,6 +37,8 @@ rcsid[] = "$Id: r_things.c,v 1.5 1997/02/03 16:47:56 b1 Exp $";
 #include "z_zone.h"
 #include "w_wad.h"
 
+#include "m_bench.h"
+
 #include "r_local.h"
 
 #include "doomstat.h"
@@ -74,12 +76,21 @@ typedef struct
 fixed_t		pspritescale;
 fixed_t		pspriteiscale;
 
+// The weapon is stretched to the screen like the status bar,
+//  so it scales down the columns by its own amount.
+fixed_t		pspriteyscale;
+fixed_t		pspriteyiscale;
+
 lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-short		negonearray[SCREENWIDTH];
-short		screenheightarray[SCREENWIDTH];
+short*		negonearray;
+short*		screenheightarray;
+
+// R_DrawSprite clipping, [SCREENWIDTH] each.
+static short*	clipbot;
+static short*	cliptop;
 
 
 //
@@ -286,10 +297,13 @@ void R_InitSpriteDefs (char** namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t	vissprites[MAXVISSPRITES];
+vissprite_t*	vissprites;
 vissprite_t*	vissprite_p;
 int		newvissprite;
 
+int		maxvissprites;
+int		numvissprites;
+
 
 
 //
@@ -299,6 +313,11 @@ int		newvissprite;
 void R_InitSprites (char** namelist)
 {
     int		i;
+
+    negonearray = Z_Malloc (SCREENWIDTH*sizeof(short), PU_STATIC, 0);
+    screenheightarray = Z_Malloc (SCREENWIDTH*sizeof(short), PU_STATIC, 0);
+    clipbot = Z_Malloc (SCREENWIDTH*sizeof(short), PU_STATIC, 0);
+    cliptop = Z_Malloc (SCREENWIDTH*sizeof(short), PU_STATIC, 0);
 	
     for (i=0 ; i<SCREENWIDTH ; i++)
     {
@@ -322,13 +341,25 @@ void R_ClearSprites (void)
 
 //
 // R_NewVisSprite
+// The pool doubles when full. Nobody holds on
+//  to a vissprite across calls, so it may move.
 //
-vissprite_t	overflowsprite;
-
 vissprite_t* R_NewVisSprite (void)
 {
-    if (vissprite_p == &vissprites[MAXVISSPRITES])
-	return &overflowsprite;
+    int		count;
+    
+    count = vissprite_p - vissprites;
+    
+    if (count == maxvissprites)
+    {
+	maxvissprites = maxvissprites ? maxvissprites*2 : 128;
+	vissprites = realloc (vissprites,
+			      maxvissprites*sizeof(*vissprites));
+	if (!vissprites)
+	    I_Error ("R_NewVisSprite: couldn't realloc %i vissprites",
+		     maxvissprites);
+	vissprite_p = vissprites + count;
+    }
     
     vissprite_p++;
     return vissprite_p-1;
@@ -416,12 +447,12 @@ R_DrawVisSprite
     }
     else if (vis->mobjflags & MF_TRANSLATION)
     {
-	colfunc = R_DrawTranslatedColumn;
+	colfunc = transcolfunc;
 	dc_translation = translationtables - 256 +
 	    ( (vis->mobjflags & MF_TRANSLATION) >> (MF_TRANSSHIFT-8) );
     }
 	
-    dc_iscale = abs(vis->xiscale)>>detailshift;
+    dc_iscale = vis->yiscale;
     dc_texturemid = vis->texturemid;
     frac = vis->startfrac;
     spryscale = vis->scale;
@@ -479,9 +510,18 @@ void R_ProjectSprite (mobj_t* thing)
     angle_t		ang;
     fixed_t		iscale;
     
+    fixed_t		thingx;
+    fixed_t		thingy;
+    fixed_t		thingz;
+    
+    // where the thing is at this frame
+    thingx = R_Interpolate (thing->oldx, thing->x);
+    thingy = R_Interpolate (thing->oldy, thing->y);
+    thingz = R_Interpolate (thing->oldz, thing->z);
+    
     // transform the origin point
-    tr_x = thing->x - viewx;
-    tr_y = thing->y - viewy;
+    tr_x = thingx - viewx;
+    tr_y = thingy - viewy;
 	
     gxt = FixedMul(tr_x,viewcos); 
     gyt = -FixedMul(tr_y,viewsin);
@@ -519,7 +559,7 @@ void R_ProjectSprite (mobj_t* thing)
     if (sprframe->rotate)
     {
 	// choose a different rotation based on player view
-	ang = R_PointToAngle (thing->x, thing->y);
+	ang = R_PointToAngle (thingx, thingy);
 	rot = (ang-thing->angle+(unsigned)(ANG45/2)*9)>>29;
 	lump = sprframe->lump[rot];
 	flip = (boolean)sprframe->flip[rot];
@@ -550,14 +590,15 @@ void R_ProjectSprite (mobj_t* thing)
     vis = R_NewVisSprite ();
     vis->mobjflags = thing->flags;
     vis->scale = xscale<<detailshift;
-    vis->gx = thing->x;
-    vis->gy = thing->y;
-    vis->gz = thing->z;
-    vis->gzt = thing->z + spritetopoffset[lump];
+    vis->gx = thingx;
+    vis->gy = thingy;
+    vis->gz = thingz;
+    vis->gzt = thingz + spritetopoffset[lump];
     vis->texturemid = vis->gzt - viewz;
     vis->x1 = x1 < 0 ? 0 : x1;
     vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
     iscale = FixedDiv (FRACUNIT, xscale);
+    vis->yiscale = iscale>>detailshift;
 
     if (flip)
     {
@@ -594,7 +635,7 @@ void R_ProjectSprite (mobj_t* thing)
     else
     {
 	// diminished light
-	index = xscale>>(LIGHTSCALESHIFT-detailshift);
+	index = FixedMul (xscale, lightscalemul)>>(LIGHTSCALESHIFT-detailshift);
 
 	if (index >= MAXLIGHTSCALE) 
 	    index = MAXLIGHTSCALE-1;
@@ -695,7 +736,8 @@ void R_DrawPSprite (pspdef_t* psp)
     vis->texturemid = (BASEYCENTER<<FRACBITS)+FRACUNIT/2-(psp->sy-spritetopoffset[lump]);
     vis->x1 = x1 < 0 ? 0 : x1;
     vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
-    vis->scale = pspritescale<<detailshift;
+    vis->scale = pspriteyscale;
+    vis->yiscale = pspriteyiscale;
     
     if (flip)
     {
@@ -780,58 +822,65 @@ void R_DrawPlayerSprites (void)
 
 //
 // R_SortVisSprites
+// Back to front, that is by increasing scale.
+// Equal scales keep projection order, like
+//  the old selection sort did.
 //
 vissprite_t	vsprsortedhead;
 
+static vissprite_t**	vsprsort;
+static int		maxvsprsort;
+
+
+static int R_CompareVisSprites (const void* a, const void* b)
+{
+    vissprite_t*	x = *(vissprite_t **)a;
+    vissprite_t*	y = *(vissprite_t **)b;
+
+    if (x->scale != y->scale)
+	return x->scale < y->scale ? -1 : 1;
+
+    return x < y ? -1 : x > y;
+}
+
 
 void R_SortVisSprites (void)
 {
     int			i;
     int			count;
     vissprite_t*	ds;
-    vissprite_t*	best;
-    vissprite_t		unsorted;
-    fixed_t		bestscale;
 
     count = vissprite_p - vissprites;
+    numvissprites = count;
 	
-    unsorted.next = unsorted.prev = &unsorted;
+    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
 
     if (!count)
 	return;
-		
-    for (ds=vissprites ; ds<vissprite_p ; ds++)
+
+    if (count > maxvsprsort)
     {
-	ds->next = ds+1;
-	ds->prev = ds-1;
+	maxvsprsort = maxvissprites;
+	vsprsort = realloc (vsprsort, maxvsprsort*sizeof(*vsprsort));
+	if (!vsprsort)
+	    I_Error ("R_SortVisSprites: couldn't realloc %i",
+		     maxvsprsort);
     }
     
-    vissprites[0].prev = &unsorted;
-    unsorted.next = &vissprites[0];
-    (vissprite_p-1)->next = &unsorted;
-    unsorted.prev = vissprite_p-1;
-    
-    // pull the vissprites out by scale
-    //best = 0;		// shut up the compiler warning
-    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
+    for (i=0 ; i<count ; i++)
+	vsprsort[i] = &vissprites[i];
+
+    qsort (vsprsort, count, sizeof(*vsprsort), R_CompareVisSprites);
+
+    // link them up in sorted order
     for (i=0 ; i<count ; i++)
     {
-	bestscale = MAXINT;
-	for (ds=unsorted.next ; ds!= &unsorted ; ds=ds->next)
-	{
-	    if (ds->scale < bestscale)
-	    {
-		bestscale = ds->scale;
-		best = ds;
-	    }
-	}
-	best->next->prev = best->prev;
-	best->prev->next = best->next;
-	best->next = &vsprsortedhead;
-	best->prev = vsprsortedhead.prev;
-	vsprsortedhead.prev->next = best;
-	vsprsortedhead.prev = best;
+	ds = vsprsort[i];
+	ds->prev = i ? vsprsort[i-1] : &vsprsortedhead;
+	ds->next = i<count-1 ? vsprsort[i+1] : &vsprsortedhead;
     }
+    vsprsortedhead.next = vsprsort[0];
+    vsprsortedhead.prev = vsprsort[count-1];
 }
 
 
@@ -842,8 +891,6 @@ void R_SortVisSprites (void)
 void R_DrawSprite (vissprite_t* spr)
 {
     drawseg_t*		ds;
-    short		clipbot[SCREENWIDTH];
-    short		cliptop[SCREENWIDTH];
     int			x;
     int			r1;
     int			r2;
@@ -961,6 +1008,7 @@ void R_DrawMasked (void)
     drawseg_t*		ds;
 	
     R_SortVisSprites ();
+    M_BenchCount (bc_sprites, numvissprites);
 
     if (vissprite_p > vissprites)
     {
@@ -28,16 +28,18 @@
 #pragma interface
 #endif
 
-#define MAXVISSPRITES  	128
-
-extern vissprite_t	vissprites[MAXVISSPRITES];
+// Grows as needed, no sprites are dropped.
+extern vissprite_t*	vissprites;
 extern vissprite_t*	vissprite_p;
 extern vissprite_t	vsprsortedhead;
 
+// Sprites projected for the last frame.
+extern int		numvissprites;
+
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern short		negonearray[SCREENWIDTH];
-extern short		screenheightarray[SCREENWIDTH];
+extern short*		negonearray;
+extern short*		screenheightarray;
 
 // vars for R_DrawMaskedColumn
 extern short*		mfloorclip;
@@ -47,6 +49,8 @@ extern fixed_t		sprtopscreen;
 
 extern fixed_t		pspritescale;
 extern fixed_t		pspriteiscale;
+extern fixed_t		pspriteyscale;
+extern fixed_t		pspriteyiscale;
 
 
 void R_DrawMaskedColumn (column_t* column);
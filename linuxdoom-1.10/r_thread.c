@@ -0,0 +1,417 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// $Log:$
+//
+// DESCRIPTION:
+//	Parallel column/span drawing.
+//	The refresh walks the BSP, clips and sorts as usual,
+//	 but colfunc/spanfunc only queue their parameters.
+//	The view is split into vertical strips, one queue
+//	 per strip, and each strip is drawn by its own thread,
+//	 in the original order. Columns never cross a strip,
+//	 spans are cut at the strip edges with the texture
+//	 position advanced exactly as the drawer would have,
+//	 so the frame comes out bit-identical.
+//
+//-----------------------------------------------------------------------------
+
+static const char
+rcsid[] = "$Id: r_thread.c,v 1.0 1997/12/23 12:00:00 b1 Exp $";
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "doomdef.h"
+
+#include "i_system.h"
+#include "z_zone.h"
+#include "m_argv.h"
+
+#include "r_local.h"
+
+#ifdef __GNUG__
+#pragma implementation "r_thread.h"
+#endif
+#include "r_thread.h"
+
+
+#define MAXRTHREADS		32
+
+
+//
+// One queued column or span.
+//
+typedef struct
+{
+    void		(*drawer) (void);
+    
+    lighttable_t*	colormap;
+    byte*		source;
+    byte*		translation;
+
+    // dc_texturemid, dc_iscale for columns,
+    //  ds_xfrac, ds_yfrac, ds_xstep, ds_ystep for spans.
+    fixed_t		frac;
+    fixed_t		yfrac;
+    fixed_t		step;
+    fixed_t		ystep;
+
+    // dc_x, dc_yl, dc_yh or ds_x1, ds_x2, ds_y
+    int			x1;
+    int			x2;
+    int			y1;
+    int			y2;
+
+    int			fuzzpos;
+    
+} drawcmd_t;
+
+
+typedef struct
+{
+    drawcmd_t*		cmds;
+    int			numcmds;
+    int			maxcmds;
+
+    pthread_t		thread;
+    
+} strip_t;
+
+
+int			numrthreads = 1;
+
+static strip_t		strips[MAXRTHREADS];
+static int		stripwidth;
+static int		queuedcmds;
+
+// Bumped for every flush, workers wait for a change.
+static int		drawgeneration;
+static int		pendingstrips;
+
+static pthread_mutex_t	drawlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	drawstart = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	drawdone = PTHREAD_COND_INITIALIZER;
+
+
+
+//
+// R_RunTranspose
+// Only marks a queued R_TransposeColumns.
+//
+static void R_RunTranspose (void)
+{
+}
+
+
+
+//
+// R_RunStrip
+// Replays the queue of one strip.
+//
+static void R_RunStrip (strip_t* strip)
+{
+    drawcmd_t*	cmd;
+    drawcmd_t*	end;
+
+    end = strip->cmds + strip->numcmds;
+    
+    for (cmd = strip->cmds ; cmd < end ; cmd++)
+    {
+	if (cmd->drawer == R_RunTranspose)
+	{
+	    R_TransposeColumns (cmd->x1, cmd->x2);
+	    continue;
+	}
+	
+	if (cmd->drawer == R_DrawSpan)
+	{
+	    ds_x1 = cmd->x1;
+	    ds_x2 = cmd->x2;
+	    ds_y = cmd->y1;
+	    ds_colormap = cmd->colormap;
+	    ds_source = cmd->source;
+	    ds_xfrac = cmd->frac;
+	    ds_yfrac = cmd->yfrac;
+	    ds_xstep = cmd->step;
+	    ds_ystep = cmd->ystep;
+	}
+	else
+	{
+	    dc_x = cmd->x1;
+	    dc_yl = cmd->y1;
+	    dc_yh = cmd->y2;
+	    dc_colormap = cmd->colormap;
+	    dc_source = cmd->source;
+	    dc_translation = cmd->translation;
+	    dc_texturemid = cmd->frac;
+	    dc_iscale = cmd->step;
+	    fuzzpos = cmd->fuzzpos;
+	}
+	cmd->drawer ();
+    }
+}
+
+
+static void* R_StripThread (void* arg)
+{
+    strip_t*	strip;
+    int		generation;
+
+    strip = (strip_t *)arg;
+    generation = 0;
+    
+    while (1)
+    {
+	pthread_mutex_lock (&drawlock);
+	while (drawgeneration == generation)
+	    pthread_cond_wait (&drawstart, &drawlock);
+	generation = drawgeneration;
+	pthread_mutex_unlock (&drawlock);
+
+	R_RunStrip (strip);
+
+	pthread_mutex_lock (&drawlock);
+	if (!--pendingstrips)
+	    pthread_cond_signal (&drawdone);
+	pthread_mutex_unlock (&drawlock);
+    }
+
+    return NULL;
+}
+
+
+
+//
+// R_InitThreads
+//
+void R_InitThreads (void)
+{
+    int		p;
+    int		i;
+
+    p = M_CheckParm ("-rthreads");
+    if (!p || p >= myargc-1)
+	return;
+
+    numrthreads = atoi (myargv[p+1]);
+    if (numrthreads > MAXRTHREADS)
+	numrthreads = MAXRTHREADS;
+    if (numrthreads <= 1)
+    {
+	numrthreads = 1;
+	return;
+    }
+
+    for (i=0 ; i<numrthreads ; i++)
+    {
+	if (pthread_create (&strips[i].thread, NULL,
+			    R_StripThread, &strips[i]))
+	    I_Error ("R_InitThreads: couldn't start thread %i", i);
+    }
+
+    // Queued draws point into purgable lumps and composites,
+    //  they have to be drawn before the zone throws those out.
+    zonepurgehook = R_FlushDraws;
+    
+    printf ("\nR_InitThreads: %i strips", numrthreads);
+}
+
+
+//
+// R_SetupStrips
+//
+void R_SetupStrips (void)
+{
+    R_FlushDraws ();
+    stripwidth = (viewwidth + numrthreads - 1) / numrthreads;
+}
+
+
+
+//
+// R_NewDrawCmd
+//
+static drawcmd_t* R_NewDrawCmd (int x)
+{
+    strip_t*	strip;
+
+    strip = &strips[x / stripwidth];
+
+    if (strip->numcmds == strip->maxcmds)
+    {
+	strip->maxcmds = strip->maxcmds ? strip->maxcmds*2 : 1024;
+	strip->cmds = realloc (strip->cmds,
+			       strip->maxcmds*sizeof(*strip->cmds));
+	if (!strip->cmds)
+	    I_Error ("R_NewDrawCmd: couldn't realloc %i draws",
+		     strip->maxcmds);
+    }
+    queuedcmds++;
+    
+    return &strip->cmds[strip->numcmds++];
+}
+
+
+static void R_QueueColumn (void (*drawer) (void))
+{
+    drawcmd_t*	cmd;
+
+    cmd = R_NewDrawCmd (dc_x);
+    cmd->drawer = drawer;
+    cmd->colormap = dc_colormap;
+    cmd->source = dc_source;
+    cmd->translation = dc_translation;
+    cmd->frac = dc_texturemid;
+    cmd->step = dc_iscale;
+    cmd->x1 = dc_x;
+    cmd->y1 = dc_yl;
+    cmd->y2 = dc_yh;
+    cmd->fuzzpos = fuzzpos;
+}
+
+
+void R_DeferColumn (void)
+{
+    // Zero length, nothing would be drawn.
+    if (dc_yh < dc_yl)
+	return;
+    R_QueueColumn (R_DrawColumn);
+}
+
+
+void R_DeferColumnTransposed (void)
+{
+    if (dc_yh < dc_yl)
+	return;
+    R_QueueColumn (R_DrawColumnTransposed);
+}
+
+
+void R_DeferTranslatedColumn (void)
+{
+    if (dc_yh < dc_yl)
+	return;
+    R_QueueColumn (R_DrawTranslatedColumn);
+}
+
+
+//
+// R_DeferFuzzColumn
+// The fuzz table position runs on across columns,
+//  so it is advanced here as the drawer would do.
+//
+void R_DeferFuzzColumn (void)
+{
+    int		yl;
+    int		yh;
+
+    yl = dc_yl ? dc_yl : 1;
+    yh = dc_yh == viewheight-1 ? viewheight-2 : dc_yh;
+    if (yh < yl)
+	return;
+
+    R_QueueColumn (R_DrawFuzzColumn);
+    fuzzpos = (fuzzpos + yh - yl + 1) % FUZZTABLE;
+}
+
+
+//
+// R_DeferSpan
+// Cuts the span at the strip edges.
+//
+void R_DeferSpan (void)
+{
+    drawcmd_t*	cmd;
+    int		x1;
+    int		x2;
+    unsigned	skip;
+
+    for (x1 = ds_x1 ; ; x1 = x2+1)
+    {
+	x2 = (x1/stripwidth + 1)*stripwidth - 1;
+	if (x2 > ds_x2 || ds_x2 < ds_x1)
+	    x2 = ds_x2;
+	
+	skip = x1 - ds_x1;
+	
+	cmd = R_NewDrawCmd (x1);
+	cmd->drawer = R_DrawSpan;
+	cmd->colormap = ds_colormap;
+	cmd->source = ds_source;
+	cmd->frac = ds_xfrac + skip*ds_xstep;
+	cmd->yfrac = ds_yfrac + skip*ds_ystep;
+	cmd->step = ds_xstep;
+	cmd->ystep = ds_ystep;
+	cmd->x1 = x1;
+	cmd->x2 = x2;
+	cmd->y1 = ds_y;
+
+	if (x2 == ds_x2)
+	    break;
+    }
+}
+
+
+
+//
+// R_DeferTranspose
+// Each strip copies its own walls into the view
+//  once they are drawn, ahead of the spans after them.
+//
+void R_DeferTranspose (void)
+{
+    drawcmd_t*	cmd;
+    int		x1;
+    int		x2;
+
+    for (x1 = 0 ; x1 < viewwidth ; x1 += stripwidth)
+    {
+	x2 = x1 + stripwidth - 1;
+	if (x2 >= viewwidth)
+	    x2 = viewwidth - 1;
+
+	cmd = R_NewDrawCmd (x1);
+	cmd->drawer = R_RunTranspose;
+	cmd->x1 = x1;
+	cmd->x2 = x2;
+    }
+}
+
+
+
+//
+// R_FlushDraws
+//
+void R_FlushDraws (void)
+{
+    int		i;
+    
+    if (!queuedcmds)
+	return;
+
+    pthread_mutex_lock (&drawlock);
+    pendingstrips = numrthreads;
+    drawgeneration++;
+    pthread_cond_broadcast (&drawstart);
+    while (pendingstrips)
+	pthread_cond_wait (&drawdone, &drawlock);
+    pthread_mutex_unlock (&drawlock);
+
+    for (i=0 ; i<numrthreads ; i++)
+	strips[i].numcmds = 0;
+    queuedcmds = 0;
+}
@@ -0,0 +1,64 @@
+// Emacs style mode select   -*- C++ -*- 
+//-----------------------------------------------------------------------------
+//
+// $Id:$
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Parallel column/span drawing in vertical strips.
+//
+//-----------------------------------------------------------------------------
+
+
+#ifndef __R_THREAD__
+#define __R_THREAD__
+
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+
+// Number of strips/threads, 1 if drawing directly.
+extern int		numrthreads;
+
+
+// Reads -rthreads, starts the workers.
+void R_InitThreads (void);
+
+// Splits the current view into strips,
+//  called on every view size change.
+void R_SetupStrips (void);
+
+// Stand-ins for the drawers,
+//  they queue the current dc_* / ds_* state.
+void R_DeferColumn (void);
+void R_DeferColumnTransposed (void);
+void R_DeferFuzzColumn (void);
+void R_DeferTranslatedColumn (void);
+void R_DeferSpan (void);
+
+// Queues R_TransposeColumns for every strip.
+void R_DeferTranspose (void);
+
+// Runs all queued draws, one worker per strip,
+//  and returns when all strips are done.
+void R_FlushDraws (void);
+
+
+#endif
+//-----------------------------------------------------------------------------
+//
+// $Log:$
+//
+//-----------------------------------------------------------------------------
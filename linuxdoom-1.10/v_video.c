@@ -28,6 +28,8 @@ static const char
 rcsid[] = "$Id: v_video.c,v 1.5 1997/02/03 22:45:13 b1 Exp $";
 
 
+#include <stdlib.h>
+
 #include "i_system.h"
 #include "r_local.h"
 
@@ -36,10 +38,14 @@ rcsid[] = "$Id: v_video.c,v 1.5 1997/02/03 22:45:13 b1 Exp $";
 
 #include "m_bbox.h"
 #include "m_swap.h"
+#include "m_argv.h"
 
 #include "v_video.h"
 
 
+int				SCREENWIDTH = ORIGWIDTH;
+int				SCREENHEIGHT = ORIGHEIGHT;
+
 // Each screen is [SCREENWIDTH*SCREENHEIGHT]; 
 byte*				screens[5];	
  
@@ -153,6 +159,7 @@ V_MarkRect
 
 //
 // V_CopyRect 
+// The rectangle is in 2D coordinates.
 // 
 void
 V_CopyRect
@@ -167,15 +174,19 @@ V_CopyRect
 { 
     byte*	src;
     byte*	dest; 
+    int		sx;
+    int		sy;
+    int		dx;
+    int		dy;
 	 
 #ifdef RANGECHECK 
     if (srcx<0
-	||srcx+width >SCREENWIDTH
+	||srcx+width >ORIGWIDTH
 	|| srcy<0
-	|| srcy+height>SCREENHEIGHT 
-	||destx<0||destx+width >SCREENWIDTH
+	|| srcy+height>ORIGHEIGHT 
+	||destx<0||destx+width >ORIGWIDTH
 	|| desty<0
-	|| desty+height>SCREENHEIGHT 
+	|| desty+height>ORIGHEIGHT 
 	|| (unsigned)srcscrn>4
 	|| (unsigned)destscrn>4)
     {
@@ -183,9 +194,22 @@ V_CopyRect
     }
 #endif 
     V_MarkRect (destx, desty, width, height); 
+
+    sx = V_ScaleX (srcx);
+    sy = V_ScaleY (srcy);
+    dx = V_ScaleX (destx);
+    dy = V_ScaleY (desty);
+
+    // the two may round differently at the edges
+    width = V_ScaleX (destx+width) - dx;
+    height = V_ScaleY (desty+height) - dy;
+    if (sx+width > SCREENWIDTH)
+	width = SCREENWIDTH - sx;
+    if (sy+height > SCREENHEIGHT)
+	height = SCREENHEIGHT - sy;
 	 
-    src = screens[srcscrn]+SCREENWIDTH*srcy+srcx; 
-    dest = screens[destscrn]+SCREENWIDTH*desty+destx; 
+    src = screens[srcscrn]+SCREENWIDTH*sy+sx; 
+    dest = screens[destscrn]+SCREENWIDTH*dy+dx; 
 
     for ( ; height>0 ; height--) 
     { 
@@ -197,32 +221,94 @@ V_CopyRect
  
 
 //
-// V_DrawPatch
-// Masks a column based masked pic to the screen. 
+// V_DrawPatchColumns
+// Every screen column and row is drawn from the patch
+//  pixel its 2D position falls in, so patches drawn
+//  side by side meet at any scale.
 //
-void
-V_DrawPatch
+static void
+V_DrawPatchColumns
 ( int		x,
   int		y,
   int		scrn,
-  patch_t*	patch ) 
+  patch_t*	patch,
+  boolean	flipped ) 
 { 
-
-    int		count;
+    int		w; 
     int		col; 
+    int		row;
+    int		frac;
+    int		dx;
+    int		dxend;
+    int		dy;
+    int		dyend;
     column_t*	column; 
     byte*	desttop;
     byte*	dest;
     byte*	source; 
-    int		w; 
 	 
+    w = SHORT(patch->width); 
+    dxend = V_ScaleX (x+w);
+
+    for (dx = V_ScaleX (x) ; dx<dxend ; dx++)
+    { 
+	col = dx*ORIGWIDTH/SCREENWIDTH - x;
+	if (flipped)
+	    col = w-1-col;
+	
+	column = (column_t *)((byte *)patch + LONG(patch->columnofs[col])); 
+	desttop = screens[scrn] + dx;
+ 
+	// step through the posts in a column 
+	while (column->topdelta != 0xff ) 
+	{ 
+	    source = (byte *)column + 3; 
+	    dy = V_ScaleY (y + column->topdelta);
+	    dyend = V_ScaleY (y + column->topdelta + column->length);
+	    dest = desttop + dy*SCREENWIDTH; 
+
+	    // stepping through the rows without a divide,
+	    //  frac is how far into its post row dy is
+	    row = 0;
+	    frac = dy*ORIGHEIGHT % SCREENHEIGHT;
+	    
+	    for ( ; dy<dyend ; dy++) 
+	    { 
+		*dest = source[row]; 
+		dest += SCREENWIDTH; 
+		
+		frac += ORIGHEIGHT;
+		if (frac >= SCREENHEIGHT)
+		{
+		    frac -= SCREENHEIGHT;
+		    row++;
+		}
+	    } 
+	    column = (column_t *)(  (byte *)column + column->length 
+				    + 4 ); 
+	} 
+    }			 
+} 
+
+
+//
+// V_DrawPatch
+// Masks a column based masked pic to the screen. 
+//
+void
+V_DrawPatch
+( int		x,
+  int		y,
+  int		scrn,
+  patch_t*	patch ) 
+{ 
     y -= SHORT(patch->topoffset); 
     x -= SHORT(patch->leftoffset); 
 #ifdef RANGECHECK 
     if (x<0
-	||x+SHORT(patch->width) >SCREENWIDTH
+	||x+SHORT(patch->width) >ORIGWIDTH
 	|| y<0
-	|| y+SHORT(patch->height)>SCREENHEIGHT 
+	|| y+SHORT(patch->height)>ORIGHEIGHT 
 	|| (unsigned)scrn>4)
     {
       fprintf( stderr, "Patch at %d,%d exceeds LFB\n", x,y );
@@ -235,31 +321,7 @@ V_DrawPatch
     if (!scrn)
 	V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height)); 
 
-    col = 0; 
-    desttop = screens[scrn]+y*SCREENWIDTH+x; 
-	 
-    w = SHORT(patch->width); 
-
-    for ( ; col<w ; x++, col++, desttop++)
-    { 
-	column = (column_t *)((byte *)patch + LONG(patch->columnofs[col])); 
- 
-	// step through the posts in a column 
-	while (column->topdelta != 0xff ) 
-	{ 
-	    source = (byte *)column + 3; 
-	    dest = desttop + column->topdelta*SCREENWIDTH; 
-	    count = column->length; 
-			 
-	    while (count--) 
-	    { 
-		*dest = *source++; 
-		dest += SCREENWIDTH; 
-	    } 
-	    column = (column_t *)(  (byte *)column + column->length 
-				    + 4 ); 
-	} 
-    }			 
+    V_DrawPatchColumns (x, y, scrn, patch, false);
 } 
  
 //
@@ -274,22 +336,13 @@ V_DrawPatchFlipped
   int		scrn,
   patch_t*	patch ) 
 { 
-
-    int		count;
-    int		col; 
-    column_t*	column; 
-    byte*	desttop;
-    byte*	dest;
-    byte*	source; 
-    int		w; 
-	 
     y -= SHORT(patch->topoffset); 
     x -= SHORT(patch->leftoffset); 
 #ifdef RANGECHECK 
     if (x<0
-	||x+SHORT(patch->width) >SCREENWIDTH
+	||x+SHORT(patch->width) >ORIGWIDTH
 	|| y<0
-	|| y+SHORT(patch->height)>SCREENHEIGHT 
+	|| y+SHORT(patch->height)>ORIGHEIGHT 
 	|| (unsigned)scrn>4)
     {
       fprintf( stderr, "Patch origin %d,%d exceeds LFB\n", x,y );
@@ -300,31 +353,7 @@ V_DrawPatchFlipped
     if (!scrn)
 	V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height)); 
 
-    col = 0; 
-    desttop = screens[scrn]+y*SCREENWIDTH+x; 
-	 
-    w = SHORT(patch->width); 
-
-    for ( ; col<w ; x++, col++, desttop++) 
-    { 
-	column = (column_t *)((byte *)patch + LONG(patch->columnofs[w-1-col])); 
- 
-	// step through the posts in a column 
-	while (column->topdelta != 0xff ) 
-	{ 
-	    source = (byte *)column + 3; 
-	    dest = desttop + column->topdelta*SCREENWIDTH; 
-	    count = column->length; 
-			 
-	    while (count--) 
-	    { 
-		*dest = *source++; 
-		dest += SCREENWIDTH; 
-	    } 
-	    column = (column_t *)(  (byte *)column + column->length 
-				    + 4 ); 
-	} 
-    }			 
+    V_DrawPatchColumns (x, y, scrn, patch, true);
 } 
  
 
@@ -397,9 +426,51 @@ V_DrawPatchDirect
  
 
 
+//
+// V_TileFlat
+// Fills the 2D rows above height with a 64x64 flat,
+//  stretched with the rest of the 2D screen.
+//
+void
+V_TileFlat
+( byte*		src,
+  int		scrn,
+  int		height )
+{
+    byte*	dest;
+    byte*	row;
+    int		x;
+    int		y;
+    int		bottom;
+
+    bottom = V_ScaleY (height);
+    dest = screens[scrn];
+
+    for (y=0 ; y<bottom ; y++)
+    {
+	row = src + (((y*ORIGHEIGHT/SCREENHEIGHT)&63)<<6);
+
+	if (SCREENWIDTH == ORIGWIDTH)
+	{
+	    for (x=0 ; x<SCREENWIDTH ; x++)
+		*dest++ = row[x&63];
+	}
+	else
+	{
+	    for (x=0 ; x<SCREENWIDTH ; x++)
+		*dest++ = row[(x*ORIGWIDTH/SCREENWIDTH)&63];
+	}
+    }
+    
+    V_MarkRect (0, 0, ORIGWIDTH, height);
+}
+
+
+
 //
 // V_DrawBlock
 // Draw a linear block of pixels into the view buffer.
+// Unlike the 2D calls above, in screen pixels.
 //
 void
 V_DrawBlock
@@ -439,7 +510,8 @@ V_DrawBlock
 
 //
 // V_GetBlock
-// Gets a linear block of pixels from the view buffer.
+// Gets a linear block of pixels from the view buffer,
+//  in screen pixels.
 //
 void
 V_GetBlock
@@ -482,7 +554,26 @@ V_GetBlock
 void V_Init (void) 
 { 
     int		i;
+    int		p;
     byte*	base;
+
+    p = M_CheckParm ("-width");
+    if (p && p < myargc-1)
+	SCREENWIDTH = atoi (myargv[p+1]);
+    
+    p = M_CheckParm ("-height");
+    if (p && p < myargc-1)
+	SCREENHEIGHT = atoi (myargv[p+1]);
+
+    if (SCREENWIDTH < ORIGWIDTH || SCREENWIDTH > MAXSCREENWIDTH
+	|| SCREENHEIGHT < ORIGHEIGHT || SCREENHEIGHT > MAXSCREENHEIGHT)
+	I_Error ("V_Init: screen size %ix%i outside %ix%i to %ix%i",
+		 SCREENWIDTH, SCREENHEIGHT, ORIGWIDTH, ORIGHEIGHT,
+		 MAXSCREENWIDTH, MAXSCREENHEIGHT);
+
+    // The wipe moves column pairs.
+    if (SCREENWIDTH & 1)
+	I_Error ("V_Init: screen width %i is odd", SCREENWIDTH);
 		
     // stick these in low dos memory on PCs
 
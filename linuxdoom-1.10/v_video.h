@@ -38,6 +38,12 @@
 
 #define CENTERY			(SCREENHEIGHT/2)
 
+// First screen pixel of a 2D coordinate.
+// 2D graphics are positioned on the ORIGWIDTH x ORIGHEIGHT
+//  screen, and stretched to fill the real one.
+#define V_ScaleX(x)	(((x)*SCREENWIDTH + ORIGWIDTH-1) / ORIGWIDTH)
+#define V_ScaleY(y)	(((y)*SCREENHEIGHT + ORIGHEIGHT-1) / ORIGHEIGHT)
+
 
 // Screen 0 is the screen updated by I_Update screen.
 // Screen 1 is an extra buffer.
@@ -82,6 +88,13 @@ V_DrawPatchDirect
   int		scrn,
   patch_t*	patch );
 
+// Tiles a flat over the 2D rows above height.
+void
+V_TileFlat
+( byte*		src,
+  int		scrn,
+  int		height );
+
 
 // Draw a linear block of pixels into the view buffer.
 void
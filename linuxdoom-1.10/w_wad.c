@@ -34,6 +34,7 @@ rcsid[] = "$Id: w_wad.c,v 1.5 1997/02/03 16:47:57 b1 Exp $";
 #include <malloc.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <alloca.h>
 #define O_BINARY		0
 #endif
@@ -42,6 +43,7 @@ rcsid[] = "$Id: w_wad.c,v 1.5 1997/02/03 16:47:57 b1 Exp $";
 #include "m_swap.h"
 #include "i_system.h"
 #include "z_zone.h"
+#include "m_argv.h"
 
 #ifdef __GNUG__
 #pragma implementation "w_wad.h"
@@ -63,6 +65,23 @@ int			numlumps;
 
 void**			lumpcache;
 
+// Name hash chains, heads index lumpinfo.
+// Later lumps are linked in front,
+//  so the first match still overrides.
+int*			lumphash;
+int			numlumphash;
+
+// WAD files are mapped read only, unless -nommap.
+// Purgable lumps are then never copied to the zone.
+boolean			usemmap;
+
+// Patches etc. are read as shorts and ints in place.
+#if defined(__i386__) || defined(__x86_64__)
+#define MAPALIGN	1
+#else
+#define MAPALIGN	4
+#endif
+
 
 #define strcmpi	strcasecmp
 
@@ -149,6 +168,8 @@ void W_AddFile (char *filename)
     filelump_t*		fileinfo;
     filelump_t		singleinfo;
     int			storehandle;
+    int			filesize;
+    byte*		mapbase;
     
     // open the file and add to directory
 
@@ -212,6 +233,18 @@ void W_AddFile (char *filename)
     lump_p = &lumpinfo[startlump];
 	
     storehandle = reloadname ? -1 : handle;
+
+    // Reloadable files change on disk, never map those.
+    // The mapping outlives the handle, and stays until exit.
+    mapbase = NULL;
+    filesize = filelength (handle);
+    
+    if (usemmap && !reloadname && filesize)
+    {
+	mapbase = mmap (NULL, filesize, PROT_READ, MAP_SHARED, handle, 0);
+	if (mapbase == MAP_FAILED)
+	    mapbase = NULL;
+    }
 	
     for (i=startlump ; i<numlumps ; i++,lump_p++, fileinfo++)
     {
@@ -219,6 +252,15 @@ void W_AddFile (char *filename)
 	lump_p->position = LONG(fileinfo->filepos);
 	lump_p->size = LONG(fileinfo->size);
 	strncpy (lump_p->name, fileinfo->name, 8);
+
+	lump_p->data = NULL;
+	if (mapbase
+	    && lump_p->position >= 0
+	    && lump_p->size >= 0
+	    && lump_p->position <= filesize - lump_p->size)
+	{
+	    lump_p->data = mapbase + lump_p->position;
+	}
     }
 	
     if (reloadname)
@@ -276,6 +318,57 @@ void W_Reload (void)
 
 
 
+//
+// W_LumpNameHash
+// Over all eight bytes, so case must be folded
+//  by the caller like for the compare.
+//
+static unsigned W_LumpNameHash (char* name)
+{
+    unsigned	hash;
+    int		i;
+
+    hash = 0;
+    for (i=0 ; i<8 ; i++)
+	hash = hash*31 + (byte)name[i];
+
+    return hash;
+}
+
+
+//
+// W_HashLumps
+// Builds the chains once all files are in.
+//
+static void W_HashLumps (void)
+{
+    int		i;
+    unsigned	h;
+
+    // power of two, at least numlumps
+    for (numlumphash = 1 ; numlumphash < numlumps ; numlumphash <<= 1)
+	;
+
+    free (lumphash);
+    lumphash = malloc (numlumphash*sizeof(*lumphash));
+
+    if (!lumphash)
+	I_Error ("Couldn't allocate lumphash");
+    
+    for (i=0 ; i<numlumphash ; i++)
+	lumphash[i] = -1;
+
+    // in order, so later files end up in front
+    for (i=0 ; i<numlumps ; i++)
+    {
+	h = W_LumpNameHash (lumpinfo[i].name) & (numlumphash-1);
+	lumpinfo[i].next = lumphash[h];
+	lumphash[h] = i;
+    }
+}
+
+
+
 //
 // W_InitMultipleFiles
 // Pass a null terminated list of files to use.
@@ -293,6 +386,8 @@ void W_InitMultipleFiles (char** filenames)
 {	
     int		size;
     
+    usemmap = !M_CheckParm ("-nommap");
+    
     // open all the files, load headers, and count lumps
     numlumps = 0;
 
@@ -313,6 +408,8 @@ void W_InitMultipleFiles (char** filenames)
 	I_Error ("Couldn't allocate lumpcache");
 
     memset (lumpcache,0, size);
+
+    W_HashLumps ();
 }
 
 
@@ -358,6 +455,7 @@ int W_CheckNumForName (char* name)
     
     int		v1;
     int		v2;
+    int		i;
     lumpinfo_t*	lump_p;
 
     // make the name into two integers for easy compares
@@ -372,6 +470,22 @@ int W_CheckNumForName (char* name)
     v1 = name8.x[0];
     v2 = name8.x[1];
 
+    if (lumphash)
+    {
+	// hash chains are in reverse lump order
+	i = lumphash[W_LumpNameHash (name8.s) & (numlumphash-1)];
+
+	for ( ; i != -1 ; i = lump_p->next)
+	{
+	    lump_p = lumpinfo + i;
+	    if ( *(int *)lump_p->name == v1
+		 && *(int *)&lump_p->name[4] == v2)
+	    {
+		return i;
+	    }
+	}
+	return -1;
+    }
 
     // scan backwards so patch lump files take precedence
     lump_p = lumpinfo + numlumps;
@@ -441,6 +555,12 @@ W_ReadLump
 	I_Error ("W_ReadLump: %i >= numlumps",lump);
 
     l = lumpinfo+lump;
+
+    if (l->data)
+    {
+	memcpy (dest, l->data, l->size);
+	return;
+    }
 	
     // ??? I_BeginRead ();
 	
@@ -481,6 +601,15 @@ W_CacheLumpNum
 
     if ((unsigned)lump >= numlumps)
 	I_Error ("W_CacheLumpNum: %i >= numlumps",lump);
+
+    // Purgable lumps are only looked at, never changed
+    //  or freed, so the mapped file can be used as is.
+    if (tag >= PU_PURGELEVEL
+	&& lumpinfo[lump].data
+	&& !((long)lumpinfo[lump].data & (MAPALIGN-1)))
+    {
+	return lumpinfo[lump].data;
+    }
 		
     if (!lumpcache[lump])
     {
@@ -501,6 +630,45 @@ W_CacheLumpNum
 
 
 
+//
+// W_LockLumpNum
+// Returns the lump at an address that stays valid
+//  until W_UnlockLumpNum, as no purge can move it.
+// Mapped lumps are used in place, others are
+//  cached PU_STATIC and dropped back to PU_CACHE.
+//
+void* W_LockLumpNum (int lump)
+{
+    if ((unsigned)lump >= numlumps)
+	I_Error ("W_LockLumpNum: %i >= numlumps",lump);
+
+    if (lumpinfo[lump].data
+	&& !((long)lumpinfo[lump].data & (MAPALIGN-1)))
+    {
+	return lumpinfo[lump].data;
+    }
+
+    return W_CacheLumpNum (lump, PU_STATIC);
+}
+
+
+//
+// W_UnlockLumpNum
+//
+void W_UnlockLumpNum (int lump)
+{
+    if (lumpinfo[lump].data
+	&& !((long)lumpinfo[lump].data & (MAPALIGN-1)))
+    {
+	return;
+    }
+
+    if (lumpcache[lump])
+	Z_ChangeTag (lumpcache[lump], PU_CACHE);
+}
+
+
+
 //
 // W_CacheLumpName
 //
@@ -28,6 +28,8 @@
 #pragma interface
 #endif
 
+#include "doomtype.h"
+
 
 //
 // TYPES
@@ -59,6 +61,12 @@ typedef struct
     int		handle;
     int		position;
     int		size;
+
+    // next lump in the same name hash chain, -1 ends
+    int		next;
+
+    // straight into the mapped file, NULL if read
+    byte*	data;
 } lumpinfo_t;
 
 
@@ -78,6 +86,10 @@ void    W_ReadLump (int lump, void *dest);
 void*	W_CacheLumpNum (int lump, int tag);
 void*	W_CacheLumpName (char* name, int tag);
 
+// Keeps a lump at one address for other threads to read.
+void*	W_LockLumpNum (int lump);
+void	W_UnlockLumpNum (int lump);
+
 
 
 
@@ -85,7 +85,7 @@ rcsid[] = "$Id: wi_stuff.c,v 1.7 1997/02/03 22:45:13 b1 Exp $";
 #define SP_STATSY		50
 
 #define SP_TIMEX		16
-#define SP_TIMEY		(SCREENHEIGHT-32)
+#define SP_TIMEY		(ORIGHEIGHT-32)
 
 
 // NET GAME STUFF
@@ -94,6 +94,9 @@ rcsid[] = "$Id: wi_stuff.c,v 1.7 1997/02/03 22:45:13 b1 Exp $";
 
 #define NG_SPACINGX    		64
 
+// rows close up to this for more players
+#define NG_MINSPACINGY		12
+
 
 // DEATHMATCH STUFF
 #define DM_MATRIXX		42
@@ -306,6 +309,11 @@ static int		acceleratestage;
 // wbs->pnum
 static int		me;
 
+// the frag matrix has room for ORIGPLAYERS only,
+//  deathmatches with more slots show the net game
+//  stats and their frags column
+static boolean		dmmatrix;
+
  // specifies current state
 static stateenum_t	state;
 
@@ -323,9 +331,9 @@ static int 		bcnt;
 // signals to refresh everything for one frame
 static int 		firstrefresh; 
 
-static int		cnt_kills[MAXPLAYERS];
-static int		cnt_items[MAXPLAYERS];
-static int		cnt_secret[MAXPLAYERS];
+static int		cnt_kills[MAXNETPLAYERS];
+static int		cnt_items[MAXNETPLAYERS];
+static int		cnt_secret[MAXNETPLAYERS];
 static int		cnt_time;
 static int		cnt_par;
 static int		cnt_pause;
@@ -386,11 +394,11 @@ static patch_t*		total;
 static patch_t*		star;
 static patch_t*		bstar;
 
-// "red P[1..MAXPLAYERS]"
-static patch_t*		p[MAXPLAYERS];
+// "red P[1..ORIGPLAYERS]"
+static patch_t*		p[ORIGPLAYERS];
 
-// "gray P[1..MAXPLAYERS]"
-static patch_t*		bp[MAXPLAYERS];
+// "gray P[1..ORIGPLAYERS]"
+static patch_t*		bp[ORIGPLAYERS];
 
  // Name graphics of each level (centered)
 static patch_t**	lnames;
@@ -406,7 +414,7 @@ static patch_t**	lnames;
 void WI_slamBackground(void)
 {
     memcpy(screens[0], screens[1], SCREENWIDTH * SCREENHEIGHT);
-    V_MarkRect (0, 0, SCREENWIDTH, SCREENHEIGHT);
+    V_MarkRect (0, 0, ORIGWIDTH, ORIGHEIGHT);
 }
 
 // The ticker is used to detect keys
@@ -423,13 +431,13 @@ void WI_drawLF(void)
     int y = WI_TITLEY;
 
     // draw <LevelName> 
-    V_DrawPatch((SCREENWIDTH - SHORT(lnames[wbs->last]->width))/2,
+    V_DrawPatch((ORIGWIDTH - SHORT(lnames[wbs->last]->width))/2,
 		y, FB, lnames[wbs->last]);
 
     // draw "Finished!"
     y += (5*SHORT(lnames[wbs->last]->height))/4;
     
-    V_DrawPatch((SCREENWIDTH - SHORT(finished->width))/2,
+    V_DrawPatch((ORIGWIDTH - SHORT(finished->width))/2,
 		y, FB, finished);
 }
 
@@ -441,13 +449,13 @@ void WI_drawEL(void)
     int y = WI_TITLEY;
 
     // draw "Entering"
-    V_DrawPatch((SCREENWIDTH - SHORT(entering->width))/2,
+    V_DrawPatch((ORIGWIDTH - SHORT(entering->width))/2,
 		y, FB, entering);
 
     // draw level
     y += (5*SHORT(lnames[wbs->next]->height))/4;
 
-    V_DrawPatch((SCREENWIDTH - SHORT(lnames[wbs->next]->width))/2,
+    V_DrawPatch((ORIGWIDTH - SHORT(lnames[wbs->next]->width))/2,
 		y, FB, lnames[wbs->next]);
 
 }
@@ -474,9 +482,9 @@ WI_drawOnLnode
 	bottom = top + SHORT(c[i]->height);
 
 	if (left >= 0
-	    && right < SCREENWIDTH
+	    && right < ORIGWIDTH
 	    && top >= 0
-	    && bottom < SCREENHEIGHT)
+	    && bottom < ORIGHEIGHT)
 	{
 	    fits = true;
 	}
@@ -841,8 +849,8 @@ int WI_fragSum(int playernum)
 
 
 static int		dm_state;
-static int		dm_frags[MAXPLAYERS][MAXPLAYERS];
-static int		dm_totals[MAXPLAYERS];
+static int		dm_frags[ORIGPLAYERS][ORIGPLAYERS];
+static int		dm_totals[ORIGPLAYERS];
 
 
 
@@ -1071,7 +1079,7 @@ void WI_drawDeathmatchStats(void)
     }
 }
 
-static int	cnt_frags[MAXPLAYERS];
+static int	cnt_frags[MAXNETPLAYERS];
 static int	dofrags;
 static int	ng_state;
 
@@ -1263,6 +1271,9 @@ void WI_drawNetgameStats(void)
     int		i;
     int		x;
     int		y;
+    int		lh;	// line height
+    int		row;
+    int		numrows;
     int		pwidth = SHORT(percent->width);
 
     WI_slamBackground();
@@ -1289,16 +1300,32 @@ void WI_drawNetgameStats(void)
     // draw stats
     y = NG_STATSY + SHORT(kills->height);
 
+    // close up the rows for more players,
+    //  the last one is kept for you
+    numrows = 0;
     for (i=0 ; i<MAXPLAYERS ; i++)
+	numrows += playeringame[i];
+    lh = WI_SPACINGY;
+    if (numrows*lh > ORIGHEIGHT-y)
+	lh = (ORIGHEIGHT-y)/numrows;
+    if (lh < NG_MINSPACINGY)
+	lh = NG_MINSPACINGY;
+    numrows = (ORIGHEIGHT-y)/lh;
+    row = 0;
+
+    for (i=0 ; i<MAXPLAYERS && row<numrows ; i++)
     {
 	if (!playeringame[i])
 	    continue;
+	if (row == numrows-1 && i < me)
+	    continue;
+	row++;
 
 	x = NG_STATSX;
-	V_DrawPatch(x-SHORT(p[i]->width), y, FB, p[i]);
+	V_DrawPatch(x-SHORT(p[i%ORIGPLAYERS]->width), y, FB, p[i%ORIGPLAYERS]);
 
 	if (i == me)
-	    V_DrawPatch(x-SHORT(p[i]->width), y, FB, star);
+	    V_DrawPatch(x-SHORT(p[i%ORIGPLAYERS]->width), y, FB, star);
 
 	x += NG_SPACINGX;
 	WI_drawPercent(x-pwidth, y+10, cnt_kills[i]);	x += NG_SPACINGX;
@@ -1308,7 +1335,7 @@ void WI_drawNetgameStats(void)
 	if (dofrags)
 	    WI_drawNum(x, y+10, cnt_frags[i], -1);
 
-	y += WI_SPACINGY;
+	y += lh;
     }
 
 }
@@ -1448,21 +1475,21 @@ void WI_drawStats(void)
     WI_drawLF();
 
     V_DrawPatch(SP_STATSX, SP_STATSY, FB, kills);
-    WI_drawPercent(SCREENWIDTH - SP_STATSX, SP_STATSY, cnt_kills[0]);
+    WI_drawPercent(ORIGWIDTH - SP_STATSX, SP_STATSY, cnt_kills[0]);
 
     V_DrawPatch(SP_STATSX, SP_STATSY+lh, FB, items);
-    WI_drawPercent(SCREENWIDTH - SP_STATSX, SP_STATSY+lh, cnt_items[0]);
+    WI_drawPercent(ORIGWIDTH - SP_STATSX, SP_STATSY+lh, cnt_items[0]);
 
     V_DrawPatch(SP_STATSX, SP_STATSY+2*lh, FB, sp_secret);
-    WI_drawPercent(SCREENWIDTH - SP_STATSX, SP_STATSY+2*lh, cnt_secret[0]);
+    WI_drawPercent(ORIGWIDTH - SP_STATSX, SP_STATSY+2*lh, cnt_secret[0]);
 
     V_DrawPatch(SP_TIMEX, SP_TIMEY, FB, time);
-    WI_drawTime(SCREENWIDTH/2 - SP_TIMEX, SP_TIMEY, cnt_time);
+    WI_drawTime(ORIGWIDTH/2 - SP_TIMEX, SP_TIMEY, cnt_time);
 
     if (wbs->epsd < 3)
     {
-	V_DrawPatch(SCREENWIDTH/2 + SP_TIMEX, SP_TIMEY, FB, par);
-	WI_drawTime(SCREENWIDTH - SP_TIMEX, SP_TIMEY, cnt_par);
+	V_DrawPatch(ORIGWIDTH/2 + SP_TIMEX, SP_TIMEY, FB, par);
+	WI_drawTime(ORIGWIDTH - SP_TIMEX, SP_TIMEY, cnt_par);
     }
 
 }
@@ -1519,7 +1546,7 @@ void WI_Ticker(void)
     switch (state)
     {
       case StatCount:
-	if (deathmatch) WI_updateDeathmatchStats();
+	if (dmmatrix) WI_updateDeathmatchStats();
 	else if (netgame) WI_updateNetgameStats();
 	else WI_updateStats();
 	break;
@@ -1692,7 +1719,7 @@ void WI_loadData(void)
     // dead face
     bstar = W_CacheLumpName("STFDEAD0", PU_STATIC);    
 
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    for (i=0 ; i<ORIGPLAYERS ; i++)
     {
 	// "1,2,3,4"
 	sprintf(name, "STPB%d", i);      
@@ -1762,10 +1789,10 @@ void WI_unloadData(void)
     //  Z_ChangeTag(star, PU_CACHE);
     //  Z_ChangeTag(bstar, PU_CACHE);
     
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    for (i=0 ; i<ORIGPLAYERS ; i++)
 	Z_ChangeTag(p[i], PU_CACHE);
 
-    for (i=0 ; i<MAXPLAYERS ; i++)
+    for (i=0 ; i<ORIGPLAYERS ; i++)
 	Z_ChangeTag(bp[i], PU_CACHE);
 }
 
@@ -1774,7 +1801,7 @@ void WI_Drawer (void)
     switch (state)
     {
       case StatCount:
-	if (deathmatch)
+	if (dmmatrix)
 	    WI_drawDeathmatchStats();
 	else if (netgame)
 	    WI_drawNetgameStats();
@@ -1841,7 +1868,8 @@ void WI_Start(wbstartstruct_t* wbstartstruct)
     WI_initVariables(wbstartstruct);
     WI_loadData();
 
-    if (deathmatch)
+    dmmatrix = deathmatch && MAXPLAYERS == ORIGPLAYERS;
+    if (dmmatrix)
 	WI_initDeathmatchStats();
     else if (netgame)
 	WI_initNetgameStats();
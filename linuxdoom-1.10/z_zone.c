@@ -24,8 +24,12 @@
 static const char
 rcsid[] = "$Id: z_zone.c,v 1.4 1997/02/03 16:47:58 b1 Exp $";
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "z_zone.h"
 #include "i_system.h"
+#include "m_argv.h"
 #include "doomdef.h"
 
 
@@ -43,7 +47,7 @@ rcsid[] = "$Id: z_zone.c,v 1.4 1997/02/03 16:47:58 b1 Exp $";
 #define ZONEID	0x1d4a11
 
 
-typedef struct
+typedef struct memzone_s
 {
     // total bytes malloced, including header
     int		size;
@@ -52,13 +56,91 @@ typedef struct
     memblock_t	blocklist;
     
     memblock_t*	rover;
+
+    // next arena
+    struct memzone_s*	next;
     
 } memzone_t;
 
 
+// Arenas added when the zone runs out,
+//  at least this big.
+#define ARENASIZE		(2*1024*1024)
 
+
+// The first arena, from I_ZoneBase, never goes away.
 memzone_t*	mainzone;
 
+// Arena the last allocation came from, tried first.
+static memzone_t*	lastzone;
+
+// All arenas by address, for Z_ZoneForBlock.
+static memzone_t**	arenas;
+static int		numarenas;
+static int		maxarenas;
+
+// Running totals for Z_GetStats.
+static unsigned long long	zoneallocs;
+static unsigned long long	zoneallocbytes;
+static unsigned long long	zonepurges;
+
+char*		zonetagnames[NUMZONETAGS] =
+{
+    "static",
+    "sound",
+    "music",
+    "dave",
+    "level",
+    "levspec",
+    "cache"
+};
+
+void		(*zonepurgehook) (void);
+
+
+
+//
+// SLABS
+//
+// Small unowned blocks below PU_PURGELEVEL, mostly mobjs,
+//  thinkers and mapblock thing lists, come from size
+//  classes instead of the rover. Each class carves zone
+//  blocks into equal objects, each with its own memblock_t,
+//  so Z_Free, Z_ChangeTag and the checks treat them as
+//  any other block. Free objects are chained through next,
+//  prev points back to the slab.
+// Slabs that are empty after a Z_FreeTags go back to the zone.
+//
+#define SLABGRAIN		16
+#define NUMSLABCLASSES		32	// up to 496 bytes with the header
+#define SLABSIZE		0x4000
+
+// memblock_t user marks.
+#define SLABOBJECT		((void *)3)
+#define SLABBLOCK		((void *)4)
+
+typedef struct slab_s
+{
+    struct slab_s*	next;
+    int			size;	// of each object
+    int			live;
+    
+} slab_t;
+
+typedef struct
+{
+    slab_t*		slabs;
+    memblock_t*		freelist;
+    
+} slabclass_t;
+
+static boolean		useslabs;
+static slabclass_t	slabclasses[NUMSLABCLASSES];
+
+#define SlabObjects(s)	((memblock_t *)((byte *)(s) + sizeof(slab_t)))
+#define SlabCount(s)	((SLABSIZE - (int)sizeof(slab_t)) / (s)->size)
+#define SlabObject(s,i)	((memblock_t *)((byte *)SlabObjects(s) + (i)*(s)->size))
+
 
 
 //
@@ -87,6 +169,44 @@ void Z_ClearZone (memzone_t* zone)
 
 
 
+//
+// Z_AddArenaIndex
+// Enters an arena into arenas, keeping them in order.
+//
+static void Z_AddArenaIndex (memzone_t* zone)
+{
+    int		i;
+
+    if (numarenas == maxarenas)
+    {
+	maxarenas = maxarenas ? maxarenas*2 : 16;
+	arenas = realloc (arenas, maxarenas*sizeof(*arenas));
+	if (!arenas)
+	    I_Error ("Z_AddArenaIndex: no memory for %i arenas", maxarenas);
+    }
+
+    for (i=numarenas ; i>0 && arenas[i-1] > zone ; i--)
+	arenas[i] = arenas[i-1];
+    arenas[i] = zone;
+    numarenas++;
+}
+
+
+//
+// Z_RemoveArenaIndex
+//
+static void Z_RemoveArenaIndex (memzone_t* zone)
+{
+    int		i;
+
+    for (i=0 ; arenas[i] != zone ; i++)
+	;
+    numarenas--;
+    memmove (&arenas[i], &arenas[i+1], (numarenas-i)*sizeof(*arenas));
+}
+
+
+
 //
 // Z_Init
 //
@@ -113,6 +233,307 @@ void Z_Init (void)
     block->user = NULL;
     
     block->size = mainzone->size - sizeof(memzone_t);
+
+    mainzone->next = NULL;
+    lastzone = mainzone;
+    Z_AddArenaIndex (mainzone);
+
+    useslabs = !M_CheckParm ("-noslab");
+}
+
+
+//
+// Z_AddArena
+// Grows the zone by an arena that can hold size bytes.
+//
+static memzone_t* Z_AddArena (int size)
+{
+    memzone_t*	zone;
+    memzone_t*	last;
+
+    size += sizeof(memzone_t);
+    if (size < ARENASIZE)
+	size = ARENASIZE;
+
+    zone = (memzone_t *)I_ZoneArena (size);
+    if (!zone)
+	I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
+    
+    zone->size = size;
+    Z_ClearZone (zone);
+    zone->next = NULL;
+
+    for (last = mainzone ; last->next ; last = last->next)
+	;
+    last->next = zone;
+    Z_AddArenaIndex (zone);
+
+    return zone;
+}
+
+
+//
+// Z_ShrinkZone
+// Hands back arenas that are entirely free.
+//
+static void Z_ShrinkZone (void)
+{
+    memzone_t*	zone;
+    memzone_t**	link;
+    memblock_t*	block;
+
+    link = &mainzone->next;
+    while ( (zone = *link) )
+    {
+	block = zone->blocklist.next;
+	if (block->user || block->next != &zone->blocklist)
+	{
+	    link = &zone->next;
+	    continue;
+	}
+
+	*link = zone->next;
+	if (lastzone == zone)
+	    lastzone = mainzone;
+	Z_RemoveArenaIndex (zone);
+	I_FreeArena ((byte *)zone);
+    }
+}
+
+
+//
+// Z_ZoneForBlock
+// Binary search of the arenas by address.
+//
+static memzone_t* Z_ZoneForBlock (memblock_t* block)
+{
+    memzone_t*	zone;
+    int		low;
+    int		high;
+    int		mid;
+
+    low = 0;
+    high = numarenas-1;
+    while (low <= high)
+    {
+	mid = (low+high)/2;
+	zone = arenas[mid];
+	if ((byte *)block <= (byte *)zone)
+	    high = mid-1;
+	else if ((byte *)block >= (byte *)zone + zone->size)
+	    low = mid+1;
+	else
+	    return zone;
+    }
+
+    I_Error ("Z_Free: block %p isn't in the zone", block);
+    return NULL;
+}
+
+
+
+//
+// Z_FreeSlabObject
+//
+static void Z_FreeSlabObject (memblock_t* block)
+{
+    slabclass_t*	class;
+
+    class = &slabclasses[block->size/SLABGRAIN];
+    
+    block->user = NULL;
+    block->tag = 0;
+    block->id = 0;
+    block->next = class->freelist;
+    class->freelist = block;
+    ((slab_t *)block->prev)->live--;
+}
+
+
+//
+// Z_NewSlab
+// Carves a zone block into free objects of one class.
+//
+static void Z_NewSlab (int classnum)
+{
+    slabclass_t*	class;
+    slab_t*		slab;
+    memblock_t*		block;
+    int			i;
+
+    class = &slabclasses[classnum];
+    
+    slab = Z_Malloc (SLABSIZE, PU_STATIC, NULL);
+    ((memblock_t *)((byte *)slab - sizeof(memblock_t)))->user = SLABBLOCK;
+    
+    slab->size = classnum*SLABGRAIN;
+    slab->live = 0;
+    slab->next = class->slabs;
+    class->slabs = slab;
+
+    // lowest address handed out first
+    for (i=SlabCount(slab)-1 ; i>=0 ; i--)
+    {
+	block = SlabObject(slab,i);
+	block->size = slab->size;
+	block->user = NULL;
+	block->tag = 0;
+	block->id = 0;
+	block->prev = (memblock_t *)slab;
+	block->next = class->freelist;
+	class->freelist = block;
+    }
+}
+
+
+//
+// Z_SlabMalloc
+//
+static void* Z_SlabMalloc (int classnum, int tag)
+{
+    slabclass_t*	class;
+    memblock_t*		block;
+
+    class = &slabclasses[classnum];
+    if (!class->freelist)
+	Z_NewSlab (classnum);
+
+    block = class->freelist;
+    class->freelist = block->next;
+    block->next = NULL;
+    
+    block->user = SLABOBJECT;
+    block->tag = tag;
+    block->id = ZONEID;
+    ((slab_t *)block->prev)->live++;
+
+    return (void *) ((byte *)block + sizeof(memblock_t));
+}
+
+
+//
+// Z_FreeSlabTags
+// Frees the slab objects of Z_FreeTags,
+//  then hands empty slabs back to the zone.
+//
+static void
+Z_FreeSlabTags
+( int		lowtag,
+  int		hightag )
+{
+    slabclass_t*	class;
+    slab_t*		slab;
+    slab_t**		link;
+    memblock_t*		block;
+    int			c;
+    int			i;
+
+    for (c=0, class=slabclasses ; c<NUMSLABCLASSES ; c++, class++)
+    {
+	if (!class->slabs)
+	    continue;
+
+	link = &class->slabs;
+	while ( (slab = *link) )
+	{
+	    for (i=0 ; i<SlabCount(slab) && slab->live ; i++)
+	    {
+		block = SlabObject(slab,i);
+		if (block->user
+		    && block->tag >= lowtag && block->tag <= hightag)
+		    Z_FreeSlabObject (block);
+	    }
+
+	    if (slab->live)
+	    {
+		link = &slab->next;
+		continue;
+	    }
+	    *link = slab->next;
+	    Z_Free (slab);
+	}
+
+	// chain up what is left, lowest address first
+	class->freelist = NULL;
+	for (slab = class->slabs ; slab ; slab = slab->next)
+	{
+	    for (i=SlabCount(slab)-1 ; i>=0 ; i--)
+	    {
+		block = SlabObject(slab,i);
+		if (block->user)
+		    continue;
+		block->next = class->freelist;
+		class->freelist = block;
+	    }
+	}
+    }
+}
+
+
+//
+// Z_CheckSlabs
+//
+static void Z_CheckSlabs (void)
+{
+    slab_t*		slab;
+    memblock_t*		block;
+    int			c;
+    int			i;
+    int			live;
+
+    for (c=0 ; c<NUMSLABCLASSES ; c++)
+    {
+	for (slab = slabclasses[c].slabs ; slab ; slab = slab->next)
+	{
+	    if (slab->size != c*SLABGRAIN)
+		I_Error ("Z_CheckHeap: slab in the wrong class\n");
+
+	    live = 0;
+	    for (i=0 ; i<SlabCount(slab) ; i++)
+	    {
+		block = SlabObject(slab,i);
+		if (block->size != slab->size
+		    || block->prev != (memblock_t *)slab)
+		    I_Error ("Z_CheckHeap: slab object doesn't "
+			     "belong to its slab\n");
+		if (!block->user)
+		    continue;
+		if (block->user != SLABOBJECT || block->id != ZONEID)
+		    I_Error ("Z_CheckHeap: bad slab object\n");
+		live++;
+	    }
+	    
+	    if (live != slab->live)
+		I_Error ("Z_CheckHeap: slab count is off\n");
+	}
+    }
+}
+
+
+//
+// Z_DumpSlabs
+//
+static void Z_DumpSlabs (FILE* f)
+{
+    slab_t*	slab;
+    int		c;
+    int		numslabs;
+    int		live;
+    int		total;
+
+    for (c=0 ; c<NUMSLABCLASSES ; c++)
+    {
+	numslabs = live = total = 0;
+	for (slab = slabclasses[c].slabs ; slab ; slab = slab->next)
+	{
+	    numslabs++;
+	    live += slab->live;
+	    total += SlabCount(slab);
+	}
+	if (numslabs)
+	    fprintf (f,"slab size:%4i    slabs:%4i    live:%6i/%6i\n",
+		     c*SLABGRAIN, numslabs, live, total);
+    }
 }
 
 
@@ -121,6 +542,7 @@ void Z_Init (void)
 //
 void Z_Free (void* ptr)
 {
+    memzone_t*		zone;
     memblock_t*		block;
     memblock_t*		other;
 	
@@ -128,6 +550,14 @@ void Z_Free (void* ptr)
 
     if (block->id != ZONEID)
 	I_Error ("Z_Free: freed a pointer without ZONEID");
+
+    if (block->user == SLABOBJECT)
+    {
+	Z_FreeSlabObject (block);
+	return;
+    }
+
+    zone = Z_ZoneForBlock (block);
 		
     if (block->user > (void **)0x100)
     {
@@ -152,8 +582,8 @@ void Z_Free (void* ptr)
 	other->next = block->next;
 	other->next->prev = other;
 
-	if (block == mainzone->rover)
-	    mainzone->rover = other;
+	if (block == zone->rover)
+	    zone->rover = other;
 
 	block = other;
     }
@@ -166,8 +596,8 @@ void Z_Free (void* ptr)
 	block->next = other->next;
 	block->next->prev = block;
 
-	if (other == mainzone->rover)
-	    mainzone->rover = block;
+	if (other == zone->rover)
+	    zone->rover = block;
     }
 }
 
@@ -180,9 +610,14 @@ void Z_Free (void* ptr)
 #define MINFRAGMENT		64
 
 
-void*
-Z_Malloc
-( int		size,
+//
+// Z_ZoneMalloc
+// Returns NULL if the arena has no room, even after purging.
+//
+static void*
+Z_ZoneMalloc
+( memzone_t*	zone,
+  int		size,
   int		tag,
   void*		user )
 {
@@ -192,8 +627,6 @@ Z_Malloc
     memblock_t* newblock;
     memblock_t*	base;
 
-    size = (size + 3) & ~3;
-    
     // scan through the block list,
     // looking for the first free block
     // of sufficient size,
@@ -204,7 +637,7 @@ Z_Malloc
     
     // if there is a free block behind the rover,
     //  back up over them
-    base = mainzone->rover;
+    base = zone->rover;
     
     if (!base->prev->user)
 	base = base->prev;
@@ -217,7 +650,7 @@ Z_Malloc
 	if (rover == start)
 	{
 	    // scanned all the way around the list
-	    I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
+	    return NULL;
 	}
 	
 	if (rover->user)
@@ -231,6 +664,9 @@ Z_Malloc
 	    else
 	    {
 		// free the rover block (adding the size to base)
+		if (zonepurgehook)
+		    zonepurgehook ();
+		zonepurges++;
 
 		// the rover can be the base block
 		base = base->prev;
@@ -281,7 +717,8 @@ Z_Malloc
     base->tag = tag;
 
     // next allocation will start looking here
-    mainzone->rover = base->next;	
+    zone->rover = base->next;	
+    lastzone = zone;
 	
     base->id = ZONEID;
     
@@ -290,6 +727,48 @@ Z_Malloc
 
 
 
+void*
+Z_Malloc
+( int		size,
+  int		tag,
+  void*		user )
+{
+    memzone_t*	zone;
+    void*	ptr;
+    int		class;
+
+    size = (size + 3) & ~3;
+
+    zoneallocs++;
+    zoneallocbytes += size;
+
+    // small, unowned and never purged
+    if (useslabs && !user && tag < PU_PURGELEVEL)
+    {
+	class = (size + sizeof(memblock_t) + SLABGRAIN-1) / SLABGRAIN;
+	if (class < NUMSLABCLASSES)
+	    return Z_SlabMalloc (class, tag);
+    }
+
+    // the arena that had room last time first
+    ptr = Z_ZoneMalloc (lastzone, size, tag, user);
+    
+    for (zone = mainzone ; !ptr && zone ; zone = zone->next)
+	if (zone != lastzone)
+	    ptr = Z_ZoneMalloc (zone, size, tag, user);
+
+    // out of room, grow
+    if (!ptr)
+    {
+	zone = Z_AddArena (size + sizeof(memblock_t));
+	ptr = Z_ZoneMalloc (zone, size, tag, user);
+    }
+    
+    return ptr;
+}
+
+
+
 //
 // Z_FreeTags
 //
@@ -298,23 +777,31 @@ Z_FreeTags
 ( int		lowtag,
   int		hightag )
 {
+    memzone_t*	zone;
     memblock_t*	block;
     memblock_t*	next;
-	
-    for (block = mainzone->blocklist.next ;
-	 block != &mainzone->blocklist ;
-	 block = next)
+
+    Z_FreeSlabTags (lowtag, hightag);
+
+    for (zone = mainzone ; zone ; zone = zone->next)
     {
-	// get link before freeing
-	next = block->next;
+	for (block = zone->blocklist.next ;
+	     block != &zone->blocklist ;
+	     block = next)
+	{
+	    // get link before freeing
+	    next = block->next;
 
-	// free block?
-	if (!block->user)
-	    continue;
+	    // free block, or a slab which has its own tags?
+	    if (!block->user || block->user == SLABBLOCK)
+		continue;
 	
-	if (block->tag >= lowtag && block->tag <= hightag)
-	    Z_Free ( (byte *)block+sizeof(memblock_t));
+	    if (block->tag >= lowtag && block->tag <= hightag)
+		Z_Free ( (byte *)block+sizeof(memblock_t));
+	}
     }
+
+    Z_ShrinkZone ();
 }
 
 
@@ -328,35 +815,41 @@ Z_DumpHeap
 ( int		lowtag,
   int		hightag )
 {
+    memzone_t*	zone;
     memblock_t*	block;
 	
-    printf ("zone size: %i  location: %p\n",
-	    mainzone->size,mainzone);
-    
     printf ("tag range: %i to %i\n",
 	    lowtag, hightag);
-	
-    for (block = mainzone->blocklist.next ; ; block = block->next)
+
+    for (zone = mainzone ; zone ; zone = zone->next)
     {
-	if (block->tag >= lowtag && block->tag <= hightag)
-	    printf ("block:%p    size:%7i    user:%p    tag:%3i\n",
-		    block, block->size, block->user, block->tag);
-		
-	if (block->next == &mainzone->blocklist)
+	printf ("zone size: %i  location: %p\n",
+		zone->size,zone);
+	
+	for (block = zone->blocklist.next ; ; block = block->next)
 	{
-	    // all blocks have been hit
-	    break;
-	}
+	    if (block->tag >= lowtag && block->tag <= hightag)
+		printf ("block:%p    size:%7i    user:%p    tag:%3i\n",
+			block, block->size, block->user, block->tag);
+		
+	    if (block->next == &zone->blocklist)
+	    {
+		// all blocks have been hit
+		break;
+	    }
 	
-	if ( (byte *)block + block->size != (byte *)block->next)
-	    printf ("ERROR: block size does not touch the next block\n");
+	    if ( (byte *)block + block->size != (byte *)block->next)
+		printf ("ERROR: block size does not touch the next block\n");
 
-	if ( block->next->prev != block)
-	    printf ("ERROR: next block doesn't have proper back link\n");
+	    if ( block->next->prev != block)
+		printf ("ERROR: next block doesn't have proper back link\n");
 
-	if (!block->user && !block->next->user)
-	    printf ("ERROR: two consecutive free blocks\n");
+	    if (!block->user && !block->next->user)
+		printf ("ERROR: two consecutive free blocks\n");
+	}
     }
+
+    Z_DumpSlabs (stdout);
 }
 
 
@@ -365,30 +858,36 @@ Z_DumpHeap
 //
 void Z_FileDumpHeap (FILE* f)
 {
+    memzone_t*	zone;
     memblock_t*	block;
-	
-    fprintf (f,"zone size: %i  location: %p\n",mainzone->size,mainzone);
-	
-    for (block = mainzone->blocklist.next ; ; block = block->next)
+
+    for (zone = mainzone ; zone ; zone = zone->next)
     {
-	fprintf (f,"block:%p    size:%7i    user:%p    tag:%3i\n",
-		 block, block->size, block->user, block->tag);
-		
-	if (block->next == &mainzone->blocklist)
+	fprintf (f,"zone size: %i  location: %p\n",zone->size,zone);
+	
+	for (block = zone->blocklist.next ; ; block = block->next)
 	{
-	    // all blocks have been hit
-	    break;
-	}
+	    fprintf (f,"block:%p    size:%7i    user:%p    tag:%3i\n",
+		     block, block->size, block->user, block->tag);
+		
+	    if (block->next == &zone->blocklist)
+	    {
+		// all blocks have been hit
+		break;
+	    }
 	
-	if ( (byte *)block + block->size != (byte *)block->next)
-	    fprintf (f,"ERROR: block size does not touch the next block\n");
+	    if ( (byte *)block + block->size != (byte *)block->next)
+		fprintf (f,"ERROR: block size does not touch the next block\n");
 
-	if ( block->next->prev != block)
-	    fprintf (f,"ERROR: next block doesn't have proper back link\n");
+	    if ( block->next->prev != block)
+		fprintf (f,"ERROR: next block doesn't have proper back link\n");
 
-	if (!block->user && !block->next->user)
-	    fprintf (f,"ERROR: two consecutive free blocks\n");
+	    if (!block->user && !block->next->user)
+		fprintf (f,"ERROR: two consecutive free blocks\n");
+	}
     }
+
+    Z_DumpSlabs (f);
 }
 
 
@@ -398,25 +897,31 @@ void Z_FileDumpHeap (FILE* f)
 //
 void Z_CheckHeap (void)
 {
+    memzone_t*	zone;
     memblock_t*	block;
-	
-    for (block = mainzone->blocklist.next ; ; block = block->next)
+
+    for (zone = mainzone ; zone ; zone = zone->next)
     {
-	if (block->next == &mainzone->blocklist)
+	for (block = zone->blocklist.next ; ; block = block->next)
 	{
-	    // all blocks have been hit
-	    break;
-	}
+	    if (block->next == &zone->blocklist)
+	    {
+		// all blocks have been hit
+		break;
+	    }
 	
-	if ( (byte *)block + block->size != (byte *)block->next)
-	    I_Error ("Z_CheckHeap: block size does not touch the next block\n");
+	    if ( (byte *)block + block->size != (byte *)block->next)
+		I_Error ("Z_CheckHeap: block size does not touch the next block\n");
 
-	if ( block->next->prev != block)
-	    I_Error ("Z_CheckHeap: next block doesn't have proper back link\n");
+	    if ( block->next->prev != block)
+		I_Error ("Z_CheckHeap: next block doesn't have proper back link\n");
 
-	if (!block->user && !block->next->user)
-	    I_Error ("Z_CheckHeap: two consecutive free blocks\n");
+	    if (!block->user && !block->next->user)
+		I_Error ("Z_CheckHeap: two consecutive free blocks\n");
+	}
     }
+
+    Z_CheckSlabs ();
 }
 
 
@@ -450,18 +955,108 @@ Z_ChangeTag2
 //
 int Z_FreeMemory (void)
 {
+    memzone_t*		zone;
     memblock_t*		block;
+    slab_t*		slab;
     int			free;
+    int			c;
 	
     free = 0;
+
+    for (c=0 ; c<NUMSLABCLASSES ; c++)
+	for (slab = slabclasses[c].slabs ; slab ; slab = slab->next)
+	    free += (SlabCount(slab) - slab->live) * slab->size;
     
-    for (block = mainzone->blocklist.next ;
-	 block != &mainzone->blocklist;
-	 block = block->next)
+    for (zone = mainzone ; zone ; zone = zone->next)
     {
-	if (!block->user || block->tag >= PU_PURGELEVEL)
-	    free += block->size;
+	for (block = zone->blocklist.next ;
+	     block != &zone->blocklist;
+	     block = block->next)
+	{
+	    if (!block->user || block->tag >= PU_PURGELEVEL)
+		free += block->size;
+	}
     }
     return free;
 }
 
+
+
+//
+// Z_TagClass
+//
+static zonetag_t Z_TagClass (int tag)
+{
+    if (tag >= PU_PURGELEVEL)
+	return zt_cache;
+    
+    switch (tag)
+    {
+      case PU_SOUND:	return zt_sound;
+      case PU_MUSIC:	return zt_music;
+      case PU_DAVE:	return zt_dave;
+      case PU_LEVEL:	return zt_level;
+      case PU_LEVSPEC:	return zt_levspec;
+      default:		return zt_static;
+    }
+}
+
+
+//
+// Z_GetStats
+//
+void Z_GetStats (zonestats_t* stats)
+{
+    memzone_t*		zone;
+    memblock_t*		block;
+    slab_t*		slab;
+    int			c;
+    int			i;
+
+    memset (stats, 0, sizeof(*stats));
+
+    for (zone = mainzone ; zone ; zone = zone->next)
+    {
+	stats->arenas++;
+	stats->zonesize += zone->size;
+	
+	for (block = zone->blocklist.next ;
+	     block != &zone->blocklist;
+	     block = block->next)
+	{
+	    if (block->user == SLABBLOCK)
+		continue;	// counted object by object below
+	    
+	    if (block->user)
+	    {
+		stats->tagbytes[Z_TagClass (block->tag)] += block->size;
+		continue;
+	    }
+	    
+	    stats->freebytes += block->size;
+	    stats->freeblocks++;
+	    if (block->size > stats->largestfree)
+		stats->largestfree = block->size;
+	}
+    }
+
+    for (c=0 ; c<NUMSLABCLASSES ; c++)
+    {
+	for (slab = slabclasses[c].slabs ; slab ; slab = slab->next)
+	{
+	    for (i=0 ; i<SlabCount(slab) ; i++)
+	    {
+		block = SlabObject(slab,i);
+		if (block->user)
+		    stats->tagbytes[Z_TagClass (block->tag)] += block->size;
+		else
+		    stats->slabfree += block->size;
+	    }
+	}
+    }
+
+    stats->allocs = zoneallocs;
+    stats->allocbytes = zoneallocbytes;
+    stats->purges = zonepurges;
+}
+
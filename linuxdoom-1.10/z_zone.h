@@ -54,6 +54,48 @@ void    Z_CheckHeap (void);
 void    Z_ChangeTag2 (void *ptr, int tag);
 int     Z_FreeMemory (void);
 
+// If set, called before a purgable block is thrown out.
+extern void	(*zonepurgehook) (void);
+
+
+//
+// Zone statistics.
+// Bytes include the block headers.
+//
+typedef enum
+{
+    zt_static,
+    zt_sound,
+    zt_music,
+    zt_dave,
+    zt_level,
+    zt_levspec,
+    zt_cache,		// anything purgable
+    NUMZONETAGS
+    
+} zonetag_t;
+
+typedef struct
+{
+    int		arenas;
+    int		zonesize;		// all arenas
+    int		tagbytes[NUMZONETAGS];	// in use
+    int		freebytes;
+    int		freeblocks;
+    int		largestfree;
+    int		slabfree;		// free objects in slabs
+
+    // running totals since startup
+    unsigned long long	allocs;
+    unsigned long long	allocbytes;
+    unsigned long long	purges;
+    
+} zonestats_t;
+
+extern char*	zonetagnames[NUMZONETAGS];
+
+void	Z_GetStats (zonestats_t* stats);
+
 
 typedef struct memblock_s
 {
@@ -73,7 +115,7 @@ typedef struct memblock_s
 { \
       if (( (memblock_t *)( (byte *)(p) - sizeof(memblock_t)))->id!=0x1d4a11) \
 	  I_Error("Z_CT at "__FILE__":%i",__LINE__); \
-	  Z_ChangeTag2(p,t); \
+      Z_ChangeTag2(p,t); \
 };
 
 
@@ -81,11 +81,13 @@ I_InitSound
         fprintf(stderr, "Could not open /dev/dsp\n");
          
                      
-    i = 11 | (2<<16);                                           
+    // two fragments of at least one update
+    for (i=11 ; (1<<i) < SAMPLECOUNT*4*samplerate/SPEED ; i++);
+    i |= 2<<16;
     myioctl(audio_fd, SNDCTL_DSP_SETFRAGMENT, &i);
                     
     myioctl(audio_fd, SNDCTL_DSP_RESET, 0);
-    i=11025;
+    i=samplerate;
     myioctl(audio_fd, SNDCTL_DSP_SPEED, &i);
     i=1;    
     myioctl(audio_fd, SNDCTL_DSP_STEREO, &i);
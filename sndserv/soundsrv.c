@@ -41,6 +41,7 @@ static const char rcsid[] = "$Id: soundsrv.c,v 1.3 1997/01/29 22:40:44 b1 Exp $"
 
 
 #include <math.h>
+#include <string.h>
 #include <sys/types.h>
 #include <stdio.h>
 #include <fcntl.h>
@@ -51,6 +52,12 @@ static const char rcsid[] = "$Id: soundsrv.c,v 1.3 1997/01/29 22:40:44 b1 Exp $"
 #include <sys/stat.h>
 #include <sys/time.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "sounds.h"
 #include "soundsrv.h"
 #include "wadread.h"
@@ -91,9 +98,24 @@ int 		longsound;
 // lengths of all sound effects
 int 		lengths[NUMSFX];
 
+// sample rates from the DMX headers
+int		rates[NUMSFX];
+
+// output rate and samples per update
+int		samplerate = SPEED;
+int		mixsamples = SAMPLECOUNT;
+
+// channels in use
+int		numchannels = 32;
+
 // mixing buffer
 signed short	mixbuffer[MIXBUFFERSIZE];
 
+// left and right sums, one channel resampled
+static float	mixleft[MAXSAMPLECOUNT];
+static float	mixright[MAXSAMPLECOUNT];
+static float	mixchannel[MAXSAMPLECOUNT];
+
 // file descriptor of sfx device
 int		sfxdevice;			
 
@@ -101,200 +123,178 @@ int		sfxdevice;
 int 		musdevice;			
 
 // the channel data pointers
-unsigned char*	channels[8];
+unsigned char*	channels[MAXCHANNELS];
 
-// the channel step amount
-unsigned int	channelstep[8];
+// the channel step amount, with the rate conversion
+unsigned int	channelstep[MAXCHANNELS];
 
 // 0.16 bit remainder of last step
-unsigned int	channelstepremainder[8];
+unsigned int	channelstepremainder[MAXCHANNELS];
 
 // the channel data end pointers
-unsigned char*	channelsend[8];
+unsigned char*	channelsend[MAXCHANNELS];
 
 // time that the channel started playing
-int		channelstart[8];
+int		channelstart[MAXCHANNELS];
 
 // the channel handles
-int 		channelhandles[8];
+int 		channelhandles[MAXCHANNELS];
 
-// the channel left volume lookup
-int*		channelleftvol_lookup[8];
+// the channel left gain
+float		channelleftgain[MAXCHANNELS];
 
-// the channel right volume lookup
-int*		channelrightvol_lookup[8];
+// the channel right gain
+float		channelrightgain[MAXCHANNELS];
 
 // sfx id of the playing sound effect
-int		channelids[8];			
+int		channelids[MAXCHANNELS];			
 
 int		snd_verbose=1;
 
 int		steptable[256];
 
-int		vol_lookup[128*256];
-
 static void derror(char* msg)
 {
     fprintf(stderr, "error: %s\n", msg);
     exit(-1);
 }
 
-int mix(void)
+// resample one channel into mixchannel,
+//  returns the samples made
+static int resample(int chan)
 {
+    unsigned char*	data;
+    unsigned char*	end;
+    unsigned int	step;
+    unsigned int	frac;
+    int			i;
+
+    data = channels[chan];
+    end = channelsend[chan];
+    step = channelstep[chan];
+    frac = channelstepremainder[chan];
+
+    // data is padded, data[1] is always there
+    for (i=0 ; i<mixsamples ; )
+    {
+	mixchannel[i++] = (data[0]-128)
+	    + (data[1]-data[0]) * (frac * (1.0f/65536));
+	frac += step;
+	data += frac >> 16;
+	frac &= 65536-1;
 
-    register int		dl;
-    register int		dr;
-    register unsigned int	sample;
-    
-    signed short*		leftout;
-    signed short*		rightout;
-    signed short*		leftend;
+	if (data >= end)
+	{
+	    data = 0;
+	    break;
+	}
+    }
+
+    channels[chan] = data;
+    channelstepremainder[chan] = frac;
+    return i;
+}
+
+// add mixchannel into the sums
+static void mixchan(int count, float left, float right)
+{
+    int		i = 0;
     
-    int				step;
+#if defined(__AVX2__)
+    __m256	l = _mm256_set1_ps(left);
+    __m256	r = _mm256_set1_ps(right);
+    __m256	in;
 
-    leftout = mixbuffer;
-    rightout = mixbuffer+1;
-    step = 2;
+    for ( ; i+8 <= count ; i+=8)
+    {
+	in = _mm256_loadu_ps(mixchannel+i);
+	_mm256_storeu_ps(mixleft+i, _mm256_add_ps(_mm256_loadu_ps(mixleft+i),
+						  _mm256_mul_ps(in, l)));
+	_mm256_storeu_ps(mixright+i, _mm256_add_ps(_mm256_loadu_ps(mixright+i),
+						   _mm256_mul_ps(in, r)));
+    }
+#elif defined(__SSE2__)
+    __m128	l = _mm_set1_ps(left);
+    __m128	r = _mm_set1_ps(right);
+    __m128	in;
 
-    leftend = mixbuffer + SAMPLECOUNT*step;
+    for ( ; i+4 <= count ; i+=4)
+    {
+	in = _mm_loadu_ps(mixchannel+i);
+	_mm_storeu_ps(mixleft+i, _mm_add_ps(_mm_loadu_ps(mixleft+i),
+					    _mm_mul_ps(in, l)));
+	_mm_storeu_ps(mixright+i, _mm_add_ps(_mm_loadu_ps(mixright+i),
+					     _mm_mul_ps(in, r)));
+    }
+#endif
 
-    // mix into the mixing buffer
-    while (leftout != leftend)
+    for ( ; i<count ; i++)
     {
+	mixleft[i] += mixchannel[i] * left;
+	mixright[i] += mixchannel[i] * right;
+    }
+}
 
-	dl = 0;
-	dr = 0;
+int mix(void)
+{
+    signed short*	out;
+    int			chan;
+    int			i;
+    long		v;
 
-	if (channels[0])
-	{
-	    sample = *channels[0];
-	    dl += channelleftvol_lookup[0][sample];
-	    dr += channelrightvol_lookup[0][sample];
-	    channelstepremainder[0] += channelstep[0];
-	    channels[0] += channelstepremainder[0] >> 16;
-	    channelstepremainder[0] &= 65536-1;
-
-	    if (channels[0] >= channelsend[0])
-		channels[0] = 0;
-	}
+    memset(mixleft, 0, mixsamples*sizeof(*mixleft));
+    memset(mixright, 0, mixsamples*sizeof(*mixright));
 
-	if (channels[1])
-	{
-	    sample = *channels[1];
-	    dl += channelleftvol_lookup[1][sample];
-	    dr += channelrightvol_lookup[1][sample];
-	    channelstepremainder[1] += channelstep[1];
-	    channels[1] += channelstepremainder[1] >> 16;
-	    channelstepremainder[1] &= 65536-1;
-
-	    if (channels[1] >= channelsend[1])
-		channels[1] = 0;
-	}
+    for (chan=0 ; chan<numchannels ; chan++)
+    {
+	if (channels[chan])
+	    mixchan(resample(chan),
+		    channelleftgain[chan], channelrightgain[chan]);
+    }
 
-	if (channels[2])
-	{
-	    sample = *channels[2];
-	    dl += channelleftvol_lookup[2][sample];
-	    dr += channelrightvol_lookup[2][sample];
-	    channelstepremainder[2] += channelstep[2];
-	    channels[2] += channelstepremainder[2] >> 16;
-	    channelstepremainder[2] &= 65536-1;
-
-	    if (channels[2] >= channelsend[2])
-		channels[2] = 0;
-	}
-	
-	if (channels[3])
-	{
-	    sample = *channels[3];
-	    dl += channelleftvol_lookup[3][sample];
-	    dr += channelrightvol_lookup[3][sample];
-	    channelstepremainder[3] += channelstep[3];
-	    channels[3] += channelstepremainder[3] >> 16;
-	    channelstepremainder[3] &= 65536-1;
-
-	    if (channels[3] >= channelsend[3])
-		channels[3] = 0;
-	}
-	
-	if (channels[4])
-	{
-	    sample = *channels[4];
-	    dl += channelleftvol_lookup[4][sample];
-	    dr += channelrightvol_lookup[4][sample];
-	    channelstepremainder[4] += channelstep[4];
-	    channels[4] += channelstepremainder[4] >> 16;
-	    channelstepremainder[4] &= 65536-1;
-
-	    if (channels[4] >= channelsend[4])
-		channels[4] = 0;
-	}
-	
-	if (channels[5])
-	{
-	    sample = *channels[5];
-	    dl += channelleftvol_lookup[5][sample];
-	    dr += channelrightvol_lookup[5][sample];
-	    channelstepremainder[5] += channelstep[5];
-	    channels[5] += channelstepremainder[5] >> 16;
-	    channelstepremainder[5] &= 65536-1;
-
-	    if (channels[5] >= channelsend[5])
-		channels[5] = 0;
-	}
-	
-	if (channels[6])
+    // round and clamp, interleaved
+    out = mixbuffer;
+    i = 0;
+    
+#if defined(__AVX2__)
+    {
+	__m256i	l;
+	__m256i	r;
+
+	// packs works per 128 bit lane, pairs stay in order
+	for ( ; i+8 <= mixsamples ; i+=8, out+=16)
 	{
-	    sample = *channels[6];
-	    dl += channelleftvol_lookup[6][sample];
-	    dr += channelrightvol_lookup[6][sample];
-	    channelstepremainder[6] += channelstep[6];
-	    channels[6] += channelstepremainder[6] >> 16;
-	    channelstepremainder[6] &= 65536-1;
-
-	    if (channels[6] >= channelsend[6])
-		channels[6] = 0;
+	    l = _mm256_cvtps_epi32(_mm256_loadu_ps(mixleft+i));
+	    r = _mm256_cvtps_epi32(_mm256_loadu_ps(mixright+i));
+	    _mm256_storeu_si256((__m256i *)out, _mm256_packs_epi32
+				(_mm256_unpacklo_epi32(l, r),
+				 _mm256_unpackhi_epi32(l, r)));
 	}
-	if (channels[7])
+    }
+#elif defined(__SSE2__)
+    {
+	__m128i	l;
+	__m128i	r;
+
+	for ( ; i+4 <= mixsamples ; i+=4, out+=8)
 	{
-	    sample = *channels[7];
-	    dl += channelleftvol_lookup[7][sample];
-	    dr += channelrightvol_lookup[7][sample];
-	    channelstepremainder[7] += channelstep[7];
-	    channels[7] += channelstepremainder[7] >> 16;
-	    channelstepremainder[7] &= 65536-1;
-
-	    if (channels[7] >= channelsend[7])
-		channels[7] = 0;
+	    l = _mm_cvtps_epi32(_mm_loadu_ps(mixleft+i));
+	    r = _mm_cvtps_epi32(_mm_loadu_ps(mixright+i));
+	    _mm_storeu_si128((__m128i *)out, _mm_packs_epi32
+			     (_mm_unpacklo_epi32(l, r),
+			      _mm_unpackhi_epi32(l, r)));
 	}
+    }
+#endif
 
-	// Has been char instead of short.
-	// if (dl > 127) *leftout = 127;
-	// else if (dl < -128) *leftout = -128;
-	// else *leftout = dl;
-
-	// if (dr > 127) *rightout = 127;
-	// else if (dr < -128) *rightout = -128;
-	// else *rightout = dr;
-	
-	if (dl > 0x7fff)
-	    *leftout = 0x7fff;
-	else if (dl < -0x8000)
-	    *leftout = -0x8000;
-	else
-	    *leftout = dl;
-
-	if (dr > 0x7fff)
-	    *rightout = 0x7fff;
-	else if (dr < -0x8000)
-	    *rightout = -0x8000;
-	else
-	    *rightout = dr;
-
-	leftout += step;
-	rightout += step;
-
+    for ( ; i<mixsamples ; i++)
+    {
+	v = lrintf(mixleft[i]);
+	*out++ = v > 0x7fff ? 0x7fff : v < -0x8000 ? -0x8000 : v;
+	v = lrintf(mixright[i]);
+	*out++ = v > 0x7fff ? 0x7fff : v < -0x8000 ? -0x8000 : v;
     }
+    
     return 1;
 }
 
@@ -349,8 +349,26 @@ grabdata
 	{
 	    snd_verbose = 0;
 	}
+	else if (!strcmp(v[i], "-samplerate") && i<c-1)
+	{
+	    samplerate = atoi(v[++i]);
+	    if (samplerate < SPEED)
+		samplerate = SPEED;
+	    if (samplerate > MAXSPEED)
+		samplerate = MAXSPEED;
+	}
+	else if (!strcmp(v[i], "-mixchannels") && i<c-1)
+	{
+	    numchannels = atoi(v[++i]);
+	    if (numchannels < 1)
+		numchannels = 1;
+	    if (numchannels > MAXCHANNELS)
+		numchannels = MAXCHANNELS;
+	}
     }
 
+    mixsamples = (SAMPLECOUNT*samplerate/SPEED + 7) & ~7;
+    
     numsounds = NUMSFX;
     longsound = 0;
 
@@ -385,9 +403,16 @@ grabdata
 	{
 	    S_sfx[i].data = getsfx(S_sfx[i].name, &lengths[i]);
 	    if (longsound < lengths[i]) longsound = lengths[i];
+
+	    // second short of the DMX header
+	    rates[i] = ((unsigned char *)S_sfx[i].data)[-6]
+		| (((unsigned char *)S_sfx[i].data)[-5] << 8);
+	    if (!rates[i])
+		rates[i] = SPEED;
 	} else {
 	    S_sfx[i].data = S_sfx[i].link->data;
-	    lengths[i] = lengths[(S_sfx[i].link - S_sfx)/sizeof(sfxinfo_t)];
+	    lengths[i] = lengths[S_sfx[i].link - S_sfx];
+	    rates[i] = rates[S_sfx[i].link - S_sfx];
 	}
 	// test only
 	//  {
@@ -411,7 +436,7 @@ void updatesounds(void)
 {
 
     mix();
-    I_SubmitOutputBuffer(mixbuffer, SAMPLECOUNT);
+    I_SubmitOutputBuffer(mixbuffer, mixsamples);
 
 }
 
@@ -442,7 +467,7 @@ addsfx
 	 || sfxid == sfx_stnmov
 	 || sfxid == sfx_pistol )
     {
-	for (i=0 ; i<8 ; i++)
+	for (i=0 ; i<numchannels ; i++)
 	{
 	    if (channels[i] && channelids[i] == sfxid)
 	    {
@@ -452,7 +477,7 @@ addsfx
 	}
     }
 
-    for (i=0 ; i<8 && channels[i] ; i++)
+    for (i=0 ; i<numchannels && channels[i] ; i++)
     {
 	if (channelstart[i] < oldest)
 	{
@@ -461,7 +486,7 @@ addsfx
 	}
     }
 
-    if (i == 8)
+    if (i == numchannels)
 	slot = oldestnum;
     else
 	slot = i;
@@ -473,7 +498,8 @@ addsfx
 	handlenums = 100;
     
     channelhandles[slot] = rc = handlenums++;
-    channelstep[slot] = step;
+    channelstep[slot] =
+	(unsigned int)((double)step * rates[sfxid] / samplerate);
     channelstepremainder[slot] = 0;
     channelstart[slot] = mytime;
 
@@ -497,10 +523,10 @@ addsfx
     if (leftvol < 0 || leftvol > 127)
 	derror("leftvol out of bounds");
     
-    // get the proper lookup table piece
-    //  for this volume level
-    channelleftvol_lookup[slot] = &vol_lookup[leftvol*256];
-    channelrightvol_lookup[slot] = &vol_lookup[rightvol*256];
+    // the scale the old volume lookups had,
+    //  also turns the unsigned samples into 16 bit
+    channelleftgain[slot] = leftvol*256/127.0f;
+    channelrightgain[slot] = rightvol*256/127.0f;
 
     channelids[slot] = sfxid;
 
@@ -538,7 +564,6 @@ void initdata(void)
 {
 
     int		i;
-    int		j;
     
     int*	steptablemid = steptable + 128;
 
@@ -554,17 +579,6 @@ void initdata(void)
     for (i=-128 ; i<128 ; i++)
 	steptablemid[i] = pow(2.0, (i/64.0))*65536.0;
 
-    // generates volume lookup tables
-    //  which also turn the unsigned samples
-    //  into signed samples
-    // for (i=0 ; i<128 ; i++)
-    // for (j=0 ; j<256 ; j++)
-    // vol_lookup[i*256+j] = (i*(j-128))/127;
-    
-    for (i=0 ; i<128 ; i++)
-	for (j=0 ; j<256 ; j++)
-	    vol_lookup[i*256+j] = (i*(j-128)*256)/127;
-
 }
 
 
@@ -613,7 +627,7 @@ main
     // init any data
     initdata();		
 
-    I_InitSound(11025, 16);
+    I_InitSound(samplerate, 16);
 
     I_InitMusic();
 
@@ -727,9 +741,9 @@ main
 
 	if (waitingtofinish)
 	{
-	    for(i=0 ; i<8 && !channels[i] ; i++);
+	    for(i=0 ; i<numchannels && !channels[i] ; i++);
 	    
-	    if (i==8)
+	    if (i==numchannels)
 		done=1;
 	}
 
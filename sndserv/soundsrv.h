@@ -35,9 +35,14 @@
 #ifndef __SNDSERVER_H__
 #define __SNDSERVER_H__
 
+// SAMPLECOUNT is at SPEED, the output rate
+//  mixes as many samples as take the same time.
 #define SAMPLECOUNT		512
-#define MIXBUFFERSIZE	(SAMPLECOUNT*2*2)
+#define MAXSAMPLECOUNT		2304
+#define MIXBUFFERSIZE	(MAXSAMPLECOUNT*2)
 #define SPEED			11025
+#define MAXSPEED		48000
+#define MAXCHANNELS		64
 
 
 void I_InitMusic(void);
@@ -246,8 +246,9 @@ getsfx
 
     // pad the sound effect out to the mixing buffer size
     paddedsize = ((size-8 + (SAMPLECOUNT-1)) / SAMPLECOUNT) * SAMPLECOUNT;
-    paddedsfx = (unsigned char *) realloc(sfx, paddedsize+8);
-    for (i=size ; i<paddedsize+8 ; i++)
+    // one more byte for the mixer to interpolate towards
+    paddedsfx = (unsigned char *) realloc(sfx, paddedsize+9);
+    for (i=size ; i<paddedsize+9 ; i++)
 	paddedsfx[i] = 128;
 
     *len = paddedsize;